@@ -26,16 +26,23 @@
 #include "search/HierarchicalClusteringSearchAlgorithm.h"
 #include "search/ExhaustiveSearchAlgorithm.h"
 #include "search/GreedySearchAlgorithm.h"
+#include "search/GreedyExtendedSearchAlgorithm.h"
 #include "search/RandomSearchAlgorithm.h"
+#include "exe/SearchPlanner.h"
+#include "exe/WorkDirectory.h"
 #include "indata/PartitioningScheme.h"
 #include "indata/PartitionMap.h"
+#include "indata/TopologyCache.h"
 #include "util/PrintMeta.h"
 #include "util/Utilities.h"
+#include "util/AsyncWriter.h"
+#include "util/CheckpointStore.h"
 #include "util/FileUtilities.h"
 #include "parser/ArgumentParser.h"
 #include "parser/ConfigParser.h"
 
 #include <fstream>
+#include <sstream>
 #include <cstring>
 #include <unistd.h>
 #include <sys/types.h>
@@ -140,6 +147,15 @@ namespace partest
       schemes_logfile = new string (*output_dir + "schemes");
       results_logfile = new string (*output_dir + "results");
       log_logfile = new string (*output_dir + "log");
+      if (coop_id)
+      {
+        /* cooperating processes keep their own logs */
+        stringstream ss;
+        ss << "." << coop_id;
+        models_logfile->append (ss.str ());
+        schemes_logfile->append (ss.str ());
+        log_logfile->append (ss.str ());
+      }
 
       ckpPath = (*output_dir) + CKP_DIR;
     }
@@ -205,9 +221,19 @@ namespace partest
 #ifdef HAVE_MPI
     int tmpInt = ckpAvailable;
     MPI_Bcast (&tmpInt, 1, MPI_INT, 0, MPI_COMM_WORLD);
-    ckpAvailable = tmpInt;
+    /* workers send their results back, only the root keeps checkpoints */
+    ckpAvailable = tmpInt && I_AM_ROOT;
 #endif
 
+    /* before building any element, which reads the shared checkpoints */
+    WorkDirectory::prepare ();
+
+    if (map_memory_budget && !ckpAvailable && I_AM_ROOT)
+    {
+      cerr << "[WARNING] Partition map memory cannot be bounded without "
+          << "checkpointing. Elements will not be evicted." << endl;
+    }
+
     pllInstanceAttr attr;
     attr.fastScaling = PLL_FALSE;
     attr.randomNumberSeed = 0x54321;
@@ -395,7 +421,9 @@ int main (int argc, char * argv[])
 {
 
 #ifdef HAVE_MPI
-  if (MPI_Init (&argc, &argv))
+  /* the root distributes work from a second thread */
+  int threadSupport;
+  if (MPI_Init_thread (&argc, &argv, MPI_THREAD_SERIALIZED, &threadSupport))
   {
     cerr << "Error initializing MPI!!" << endl;
     exit_partest (EX_PROTOCOL);
@@ -403,6 +431,12 @@ int main (int argc, char * argv[])
 
   MPI_Comm_size (MPI_COMM_WORLD, &numProcs);
   MPI_Comm_rank (MPI_COMM_WORLD, &myRank);
+
+  if (threadSupport < MPI_THREAD_SERIALIZED && I_AM_ROOT)
+  {
+    cerr << "[WARNING] The MPI library does not support calls from several "
+        << "threads. Work distribution might fail." << endl;
+  }
 #endif
 
   PartitionTest * ptest = new PartitionTest ();
@@ -414,6 +448,11 @@ int main (int argc, char * argv[])
 
   ptest->configure (ptest, argc, argv);
 
+#ifndef HAVE_MPI
+  /* preempted runs stop once the running models are checkpointed */
+  ModelOptimize::installInterruptHandlers ();
+#endif
+
   if (!config_file && !ptest->checkParameters ())
   {
     cerr << "[ERROR] Configuration parameters are missing" << endl;
@@ -430,6 +469,18 @@ int main (int argc, char * argv[])
   if (number_of_schemes > 0)
     search_algo = SearchExhaustive;
 
+  if (dry_run)
+  {
+    if (I_AM_ROOT)
+    {
+      PrintMeta::print_dry_run (cout);
+    }
+#ifdef HAVE_MPI
+    MPI_Finalize ();
+#endif
+    exit_partest (EX_OK);
+  }
+
   /* Instantiate the search algorithm */
   SearchAlgorithm * searchAlgo = 0;
   PartitioningScheme * bestScheme;
@@ -444,10 +495,10 @@ int main (int argc, char * argv[])
             delete schemes;
           schemes = new vector<t_partitioningScheme> (number_of_schemes);
           /* building K=1 scheme */
-          t_partitionElementId geneId (number_of_genes);
+          t_partitionElementId geneId;
           for (size_t gene = 0; gene < number_of_genes; gene++)
           {
-            geneId.at (gene) = gene;
+            geneId.insert (gene);
           }
           schemes->at (0).push_back (geneId);
           searchAlgo = new ExhaustiveSearchAlgorithm ();
@@ -462,9 +513,7 @@ int main (int argc, char * argv[])
           /* building K=N scheme */
           for (size_t gene = 0; gene < number_of_genes; gene++)
           {
-            t_partitionElementId geneId (1);
-            geneId.at (0) = gene;
-            schemes->at (0).push_back (geneId);
+            schemes->at (0).push_back (PartitionElementId::singleGene (gene));
           }
           searchAlgo = new ExhaustiveSearchAlgorithm ();
           break;
@@ -482,8 +531,7 @@ int main (int argc, char * argv[])
         searchAlgo = new ExhaustiveSearchAlgorithm ();
         break;
       case SearchGreedyExtended:
-        cerr << "[ERROR] Not implemented yet" << endl;
-        exit_partest (EX_UNAVAILABLE);
+        searchAlgo = new GreedyExtendedSearchAlgorithm ();
         break;
       default:
         break;
@@ -493,8 +541,32 @@ int main (int argc, char * argv[])
   }
   else
   {
+    if (time_budget > 0.0)
+    {
+      /* the most thorough strategy fitting the budget */
+      searchPlan plan = SearchPlanner::plan (time_budget);
+      if (plan.algorithm == SearchGreedy)
+      {
+        searchAlgo = new GreedySearchAlgorithm ();
+        cout << "Searching with greedy algorithm" << endl;
+      }
+      else
+      {
+        max_samples = plan.maxSamples;
+        samples_percent = plan.samplesPercent;
+        searchAlgo = new HierarchicalClusteringSearchAlgorithm ();
+        cout << "Searching with hierarchical clustering with ";
+        if (max_samples)
+          cout << max_samples << " samples" << endl;
+        else
+          cout << samples_percent * 100 << "% samples" << endl;
+      }
+      cout << "Estimated runtime " << (long) plan.seconds << " s out of "
+          << (long) time_budget << " s" << endl;
+      bestScheme = searchAlgo->start ();
+    }
     /* Auto search algorithm selection according to the number of partitions */
-    if (number_of_genes <= 20)
+    else if (number_of_genes <= PLANNER_GREEDY_GENES)
     {
       searchAlgo = new GreedySearchAlgorithm ();
       cout << "Searching with greedy algorithm" << endl;
@@ -509,7 +581,7 @@ int main (int argc, char * argv[])
       cout << "Searching with hierarchical clustering with " << max_samples
           << " samples" << endl;
       bestScheme = searchAlgo->start (bestScheme);
-      if (bestScheme->getNumberOfElements () <= 20)
+      if (bestScheme->getNumberOfElements () <= PLANNER_GREEDY_GENES)
       {
         delete searchAlgo;
         searchAlgo = new GreedySearchAlgorithm ();
@@ -522,14 +594,15 @@ int main (int argc, char * argv[])
   if (I_AM_ROOT)
   {
     PrintMeta::print_results (cout, bestScheme);
+    ModelOptimize::printWarmStartSummary (cout);
 
-    if (compute_final_tree)
+    if (compute_final_tree && I_AM_LEADER)
     {
       ModelOptimize mo;
       mo.buildFinalTree (bestScheme, true);
     }
 
-    if (outputAvailable && results_logfile)
+    if (outputAvailable && results_logfile && I_AM_LEADER)
     {
       ofstream ofs (results_logfile->c_str (), ios::out);
       PrintMeta::print_results_xml (ofs, bestScheme);
@@ -542,7 +615,10 @@ int main (int argc, char * argv[])
   if (number_of_schemes > 0)
     delete schemes;
 
+  AsyncWriter::deleteInstance ();
   PartitionMap::deleteInstance ();
+  TopologyCache::deleteInstance ();
+  CheckpointStore::deleteInstance ();
 
   delete ptest;
 
@@ -0,0 +1,128 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file CostModel.cpp
+ * @author Diego Darriba
+ */
+
+#include "CostModel.h"
+
+#include <sys/time.h>
+
+using namespace std;
+
+namespace partest
+{
+
+  double CostModel::measuredCost = 0.0;
+  double CostModel::measuredSeconds = 0.0;
+  size_t CostModel::numberOfMeasurements = 0;
+  pthread_mutex_t CostModel::measureLock = PTHREAD_MUTEX_INITIALIZER;
+
+  size_t CostModel::getNumberOfStates (void)
+  {
+    return (data_type == DT_NUCLEIC) ? NUM_NUC_FREQS : NUM_PROT_FREQS;
+  }
+
+  double CostModel::getElementCost (size_t numberOfSites)
+  {
+    double states = (double) getNumberOfStates ();
+    return (double) numberOfSites * (double) num_taxa * states * states
+        * (double) number_of_models;
+  }
+
+  double CostModel::getElementCost (PartitionElement * element)
+  {
+    /* sites are known before the element is loaded, unlike the patterns,
+     * so estimates and measurements share the same units */
+    return getElementCost (element->getNumberOfSites ());
+  }
+
+  size_t CostModel::getGeneSites (size_t gene)
+  {
+    return (size_t) pllPartitions->partitionData[gene]->width;
+  }
+
+  double CostModel::getSeconds (double cost)
+  {
+    double secondsPerUnit = COST_SECONDS_PER_UNIT;
+    pthread_mutex_lock (&measureLock);
+    if (numberOfMeasurements >= COST_MIN_MEASUREMENTS && measuredCost > 0.0)
+      secondsPerUnit = measuredSeconds / measuredCost;
+    pthread_mutex_unlock (&measureLock);
+    return cost * secondsPerUnit;
+  }
+
+  void CostModel::recordTime (PartitionElement * element, double seconds)
+  {
+    double cost = getElementCost (element);
+    pthread_mutex_lock (&measureLock);
+    measuredCost += cost;
+    measuredSeconds += seconds;
+    numberOfMeasurements++;
+    pthread_mutex_unlock (&measureLock);
+  }
+
+  void CostModel::getMeasurements (double * cost, double * seconds,
+                                   size_t * count)
+  {
+    pthread_mutex_lock (&measureLock);
+    *cost = measuredCost;
+    *seconds = measuredSeconds;
+    *count = numberOfMeasurements;
+    pthread_mutex_unlock (&measureLock);
+  }
+
+  void CostModel::addMeasurements (double cost, double seconds, size_t count)
+  {
+    pthread_mutex_lock (&measureLock);
+    measuredCost += cost;
+    measuredSeconds += seconds;
+    numberOfMeasurements += count;
+    pthread_mutex_unlock (&measureLock);
+  }
+
+  double CostModel::getWallTime (void)
+  {
+    struct timeval tv;
+    gettimeofday (&tv, NULL);
+    return (double) tv.tv_sec + (double) tv.tv_usec * 1e-6;
+  }
+
+  size_t CostModel::getElementMemory (size_t numberOfSites)
+  {
+    size_t innerNodes = num_taxa > 2 ? num_taxa - 2 : 1;
+    return innerNodes * numberOfSites * getNumberOfStates ()
+        * COST_RATE_CATEGORIES * sizeof(double);
+  }
+
+  size_t CostModel::getNumberOfWorkers (void)
+  {
+#ifdef HAVE_MPI
+    /* the root process optimizes elements as well */
+    return (size_t) numProcs
+        * (size_t) (number_of_threads > 1 ? number_of_threads : 1);
+#else
+    if (fork_workers > 1)
+      return (size_t) fork_workers;
+    return (size_t) (number_of_threads > 1 ? number_of_threads : 1);
+#endif
+  }
+
+} /* namespace partest */
@@ -0,0 +1,131 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file CostModel.h
+ *
+ * @brief Estimation of the optimization cost of partition elements
+ */
+
+#ifndef COSTMODEL_H_
+#define COSTMODEL_H_
+
+#include "util/GlobalDefs.h"
+#include "indata/PartitionElement.h"
+
+#include <pthread.h>
+
+/** Seconds per cost unit, i.e., per site, taxon, squared state and model */
+#define COST_SECONDS_PER_UNIT 1e-6
+/** Number of gamma rate categories */
+#define COST_RATE_CATEGORIES  4
+/** Number of measured elements before trusting the measured rate */
+#define COST_MIN_MEASUREMENTS 4
+
+namespace partest
+{
+
+  /**
+   * @brief Cost model of the element optimization.
+   *
+   * The likelihood of an element is evaluated over every pattern and inner
+   * node, for every pair of states and every candidate model, so the cost of
+   * optimizing an element is proportional to patterns x taxa x states^2 x
+   * models. The patterns are only known once an element is loaded, so the
+   * sites are used instead, both for the estimates and the measurements.
+   *
+   * The seconds per cost unit start from a rough constant and are corrected
+   * online with the measured optimization times of the elements.
+   */
+  class CostModel
+  {
+  public:
+    /**
+     * @brief Gets the cost units of an element
+     *
+     * @param[in] numberOfSites Number of alignment sites
+     */
+    static double getElementCost (size_t numberOfSites);
+
+    /**
+     * @brief Gets the cost units of an element, which does not need to be
+     * loaded
+     */
+    static double getElementCost (PartitionElement * element);
+
+    /**
+     * @brief Gets the number of sites of a single gene
+     */
+    static size_t getGeneSites (size_t gene);
+
+    /**
+     * @brief Gets the estimated seconds of a number of cost units
+     */
+    static double getSeconds (double cost);
+
+    /**
+     * @brief Records the measured optimization time of an element
+     *
+     * @param[in] element The optimized element
+     * @param[in] seconds The wall time of its optimization
+     */
+    static void recordTime (PartitionElement * element, double seconds);
+
+    /**
+     * @brief Gets the accumulated measurements, e.g., for sending the ones
+     * of a worker process to its parent
+     */
+    static void getMeasurements (double * cost, double * seconds,
+                                 size_t * count);
+
+    /**
+     * @brief Adds measurements taken by another process
+     */
+    static void addMeasurements (double cost, double seconds, size_t count);
+
+    /**
+     * @brief Gets a wall clock time in seconds, for measuring intervals
+     */
+    static double getWallTime (void);
+
+    /**
+     * @brief Gets the bytes of the conditional likelihood vectors of an
+     * element
+     *
+     * @param[in] numberOfSites Number of alignment sites, an upper bound of
+     * the patterns
+     */
+    static size_t getElementMemory (size_t numberOfSites);
+
+    /**
+     * @brief Gets the number of elements optimized at once
+     */
+    static size_t getNumberOfWorkers (void);
+
+  private:
+    static size_t getNumberOfStates (void);
+
+    static double measuredCost; /** Cost units of the measured elements */
+    static double measuredSeconds; /** Wall time of the measured elements */
+    static size_t numberOfMeasurements;
+    static pthread_mutex_t measureLock;
+  };
+
+} /* namespace partest */
+
+#endif /* COSTMODEL_H_ */
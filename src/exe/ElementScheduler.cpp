@@ -0,0 +1,216 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file ElementScheduler.cpp
+ * @author Diego Darriba
+ */
+
+#include "ElementScheduler.h"
+#include "CostModel.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+namespace partest
+{
+
+  ElementScheduler::ElementScheduler (ModelOptimize & _mo,
+                                      int _numberOfWorkers) :
+      mo (_mo), numberOfElements (0), dispatched (0)
+  {
+    numberOfWorkers = (size_t) (_numberOfWorkers > 1 ? _numberOfWorkers : 1);
+    queues.resize (numberOfWorkers);
+    queueLocks = new pthread_mutex_t[numberOfWorkers];
+    for (size_t i = 0; i < numberOfWorkers; i++)
+    {
+      pthread_mutex_init (&queueLocks[i], NULL);
+    }
+    pthread_mutex_init (&indexLock, NULL);
+  }
+
+  ElementScheduler::~ElementScheduler ()
+  {
+    for (size_t i = 0; i < numberOfWorkers; i++)
+    {
+      pthread_mutex_destroy (&queueLocks[i]);
+    }
+    delete[] queueLocks;
+    pthread_mutex_destroy (&indexLock);
+  }
+
+  void ElementScheduler::addElement (PartitionElement * element)
+  {
+    pending.push_back (element);
+    numberOfElements++;
+  }
+
+  /** Element with its estimated cost */
+  struct costedElement
+  {
+    double cost;
+    PartitionElement * element;
+    bool operator< (const costedElement & other) const
+    {
+      /* most expensive first */
+      return cost > other.cost;
+    }
+  };
+
+  void ElementScheduler::sortByCost (vector<PartitionElement *> & elements)
+  {
+    vector<costedElement> costed (elements.size ());
+    for (size_t i = 0; i < elements.size (); i++)
+    {
+      costed[i].cost = CostModel::getElementCost (elements[i]);
+      costed[i].element = elements[i];
+    }
+    stable_sort (costed.begin (), costed.end ());
+    for (size_t i = 0; i < elements.size (); i++)
+    {
+      elements[i] = costed[i].element;
+    }
+  }
+
+  double ElementScheduler::dealElements (void)
+  {
+    sortByCost (pending);
+
+    vector<double> loads (numberOfWorkers, 0.0);
+    for (size_t i = 0; i < pending.size (); i++)
+    {
+      size_t target = (size_t) (min_element (loads.begin (), loads.end ())
+          - loads.begin ());
+      queues[target].push_back (pending[i]);
+      loads[target] += CostModel::getElementCost (pending[i]);
+    }
+    pending.clear ();
+
+    return *max_element (loads.begin (), loads.end ());
+  }
+
+  PartitionElement * ElementScheduler::nextElement (size_t workerId)
+  {
+    PartitionElement * element = 0;
+
+    /* own queue first */
+    pthread_mutex_lock (&queueLocks[workerId]);
+    if (!queues[workerId].empty ())
+    {
+      element = queues[workerId].front ();
+      queues[workerId].pop_front ();
+    }
+    pthread_mutex_unlock (&queueLocks[workerId]);
+
+    /* steal from the back of the other queues */
+    for (size_t i = 1; !element && i < numberOfWorkers; i++)
+    {
+      size_t victim = (workerId + i) % numberOfWorkers;
+      pthread_mutex_lock (&queueLocks[victim]);
+      if (!queues[victim].empty ())
+      {
+        element = queues[victim].back ();
+        queues[victim].pop_back ();
+      }
+      pthread_mutex_unlock (&queueLocks[victim]);
+    }
+
+    return element;
+  }
+
+  int ElementScheduler::nextIndex (void)
+  {
+    pthread_mutex_lock (&indexLock);
+    int index = dispatched++;
+    pthread_mutex_unlock (&indexLock);
+    return index;
+  }
+
+  void * ElementScheduler::workerThread (void * arg)
+  {
+    WorkerInfo * info = (WorkerInfo *) arg;
+    ElementScheduler * scheduler = info->scheduler;
+
+    PartitionElement * element;
+    while (!ModelOptimize::isInterrupted ()
+        && (element = scheduler->nextElement (info->workerId)))
+    {
+      scheduler->mo.optimizePartitionElement (
+          element, scheduler->nextIndex (),
+          (int) scheduler->numberOfElements);
+    }
+
+    return 0;
+  }
+
+  int ElementScheduler::run (void)
+  {
+    if (!numberOfElements)
+      return EX_OK;
+
+    size_t activeWorkers =
+        numberOfWorkers < numberOfElements ? numberOfWorkers : numberOfElements;
+
+    /* deal only among the workers that will run */
+    size_t totalWorkers = numberOfWorkers;
+    numberOfWorkers = activeWorkers;
+    double estimatedMakespan = CostModel::getSeconds (dealElements ());
+    double startTime = CostModel::getWallTime ();
+
+    /* share the thread budget among the concurrent PLL instances */
+    number_of_workers = (int) activeWorkers;
+
+    pthread_t * threads = new pthread_t[activeWorkers];
+    WorkerInfo * info = new WorkerInfo[activeWorkers];
+    for (size_t i = 0; i < activeWorkers; i++)
+    {
+      info[i].scheduler = this;
+      info[i].workerId = i;
+      if (pthread_create (&threads[i], NULL, &workerThread, (void *) &info[i]))
+      {
+        cerr << "[ERROR] Cannot create worker thread " << i << endl;
+        exit_partest (EX_OSERR);
+      }
+    }
+    for (size_t i = 0; i < activeWorkers; i++)
+    {
+      pthread_join (threads[i], NULL);
+    }
+    delete[] threads;
+    delete[] info;
+
+    if (verbosity > VERBOSITY_LOW)
+    {
+      cout << timestamp () << " - step makespan " << fixed << setprecision (1)
+          << CostModel::getWallTime () - startTime << " s (estimated "
+          << estimatedMakespan << " s)" << endl;
+      cout.unsetf (ios_base::floatfield);
+    }
+
+    numberOfWorkers = totalWorkers;
+    number_of_workers = 1;
+    numberOfElements = 0;
+    dispatched = 0;
+
+    return EX_OK;
+  }
+
+} /* namespace partest */
@@ -0,0 +1,115 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file ElementScheduler.h
+ *
+ * @brief Concurrent optimization of independent partition elements
+ */
+
+#ifndef ELEMENTSCHEDULER_H_
+#define ELEMENTSCHEDULER_H_
+
+#include "exe/ModelOptimize.h"
+#include "indata/PartitionElement.h"
+
+#include <deque>
+#include <vector>
+#include <pthread.h>
+
+namespace partest
+{
+
+  /**
+   * @brief Work-stealing scheduler for partition elements.
+   *
+   * Elements are dealt into one queue per worker following the longest
+   * processing time first rule: from the most to the least expensive, each
+   * element goes to the queue with the lowest estimated load. Each worker
+   * consumes its own queue from the front and, once empty, steals from the
+   * back of the other queues, which corrects the estimation errors with the
+   * cheapest elements. Every worker builds its own tree managers, so
+   * elements are optimized independently of each other.
+   */
+  class ElementScheduler
+  {
+  public:
+    /**
+     * @brief Creates a new scheduler
+     *
+     * @param mo Optimizer used for every element
+     * @param numberOfWorkers Number of worker threads
+     */
+    ElementScheduler (ModelOptimize & mo, int numberOfWorkers);
+    virtual ~ElementScheduler ();
+
+    /**
+     * @brief Adds an element to be dealt when running
+     *
+     * @param element The element to optimize
+     */
+    void addElement (PartitionElement * element);
+
+    /**
+     * @brief Gets the number of elements in the queues
+     */
+    size_t getNumberOfElements (void) const
+    {
+      return numberOfElements;
+    }
+
+    /**
+     * @brief Optimizes all queued elements and waits for the workers
+     *
+     * @return EX_OK on success
+     */
+    int run (void);
+
+    /**
+     * @brief Sorts a set of elements by decreasing estimated cost
+     */
+    static void sortByCost (std::vector<PartitionElement *> & elements);
+  private:
+    struct WorkerInfo
+    {
+      ElementScheduler * scheduler;
+      size_t workerId;
+    };
+
+    /** Deals the pending elements into the worker queues */
+    double dealElements (void);
+
+    static void * workerThread (void * arg);
+    PartitionElement * nextElement (size_t workerId);
+    int nextIndex (void);
+
+    ModelOptimize & mo;
+    size_t numberOfWorkers;
+    size_t numberOfElements;
+    int dispatched;
+
+    std::vector<PartitionElement *> pending; /** Elements not dealt yet */
+
+    std::vector<std::deque<PartitionElement *> > queues;
+    pthread_mutex_t * queueLocks;
+    pthread_mutex_t indexLock;
+  };
+
+} /* namespace partest */
+
+#endif /* ELEMENTSCHEDULER_H_ */
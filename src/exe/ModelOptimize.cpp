@@ -19,6 +19,7 @@
 #include "ModelOptimize.h"
 
 #include "exe/ModelSelector.h"
+#include "exe/CostModel.h"
 #include "util/Utilities.h"
 #include "indata/PartitionMap.h"
 #include "indata/TreeManager.h"
@@ -28,15 +29,39 @@
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
 #include <cmath>
 #include <cstring>
 #include <cassert>
+#include <csignal>
+#include <vector>
+#include <algorithm>
 
 using namespace std;
 
 namespace partest
 {
 
+  /* warm start telemetry */
+  struct optimizationRounds
+  {
+    size_t models;
+    size_t rounds;
+  };
+  static optimizationRounds coldStarts = { 0, 0 };
+  static optimizationRounds geneStarts = { 0, 0 };
+  static optimizationRounds nestedStarts = { 0, 0 };
+  static pthread_mutex_t roundsLock = PTHREAD_MUTEX_INITIALIZER;
+
+  /* interruption by SIGTERM or SIGUSR1, e.g., on preemptible queues */
+  static volatile sig_atomic_t interrupted = 0;
+
+  static void onInterrupt (int signum)
+  {
+    (void) signum;
+    interrupted = 1;
+  }
+
   ModelOptimize::ModelOptimize ()
   {
 
@@ -238,7 +263,7 @@ namespace partest
         pllPartitionsDestroy (tree, &compParts);
         pllAlignmentDataDestroy (alignData);
 
-        if (ckpAvailable)
+        if (ckpAvailable && I_AM_LEADER)
         {
           /* store tree */
           fstream ofs ((ckpPath + os_separator + ckpStartingTree).c_str (),
@@ -650,8 +675,9 @@ namespace partest
       PartitionElement * element = scheme->getElement (cur_element);
       if (!element->isOptimized ())
       {
-        optimizePartitionElement (element, currentElementToOptimize,
-                                  elementsToOptimize);
+        if (optimizePartitionElement (element, currentElementToOptimize,
+                                      elementsToOptimize) != EX_OK)
+          return EX_TEMPFAIL;
         currentElementToOptimize++;
       }
     }
@@ -667,43 +693,216 @@ namespace partest
     {
       return EX_OK;
     }
+    double startTime = CostModel::getWallTime ();
     element->setupStructures ();
 
-    cout << timestamp () << " - - -";
+    /* build the whole line first, so concurrent workers do not mix it up */
+    ostringstream oss;
+    oss << timestamp () << " - - -";
 #ifdef HAVE_MPI
-    cout << " [" << myRank << "]";
+    oss << " [" << myRank << "]";
 #endif
-    cout << " element " << setw (Utilities::iDecLog (limit) + 1)
+    oss << " element " << setw (Utilities::iDecLog (limit) + 1)
         << setfill ('0') << right << index + 1 << "/" << limit << setfill (' ');
 #ifdef DEBUG
     if (epsilon == AUTO_EPSILON)
-      cout << " [" << element->getEpsilon () << "]";
+      oss << " [" << element->getEpsilon () << "]";
 #endif
-    cout << endl;
+    oss << endl;
+    cout << oss.str () << flush;
+
+    size_t numberOfReplicas = (size_t) (model_threads > 1 ? model_threads : 1);
+    if (numberOfReplicas > element->getNumberOfModels ())
+    {
+      numberOfReplicas = element->getNumberOfModels ();
+    }
+
+    /* models finished before an interruption are not optimized again */
+    vector<bool> optimized (element->getNumberOfModels (), false);
+    size_t resumedModels = 0;
+    for (size_t i = 0; i < element->getNumberOfModels (); i++)
+    {
+      if (element->loadModel (i))
+      {
+        optimized[i] = true;
+        resumedModels++;
+      }
+    }
+    if (resumedModels)
+    {
+      ostringstream resumed;
+      resumed << timestamp () << " - - - resumed " << resumedModels << "/"
+          << element->getNumberOfModels () << " models from checkpoint"
+          << endl;
+      cout << resumed.str () << flush;
+    }
+
+    vector<size_t> order;
+    vector<size_t> fullOrder = nestingOrder (element);
+    for (size_t i = 0; i < fullOrder.size (); i++)
+    {
+      if (!optimized[fullOrder[i]])
+        order.push_back (fullOrder[i]);
+    }
+    if (numberOfReplicas > order.size ())
+    {
+      numberOfReplicas = order.size ();
+    }
+
+    if (numberOfReplicas > 1)
+    {
+      optimizeModelsConcurrently (element, order, optimized, numberOfReplicas);
+    }
+    else
+    {
+      for (size_t i = 0; i < order.size (); i++)
+      {
+        size_t modelIndex = order[i];
+        if (!optimizeModel (element, element->getTreeManager (), modelIndex,
+                            closestOptimizedModel (element, modelIndex,
+                                                   optimized),
+                            (int) element->getNumberOfModels ()))
+          break;
+        optimized[modelIndex] = true;
+      }
+    }
 
-    for (size_t modelIndex = 0; modelIndex < element->getNumberOfModels ();
-        modelIndex++)
+    /* interrupted, the finished models are already stored */
+    if (find (optimized.begin (), optimized.end (), false) != optimized.end ())
     {
-      optimizeModel (element, modelIndex, (int) element->getNumberOfModels ());
+      element->destroyStructures ();
+      return EX_TEMPFAIL;
     }
 
+    /* selection starts once every candidate model is optimized */
     ModelSelector ms (element, ic_type, element->getSampleSize ());
 
     element->destroyStructures ();
 
+    /* correct the cost model with the measured time, unless resumed models
+     * made the optimization look faster than it is */
+    if (!resumedModels)
+      CostModel::recordTime (element, CostModel::getWallTime () - startTime);
+
     return EX_OK;
   }
 
-  void ModelOptimize::optimizeModel (PartitionElement * element,
-                                     size_t modelIndex, int limit)
+  void * ModelOptimize::modelWorkerThread (void * arg)
+  {
+    ModelWorkerInfo * info = (ModelWorkerInfo *) arg;
+    int limit = (int) info->element->getNumberOfModels ();
+    size_t numberOfPending = info->order->size ();
+
+    while (true)
+    {
+      /* only models already finished by any replica can seed the next one */
+      pthread_mutex_lock (info->lock);
+      size_t position = (*info->nextModel)++;
+      size_t modelIndex = 0;
+      const Model * nestedModel = 0;
+      if (position < numberOfPending)
+      {
+        modelIndex = info->order->at (position);
+        nestedModel = closestOptimizedModel (info->element, modelIndex,
+                                             *info->optimized);
+      }
+      pthread_mutex_unlock (info->lock);
+
+      if (position >= numberOfPending)
+        break;
+
+      if (!info->mo->optimizeModel (info->element, info->treeManager,
+                                    modelIndex, nestedModel, limit))
+        break;
+
+      pthread_mutex_lock (info->lock);
+      info->optimized->at (modelIndex) = true;
+      pthread_mutex_unlock (info->lock);
+    }
+
+    return 0;
+  }
+
+  void ModelOptimize::optimizeModelsConcurrently (
+      PartitionElement * element, const vector<size_t> & order,
+      vector<bool> & optimized, size_t numberOfReplicas)
+  {
+    size_t nextModel = 0;
+    pthread_mutex_t lock;
+    pthread_mutex_init (&lock, NULL);
+
+    /* replica 0 is the element tree manager itself */
+    vector<TreeManager *> replicas (numberOfReplicas);
+    replicas[0] = element->getTreeManager ();
+    for (size_t i = 1; i < numberOfReplicas; i++)
+    {
+      replicas[i] = element->createTreeManager ();
+    }
+
+    vector<pthread_t> threads (numberOfReplicas);
+    vector<ModelWorkerInfo> info (numberOfReplicas);
+    for (size_t i = 0; i < numberOfReplicas; i++)
+    {
+      info[i].mo = this;
+      info[i].element = element;
+      info[i].treeManager = replicas[i];
+      info[i].order = &order;
+      info[i].optimized = &optimized;
+      info[i].nextModel = &nextModel;
+      info[i].lock = &lock;
+      if (pthread_create (&threads[i], NULL, &modelWorkerThread,
+                          (void *) &info[i]))
+      {
+        cerr << "[ERROR] Cannot create model evaluation thread " << i << endl;
+        exit_partest (EX_OSERR);
+      }
+    }
+    for (size_t i = 0; i < numberOfReplicas; i++)
+    {
+      pthread_join (threads[i], NULL);
+    }
+
+    for (size_t i = 1; i < numberOfReplicas; i++)
+    {
+      delete replicas[i];
+    }
+    pthread_mutex_destroy (&lock);
+  }
+
+  bool ModelOptimize::optimizeModel (PartitionElement * element,
+                                     TreeManager * treeManager,
+                                     size_t modelIndex,
+                                     const Model * nestedModel, int limit)
   {
 
-    TreeManager * treeManager = element->getTreeManager ();
+    /* no model starts after an interruption */
+    if (interrupted)
+      return false;
+
     Model * model = element->getModel (modelIndex);
     double lk;
+    int rounds = 0;
+
+    /* start from the closest optimized model of the same element, or else
+     * merged elements start from their constituents' parameters */
+    bool geneStarted = false;
+    if (nestedModel)
+    {
+      nestedStartModel (element, treeManager, modelIndex, nestedModel);
+    }
+    else
+    {
+      geneStarted = warm_start && element->getId ().size () > 1
+          && warmStartModel (element, treeManager, modelIndex);
+    }
+    bool warmStarted = nestedModel || geneStarted;
+    if (!warmStarted)
+    {
+      /* not the scaler left by the previous model of the tree manager */
+      treeManager->setBranchLengthMultiplier (1.0);
+    }
 
-    /* set parameters for single partition element */
-    treeManager->setModelParameters (model, 0, false);
+    treeManager->setModelParameters (model, 0, warmStarted);
 
     if (starting_topology == StartTopoML)
     {
@@ -715,7 +914,8 @@ namespace partest
       double cur_epsilon = epsilon;
       if (epsilon == AUTO_EPSILON)
       {
-        cur_epsilon = element->getEpsilon ();
+        /* replicas may be evaluating other models of the same element */
+        cur_epsilon = AUTO_EPSILON_SCALE * treeManager->getLikelihood ();
       }
       int smoothIterations = 32;
       int iters = 5;
@@ -725,8 +925,21 @@ namespace partest
         treeManager->optimizeBranchLengths (smoothIterations);
         treeManager->optimizeModelParameters (cur_epsilon);
         iters--;
+        rounds++;
       }
       while (fabs (lk - treeManager->getLikelihood ()) > cur_epsilon && iters>0);
+
+      /* single genes converge differently, so only merged elements are
+       * compared */
+      if (element->getId ().size () > 1)
+      {
+        pthread_mutex_lock (&roundsLock);
+        optimizationRounds & stats =
+            nestedModel ? nestedStarts : (geneStarted ? geneStarts : coldStarts);
+        stats.models++;
+        stats.rounds += (size_t) rounds;
+        pthread_mutex_unlock (&roundsLock);
+      }
     }
 
     if (!isfinite (treeManager->getLikelihood ()))
@@ -759,15 +972,290 @@ namespace partest
 
     if (verbosity)
     {
-      cout << timestamp () << " - - - - -";
+      ostringstream oss;
+      oss << timestamp () << " - - - - -";
 #ifdef HAVE_MPI
-      cout << " [" << myRank << "]";
+      oss << " [" << myRank << "]";
 #endif
-      cout << " " << setw (Utilities::iDecLog (limit) + 1) << setfill ('0')
+      oss << " " << setw (Utilities::iDecLog (limit) + 1) << setfill ('0')
           << right << modelIndex + 1 << "/" << limit << " " << model->getName ()
           << " (" << fixed << setprecision (4) << treeManager->getLikelihood ()
           << ")" << setfill (' ') << endl;
+      cout << oss.str () << flush;
+    }
+
+    element->storeModel (modelIndex);
+    return true;
+  }
+
+  bool ModelOptimize::warmStartModel (PartitionElement * element,
+                                      TreeManager * treeManager,
+                                      size_t modelIndex)
+  {
+    Model * model = element->getModel (modelIndex);
+    PartitionMap * partitionMap = PartitionMap::getInstance ();
+    vector<size_t> genes = element->getId ().getGenes ();
+
+    double alpha = 0.0;
+    double blScaler = 0.0;
+    double frequencies[NUM_NUC_FREQS];
+    double rates[NUM_DNA_RATES];
+    for (int i = 0; i < NUM_NUC_FREQS; i++)
+      frequencies[i] = 0.0;
+    for (int i = 0; i < NUM_DNA_RATES; i++)
+      rates[i] = 0.0;
+
+    /* site-weighted average of the same candidate in each single gene */
+    for (size_t i = 0; i < genes.size (); i++)
+    {
+      PartitionElement * gene = partitionMap->getPartitionElement (
+          PartitionElementId::singleGene (genes[i]));
+      if (!gene->isOptimized ()
+          || gene->getNumberOfModels () != element->getNumberOfModels ())
+      {
+        return false;
+      }
+      Model * geneModel = gene->getModel (modelIndex);
+      if (geneModel->getName ().compare (model->getName ()))
+      {
+        return false;
+      }
+
+      double weight = (double) gene->getNumberOfSites ()
+          / (double) element->getNumberOfSites ();
+      alpha += weight * geneModel->getAlpha ();
+      blScaler += weight * geneModel->getBranchLengthsScaler ();
+      if (data_type == DT_NUCLEIC)
+      {
+        for (int j = 0; j < NUM_NUC_FREQS; j++)
+          frequencies[j] += weight * geneModel->getFrequencies ()[j];
+        for (int j = 0; j < NUM_DNA_RATES; j++)
+          rates[j] += weight * geneModel->getRates ()[j];
+      }
+    }
+
+    model->setAlpha (alpha);
+    if (data_type == DT_NUCLEIC)
+    {
+      model->setFrequencies (frequencies);
+      model->setRates (rates);
+    }
+    if (!reoptimize_branch_lengths)
+    {
+      treeManager->setBranchLengthMultiplier (blScaler);
+    }
+
+    return true;
+  }
+
+  /**
+   * @brief Number of distinct substitution rates of a symmetry string
+   */
+  static int numberOfRateGroups (const string & matrixName)
+  {
+    int groups = 0;
+    for (size_t i = 0; i < matrixName.length (); i++)
+    {
+      if (matrixName.find (matrixName[i]) == i)
+        groups++;
+    }
+    return groups;
+  }
+
+  /**
+   * @brief Checks whether every rate equality of the parent also holds in
+   * the child, i.e., the child is nested in the parent
+   */
+  static bool isNestedIn (const string & child, const string & parent)
+  {
+    for (int i = 0; i < NUM_DNA_RATES; i++)
+    {
+      for (int j = i + 1; j < NUM_DNA_RATES; j++)
+      {
+        if (parent[i] == parent[j] && child[i] != child[j])
+          return false;
+      }
+    }
+    return true;
+  }
+
+  vector<size_t> ModelOptimize::nestingOrder (PartitionElement * element)
+  {
+    size_t numberOfModels = element->getNumberOfModels ();
+    vector<size_t> order (numberOfModels);
+    for (size_t i = 0; i < numberOfModels; i++)
+      order[i] = i;
+
+    if (!warm_start || data_type != DT_NUCLEIC)
+      return order;
+
+    /* most general matrices first, each equal-frequency model followed by
+     * its +F variant. Insertion sort keeps the enum order within a level */
+    for (size_t i = 1; i < numberOfModels; i++)
+    {
+      size_t current = order[i];
+      Model * model = element->getModel (current);
+      int groups = numberOfRateGroups (model->getMatrixName ());
+      size_t j = i;
+      while (j > 0)
+      {
+        Model * prev = element->getModel (order[j - 1]);
+        int prevGroups = numberOfRateGroups (prev->getMatrixName ());
+        if (prevGroups > groups
+            || (prevGroups == groups
+                && (prev->getMatrixName () != model->getMatrixName ()
+                    || prev->isPF () <= model->isPF ())))
+          break;
+        order[j] = order[j - 1];
+        j--;
+      }
+      order[j] = current;
+    }
+
+    return order;
+  }
+
+  const Model * ModelOptimize::closestOptimizedModel (
+      PartitionElement * element, size_t modelIndex,
+      const vector<bool> & optimized)
+  {
+    if (!warm_start || data_type != DT_NUCLEIC)
+      return 0;
+
+    Model * model = element->getModel (modelIndex);
+    int groups = numberOfRateGroups (model->getMatrixName ());
+
+    /* the distance is the number of additional free parameters */
+    const Model * closest = 0;
+    int minDistance = 0;
+    for (size_t i = 0; i < element->getNumberOfModels (); i++)
+    {
+      if (i == modelIndex || !optimized[i])
+        continue;
+      Model * candidate = element->getModel (i);
+      if (candidate->isGamma () != model->isGamma ()
+          || !isNestedIn (model->getMatrixName (),
+                          candidate->getMatrixName ()))
+        continue;
+
+      int distance = numberOfRateGroups (candidate->getMatrixName ()) - groups;
+      if (candidate->isPF () != model->isPF ())
+        distance += NUM_NUC_FREQS - 1;
+      if (!closest || distance < minDistance)
+      {
+        closest = candidate;
+        minDistance = distance;
+      }
+    }
+
+    return closest;
+  }
+
+  void ModelOptimize::nestedStartModel (PartitionElement * element,
+                                        TreeManager * treeManager,
+                                        size_t modelIndex,
+                                        const Model * nestedModel)
+  {
+    Model * model = element->getModel (modelIndex);
+    string matrixName = model->getMatrixName ();
+    const double * nestedRates = nestedModel->getRates ();
+
+    /* collapse the parent rates into the groups of the nested matrix */
+    double rates[NUM_DNA_RATES];
+    for (int i = 0; i < NUM_DNA_RATES; i++)
+    {
+      double sum = 0.0;
+      int count = 0;
+      for (int j = 0; j < NUM_DNA_RATES; j++)
+      {
+        if (matrixName[j] == matrixName[i])
+        {
+          sum += nestedRates[j];
+          count++;
+        }
+      }
+      rates[i] = sum / count;
+    }
+    /* G-T rate is the reference */
+    double reference = rates[NUM_DNA_RATES - 1];
+    for (int i = 0; i < NUM_DNA_RATES; i++)
+      rates[i] /= reference;
+    model->setRates (rates);
+
+    /* equal-frequency parents leave the +F frequencies at their defaults */
+    if (model->isPF () && nestedModel->isPF ())
+    {
+      model->setFrequencies (nestedModel->getFrequencies ());
+    }
+
+    if (model->isGamma ())
+    {
+      model->setAlpha (nestedModel->getAlpha ());
     }
+    if (!reoptimize_branch_lengths)
+    {
+      treeManager->setBranchLengthMultiplier (
+          nestedModel->getBranchLengthsScaler ());
+    }
+  }
+
+  /**
+   * @brief Prints the average rounds of a kind of start, if any
+   */
+  static void printRounds (ostream & out, const char * kind,
+                           const optimizationRounds & stats)
+  {
+    if (!stats.models)
+      return;
+    out << ", " << fixed << setprecision (2)
+        << (double) stats.rounds / (double) stats.models << " " << kind
+        << " (" << stats.models << " models)";
+  }
+
+  void ModelOptimize::printWarmStartSummary (ostream & out)
+  {
+    pthread_mutex_lock (&roundsLock);
+    optimizationRounds cold = coldStarts;
+    optimizationRounds gene = geneStarts;
+    optimizationRounds nested = nestedStarts;
+    pthread_mutex_unlock (&roundsLock);
+
+    if (!gene.models && !nested.models)
+      return;
+
+    out << timestamp () << " Rounds per model of merged elements";
+    printRounds (out, "from genes", gene);
+    printRounds (out, "from nested models", nested);
+    printRounds (out, "cold started", cold);
+    out << endl;
+  }
+
+  void ModelOptimize::installInterruptHandlers (void)
+  {
+    struct sigaction action;
+    memset (&action, 0, sizeof(action));
+    action.sa_handler = onInterrupt;
+    sigemptyset (&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction (SIGTERM, &action, NULL);
+    sigaction (SIGUSR1, &action, NULL);
+  }
+
+  bool ModelOptimize::isInterrupted (void)
+  {
+    return interrupted != 0;
+  }
+
+  void ModelOptimize::interrupt (void)
+  {
+    interrupted = 1;
+  }
+
+  void ModelOptimize::exitInterrupted (void)
+  {
+    cerr << "[WARNING] Interrupted. The finished models are stored in the "
+        "checkpoints, run again to resume." << endl;
+    exit_partest (EX_TEMPFAIL);
   }
 
 } /* namespace partest */
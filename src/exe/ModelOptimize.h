@@ -30,6 +30,9 @@
 #include "indata/PartitionElement.h"
 
 #include <string>
+#include <iostream>
+#include <vector>
+#include <pthread.h>
 
 namespace partest
 {
@@ -49,10 +52,72 @@ namespace partest
                                     int limit = 1);
     int optimizePartitionElement (PartitionElement * scheme, int index = 0,
                                   int limit = 1);
+
+    /**
+     * @brief Prints the optimization rounds of the models of merged
+     * elements, started from their genes, from a nested model or cold
+     *
+     * @param out The output stream
+     */
+    static void printWarmStartSummary (std::ostream & out);
+
+    /**
+     * @brief Installs the SIGTERM and SIGUSR1 handlers. Once signaled, no
+     * further models are started, and the running ones are finished and
+     * stored. The optimization then returns EX_TEMPFAIL, and the thread
+     * driving the search exits through exitInterrupted.
+     */
+    static void installInterruptHandlers (void);
+
+    /**
+     * @brief Gets whether the process was signaled to stop
+     */
+    static bool isInterrupted (void);
+
+    /**
+     * @brief Stops the optimization as if the process was signaled, e.g.,
+     * when a worker process was signaled alone
+     */
+    static void interrupt (void);
+
+    /**
+     * @brief Exits after an interruption, writing the queued checkpoints.
+     * Only called by the thread driving the search, once no optimization
+     * workers are left.
+     */
+    static void exitInterrupted (void);
   private:
-    void optimizeModel (PartitionElement * element, size_t modelIndex,
+    /** Shared state among the replicas evaluating the models of an element */
+    struct ModelWorkerInfo
+    {
+      ModelOptimize * mo;
+      PartitionElement * element;
+      TreeManager * treeManager;
+      const std::vector<size_t> * order;
+      std::vector<bool> * optimized;
+      size_t * nextModel;
+      pthread_mutex_t * lock;
+    };
+
+    static void * modelWorkerThread (void * arg);
+    void optimizeModelsConcurrently (PartitionElement * element,
+                                     const std::vector<size_t> & order,
+                                     std::vector<bool> & optimized,
+                                     size_t numberOfReplicas);
+    /** Optimizes and stores a model, unless the process was interrupted */
+    bool optimizeModel (PartitionElement * element, TreeManager * treeManager,
+                        size_t modelIndex, const Model * nestedModel,
                         int limit);
-    void setModelParameters (t_partitionElementId id, Model * _model,
+    bool warmStartModel (PartitionElement * element, TreeManager * treeManager,
+                         size_t modelIndex);
+    void nestedStartModel (PartitionElement * element,
+                           TreeManager * treeManager, size_t modelIndex,
+                           const Model * nestedModel);
+    static std::vector<size_t> nestingOrder (PartitionElement * element);
+    static const Model * closestOptimizedModel (
+        PartitionElement * element, size_t modelIndex,
+        const std::vector<bool> & optimized);
+    void setModelParameters (const t_partitionElementId & id, Model * _model,
                              pllInstance * _tree, partitionList * _partitions,
                              pllAlignmentData * _alignData, int index,
                              bool setAlphaFreqs);
@@ -17,8 +17,10 @@
  */
 
 #include "ModelSelector.h"
+#include "util/AsyncWriter.h"
+
 #include <cmath>
-#include <fstream>
+#include <sstream>
 #include <iostream>
 #include <iomanip>
 #include <cassert>
@@ -47,9 +49,10 @@ namespace partest
 
     if (outputAvailable && models_logfile)
     {
-      ofstream ofs (models_logfile->c_str (), ios::in | ios::out | ios::app);
-      print (ofs);
-      ofs.close ();
+      /* the whole selection is appended at once by the output writer */
+      ostringstream ss;
+      print (ss);
+      AsyncWriter::getInstance ()->append (*models_logfile, ss.str ());
     }
   }
 
@@ -10,6 +10,7 @@
 #include "exe/ModelSelector.h"
 #include "model/SelectionModel.h"
 #include "util/Utilities.h"
+#include "util/AsyncWriter.h"
 #include <alloca.h>
 #include <iomanip>
 #include <vector>
@@ -77,9 +78,9 @@ namespace partest
 
     if (outputAvailable && schemes_logfile)
     {
-      ofstream ofs (schemes_logfile->c_str (), ios::in | ios::out | ios::app);
-      print (ofs, limit);
-      ofs.close ();
+      ostringstream ss;
+      print (ss, limit);
+      AsyncWriter::getInstance ()->append (*schemes_logfile, ss.str ());
     }
   }
 
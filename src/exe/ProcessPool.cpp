@@ -0,0 +1,372 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file ProcessPool.cpp
+ * @author Diego Darriba
+ */
+
+#include "ProcessPool.h"
+#include "CostModel.h"
+#include "util/AsyncWriter.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <ctime>
+#include <csignal>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+namespace partest
+{
+
+  ProcessPool::sharedState * ProcessPool::createSharedState (void)
+  {
+    void * memory = mmap (NULL, sizeof(sharedState), PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+    {
+      cerr << "[ERROR] Cannot map the memory shared with the worker processes"
+          << endl;
+      exit_partest (EX_OSERR);
+    }
+    sharedState * state = (sharedState *) memory;
+
+    pthread_mutexattr_t mutexAttr;
+    pthread_mutexattr_init (&mutexAttr);
+    pthread_mutexattr_setpshared (&mutexAttr, PTHREAD_PROCESS_SHARED);
+    /* a worker dying while holding a lock must not block the others */
+    pthread_mutexattr_setrobust (&mutexAttr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init (&state->taskLock, &mutexAttr);
+    pthread_mutex_init (&state->ringLock, &mutexAttr);
+    pthread_mutex_init (&state->writerLock, &mutexAttr);
+    pthread_mutexattr_destroy (&mutexAttr);
+
+    pthread_condattr_t condAttr;
+    pthread_condattr_init (&condAttr);
+    pthread_condattr_setpshared (&condAttr, PTHREAD_PROCESS_SHARED);
+    pthread_cond_init (&state->notEmpty, &condAttr);
+    pthread_cond_init (&state->notFull, &condAttr);
+    pthread_condattr_destroy (&condAttr);
+
+    state->nextTask = 0;
+    state->head = 0;
+    state->tail = 0;
+
+    return state;
+  }
+
+  void ProcessPool::destroySharedState (sharedState * state)
+  {
+    pthread_mutex_destroy (&state->taskLock);
+    pthread_mutex_destroy (&state->ringLock);
+    pthread_mutex_destroy (&state->writerLock);
+    pthread_cond_destroy (&state->notEmpty);
+    pthread_cond_destroy (&state->notFull);
+    munmap (state, sizeof(sharedState));
+  }
+
+  bool ProcessPool::lockShared (pthread_mutex_t * mutex)
+  {
+    if (pthread_mutex_lock (mutex) == EOWNERDEAD)
+    {
+      pthread_mutex_consistent (mutex);
+      return false;
+    }
+    return true;
+  }
+
+  void ProcessPool::ringWrite (sharedState * state, const char * data,
+                               size_t length)
+  {
+    if (!lockShared (&state->ringLock))
+      abandonedWrite (&state->ringLock);
+    size_t written = 0;
+    while (written < length)
+    {
+      while (state->tail - state->head == POOL_RING_SIZE)
+      {
+        if (pthread_cond_wait (&state->notFull, &state->ringLock)
+            == EOWNERDEAD)
+        {
+          pthread_mutex_consistent (&state->ringLock);
+          abandonedWrite (&state->ringLock);
+        }
+      }
+      size_t position = state->tail % POOL_RING_SIZE;
+      size_t chunk = min (length - written,
+                          POOL_RING_SIZE - (state->tail - state->head));
+      chunk = min (chunk, POOL_RING_SIZE - position);
+      memcpy (state->ring + position, data + written, chunk);
+      state->tail += chunk;
+      written += chunk;
+      pthread_cond_signal (&state->notEmpty);
+    }
+    pthread_mutex_unlock (&state->ringLock);
+  }
+
+  void ProcessPool::ringRead (sharedState * state, char * data, size_t length,
+                              vector<pid_t> & workers)
+  {
+    if (!lockShared (&state->ringLock))
+      abandonedLock (&state->ringLock, workers);
+    size_t read = 0;
+    while (read < length)
+    {
+      while (state->tail == state->head)
+      {
+        struct timespec deadline;
+        clock_gettime (CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += POOL_POLL_INTERVAL;
+        int waitStatus = pthread_cond_timedwait (&state->notEmpty,
+                                                 &state->ringLock, &deadline);
+        if (waitStatus == EOWNERDEAD)
+        {
+          pthread_mutex_consistent (&state->ringLock);
+          abandonedLock (&state->ringLock, workers);
+        }
+        else if (waitStatus == ETIMEDOUT)
+        {
+          pthread_mutex_unlock (&state->ringLock);
+          bool alive = checkWorkers (workers);
+          if (!lockShared (&state->ringLock))
+            abandonedLock (&state->ringLock, workers);
+          if (!alive && state->tail == state->head)
+          {
+            /* nothing else will be written */
+            pthread_mutex_unlock (&state->ringLock);
+            if (ModelOptimize::isInterrupted ())
+              ModelOptimize::exitInterrupted ();
+            cerr << "[ERROR] The worker processes exited before sending "
+                << "every result" << endl;
+            exit_partest (EX_SOFTWARE);
+          }
+        }
+      }
+      size_t position = state->head % POOL_RING_SIZE;
+      size_t chunk = min (length - read, state->tail - state->head);
+      chunk = min (chunk, POOL_RING_SIZE - position);
+      memcpy (data + read, state->ring + position, chunk);
+      state->head += chunk;
+      read += chunk;
+      pthread_cond_broadcast (&state->notFull);
+    }
+    pthread_mutex_unlock (&state->ringLock);
+  }
+
+  void ProcessPool::abandonedLock (pthread_mutex_t * mutex,
+                                   vector<pid_t> & workers)
+  {
+    /* the ring might be half written, so nothing else can be read */
+    pthread_mutex_unlock (mutex);
+    for (size_t i = 0; i < workers.size (); i++)
+    {
+      if (workers[i])
+        kill (workers[i], SIGTERM);
+    }
+    cerr << "[ERROR] A worker process died while writing its results" << endl;
+    exit_partest (EX_SOFTWARE);
+  }
+
+  void ProcessPool::abandonedWrite (pthread_mutex_t * mutex)
+  {
+    /* the ring might be half written, the parent stops the others */
+    pthread_mutex_unlock (mutex);
+    cerr << "[ERROR] Another worker process died while writing its results"
+        << endl;
+    _exit (EX_SOFTWARE);
+  }
+
+  bool ProcessPool::checkWorkers (vector<pid_t> & workers)
+  {
+    bool alive = false;
+    bool failed = false;
+    for (size_t i = 0; i < workers.size (); i++)
+    {
+      int status;
+      if (workers[i] && waitpid (workers[i], &status, WNOHANG) == workers[i])
+      {
+        workers[i] = 0;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == EX_TEMPFAIL)
+        {
+          /* interrupted, maybe alone, so its element is left unfinished
+           * and the whole step stops */
+          ModelOptimize::interrupt ();
+        }
+        else if (!WIFEXITED(status) || WEXITSTATUS(status) != EX_OK)
+          failed = true;
+      }
+      if (workers[i])
+        alive = true;
+    }
+
+    if (failed)
+    {
+      for (size_t i = 0; i < workers.size (); i++)
+      {
+        if (workers[i])
+          kill (workers[i], SIGTERM);
+      }
+      cerr << "[ERROR] A worker process terminated unexpectedly" << endl;
+      exit_partest (EX_SOFTWARE);
+    }
+
+    if (ModelOptimize::isInterrupted ())
+    {
+      /* the workers store their running models and exit, while the results
+       * they already sent are still read */
+      for (size_t i = 0; i < workers.size (); i++)
+      {
+        if (workers[i])
+          kill (workers[i], SIGUSR1);
+      }
+    }
+
+    return alive;
+  }
+
+  void ProcessPool::workerLoop (sharedState * state, ModelOptimize & mo,
+                                vector<PartitionElement *> & elements)
+  {
+    /* the parent stores the checkpoints of the results */
+    PartitionElement::disableCheckpointWrites ();
+    /* the writer thread of the parent is not forked */
+    AsyncWriter::setSynchronous ();
+    number_of_threads = 1;
+
+    string buffer;
+    int exitStatus = EX_OK;
+    while (true)
+    {
+      if (ModelOptimize::isInterrupted ())
+      {
+        exitStatus = EX_TEMPFAIL;
+        break;
+      }
+      /* the counter is consistent even if its owner died */
+      lockShared (&state->taskLock);
+      size_t index = state->nextTask++;
+      pthread_mutex_unlock (&state->taskLock);
+      if (index >= elements.size ())
+        break;
+
+      PartitionElement * element = elements[index];
+      double startCost, startSeconds;
+      size_t startCount;
+      CostModel::getMeasurements (&startCost, &startSeconds, &startCount);
+      if (mo.optimizePartitionElement (element, (int) index,
+                                       (int) elements.size ()) != EX_OK)
+      {
+        /* the parent waits for this element unless told */
+        exitStatus = EX_TEMPFAIL;
+        break;
+      }
+
+      /* the optimizer only measures the elements it fully optimized */
+      resultHeader header;
+      header.index = index;
+      CostModel::getMeasurements (&header.measuredCost,
+                                  &header.measuredSeconds,
+                                  &header.measurements);
+      header.measuredCost -= startCost;
+      header.measuredSeconds -= startSeconds;
+      header.measurements -= startCount;
+      element->packResult (buffer);
+      header.length = buffer.size ();
+
+      if (!lockShared (&state->writerLock))
+        abandonedWrite (&state->writerLock);
+      ringWrite (state, (const char *) &header, sizeof(header));
+      ringWrite (state, buffer.data (), buffer.size ());
+      pthread_mutex_unlock (&state->writerLock);
+    }
+
+    cout.flush ();
+    cerr.flush ();
+    _exit (exitStatus);
+  }
+
+  void ProcessPool::optimize (ModelOptimize & mo,
+                              vector<PartitionElement *> & elements)
+  {
+    if (elements.empty ())
+      return;
+
+    size_t numberOfWorkers = min ((size_t) fork_workers, elements.size ());
+    cout << timestamp () << " - optimizing " << elements.size ()
+        << " elements on " << numberOfWorkers << " worker processes" << endl;
+
+    sharedState * state = createSharedState ();
+
+    /* buffered output would be printed again by every worker, and the
+     * workers must find the queued checkpoints in the store. The writer
+     * thread is stopped, since a fork while it holds the queue or store
+     * locks would leave them locked forever in the workers. The next
+     * output starts a new writer in this process. */
+    AsyncWriter::deleteInstance ();
+    cout.flush ();
+    cerr.flush ();
+
+    vector<pid_t> workers;
+    for (size_t i = 0; i < numberOfWorkers; i++)
+    {
+      pid_t pid = fork ();
+      if (pid < 0)
+      {
+        for (size_t j = 0; j < workers.size (); j++)
+          kill (workers[j], SIGTERM);
+        cerr << "[ERROR] Cannot fork worker process " << i << endl;
+        exit_partest (EX_OSERR);
+      }
+      if (!pid)
+      {
+        workerLoop (state, mo, elements);
+      }
+      workers.push_back (pid);
+    }
+
+    vector<char> buffer;
+    for (size_t received = 0; received < elements.size (); received++)
+    {
+      resultHeader header;
+      ringRead (state, (char *) &header, sizeof(header), workers);
+      buffer.resize (header.length + 1);
+      ringRead (state, &(buffer.front ()), header.length, workers);
+
+      PartitionElement * element = elements[header.index];
+      element->unpackResult (&(buffer.front ()), header.length);
+      CostModel::addMeasurements (header.measuredCost, header.measuredSeconds,
+                                  header.measurements);
+    }
+
+    /* every result is in, so the workers are exiting */
+    for (size_t i = 0; i < workers.size (); i++)
+    {
+      if (workers[i])
+        waitpid (workers[i], NULL, 0);
+    }
+
+    destroySharedState (state);
+  }
+
+} /* namespace partest */
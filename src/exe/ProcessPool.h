@@ -0,0 +1,139 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file ProcessPool.h
+ *
+ * @brief Optimization of partition elements on forked worker processes
+ */
+
+#ifndef PROCESSPOOL_H_
+#define PROCESSPOOL_H_
+
+#include "util/GlobalDefs.h"
+#include "indata/PartitionElement.h"
+#include "exe/ModelOptimize.h"
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <sys/types.h>
+
+/** Bytes of the shared ring buffer for the optimization results */
+#define POOL_RING_SIZE     (8 * 1024 * 1024)
+/** Seconds between two checks of the worker processes */
+#define POOL_POLL_INTERVAL 1
+
+namespace partest
+{
+
+  /**
+   * @brief Pool of forked worker processes for optimizing elements.
+   *
+   * The workers are forked at every step, once the elements to optimize are
+   * known, so they see the loaded alignment, the starting topologies and
+   * every element optimized so far through copy-on-write pages, which are
+   * never duplicated as long as the workers only read them. Each worker
+   * runs on its own copy of the PLL and global state, so no thread safety
+   * is required from them.
+   *
+   * Workers take the next element from a shared counter, optimize it and
+   * write its packed result (see PartitionElement::packResult) into a
+   * shared ring buffer. The parent process keeps the only partition map:
+   * it unpacks the results into its elements and stores the checkpoints.
+   */
+  class ProcessPool
+  {
+  public:
+    /**
+     * @brief Optimizes a set of elements on the worker processes
+     *
+     * @param mo The model optimizer
+     * @param elements The elements to optimize, already tagged and sorted
+     * by decreasing cost
+     */
+    static void optimize (ModelOptimize & mo,
+                          std::vector<PartitionElement *> & elements);
+
+  private:
+    /** State shared among the parent and the workers */
+    struct sharedState
+    {
+      pthread_mutex_t taskLock;
+      size_t nextTask; /** Index of the next element to optimize */
+
+      pthread_mutex_t ringLock; /** Protects the ring positions */
+      pthread_mutex_t writerLock; /** Keeps each result contiguous */
+      pthread_cond_t notEmpty;
+      pthread_cond_t notFull;
+      size_t head; /** Total bytes read */
+      size_t tail; /** Total bytes written */
+      char ring[POOL_RING_SIZE];
+    };
+
+    /** Header of a result in the ring buffer */
+    struct resultHeader
+    {
+      size_t index; /** Index of the element */
+      size_t length; /** Bytes of the packed result */
+      double measuredCost; /** Cost units measured by the worker */
+      double measuredSeconds; /** Wall time measured by the worker */
+      size_t measurements; /** Number of measured elements */
+    };
+
+    static sharedState * createSharedState (void);
+    static void destroySharedState (sharedState * state);
+
+    static void workerLoop (sharedState * state, ModelOptimize & mo,
+                            std::vector<PartitionElement *> & elements);
+
+    /** Writes bytes into the ring, waiting while it is full */
+    static void ringWrite (sharedState * state, const char * data,
+                           size_t length);
+
+    /** Reads bytes from the ring, waiting while it is empty */
+    static void ringRead (sharedState * state, char * data, size_t length,
+                          std::vector<pid_t> & workers);
+
+    /**
+     * @brief Locks a robust shared mutex
+     *
+     * @return false, if the previous owner died while holding it
+     */
+    static bool lockShared (pthread_mutex_t * mutex);
+
+    /** Stops every worker after one died while holding a shared lock */
+    static void abandonedLock (pthread_mutex_t * mutex,
+                               std::vector<pid_t> & workers);
+
+    /** Exits a worker after another one died while writing its result */
+    static void abandonedWrite (pthread_mutex_t * mutex);
+
+    /**
+     * @brief Checks that no worker process died before finishing. A worker
+     * exiting with EX_TEMPFAIL was interrupted, which interrupts the parent
+     * and the other workers too.
+     *
+     * @return true, if any worker is still running
+     */
+    static bool checkWorkers (std::vector<pid_t> & workers);
+  };
+
+} /* namespace partest */
+
+#endif /* PROCESSPOOL_H_ */
@@ -0,0 +1,258 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file SearchPlanner.cpp
+ * @author Diego Darriba
+ */
+
+#include "SearchPlanner.h"
+
+#include "CostModel.h"
+#include "util/Utilities.h"
+#include "util/Stirling.h"
+
+#include <cmath>
+#include <set>
+
+using namespace std;
+
+namespace partest
+{
+
+  /** Sampling rates tried by the planner, from the most thorough one */
+  static const double plannerSamplingRates[] =
+    { 1.0, 0.5, 0.2, 0.1, 0.05, 0.01 };
+
+  double SearchPlanner::getGeneCost (void)
+  {
+    /* the cost is linear on the sites, so use the mean gene */
+    size_t totalSites = 0;
+    for (size_t gene = 0; gene < number_of_genes; gene++)
+    {
+      totalSites += CostModel::getGeneSites (gene);
+    }
+    return CostModel::getElementCost (totalSites)
+        / (double) number_of_genes;
+  }
+
+  void SearchPlanner::finish (searchPlan & plan)
+  {
+    /* plan.cost holds the number of optimized genes so far */
+    plan.cost *= getGeneCost ();
+
+    size_t workers = CostModel::getNumberOfWorkers ();
+    plan.seconds = CostModel::getSeconds (plan.cost) / (double) workers;
+
+    size_t largestSites = 0;
+    for (size_t gene = 0; gene < number_of_genes; gene++)
+    {
+      size_t sites = CostModel::getGeneSites (gene);
+      if (plan.algorithm == SearchKN)
+        largestSites = max (largestSites, sites);
+      else
+        largestSites += sites;
+    }
+    double concurrent = min ((double) workers, plan.numberOfElements);
+    plan.peakMemory = (size_t) concurrent
+        * CostModel::getElementMemory (largestSites) + num_taxa * seq_len;
+  }
+
+  void SearchPlanner::walkHCluster (searchPlan & plan,
+                                    size_t numberOfElements, int maxSamples,
+                                    double samplesPercent)
+  {
+    double n = (double) number_of_genes;
+    for (size_t k = numberOfElements; k > 1; k--)
+    {
+      double pairs = (double) (k * (k - 1) / 2);
+      double samples;
+      if (maxSamples)
+        samples = min ((double) maxSamples, pairs);
+      else
+        samples = max (1.0, floor (samplesPercent * pairs));
+      plan.numberOfSchemes += samples;
+      plan.numberOfElements += samples;
+      plan.cost += samples * 2.0 * n / (double) k;
+    }
+  }
+
+  void SearchPlanner::walkGreedy (searchPlan & plan, size_t numberOfElements,
+                                  double width)
+  {
+    /* first step merges every pair of elements, the next ones only
+     * merge the new element with the other k-1 */
+    double n = (double) number_of_genes;
+    double m = (double) numberOfElements;
+    double merges = m * (m - 1.0) / 2.0;
+    double genes = merges * 2.0 * n / m;
+    for (size_t k = numberOfElements - 1; k > 1; k--)
+    {
+      merges += (double) (k - 1);
+      genes += (double) (k - 1) * 2.0 * n / (double) k;
+    }
+    plan.numberOfSchemes += width
+        * (double) Utilities::numSchemesGreedy ((int) numberOfElements);
+    plan.numberOfElements += width * merges;
+    plan.cost += width * genes;
+  }
+
+  searchPlan SearchPlanner::estimateHCluster (int maxSamples,
+                                              double samplesPercent)
+  {
+    searchPlan plan;
+    plan.algorithm = SearchHCluster;
+    plan.maxSamples = maxSamples;
+    plan.samplesPercent = samplesPercent;
+
+    double n = (double) number_of_genes;
+    plan.numberOfSchemes = 1.0;
+    plan.numberOfElements = n;
+    plan.cost = n;
+    walkHCluster (plan, number_of_genes, maxSamples, samplesPercent);
+
+    finish (plan);
+    return plan;
+  }
+
+  searchPlan SearchPlanner::estimate (SearchAlgo algorithm)
+  {
+    if (algorithm == SearchAuto)
+      return getAutoPlan ();
+    if (algorithm == SearchHCluster)
+      return estimateHCluster (max_samples, samples_percent);
+
+    searchPlan plan;
+    plan.algorithm = algorithm;
+    plan.maxSamples = max_samples;
+    plan.samplesPercent = samples_percent;
+
+    double n = (double) number_of_genes;
+    plan.numberOfSchemes = plan.numberOfElements = plan.cost = 0.0;
+    switch (algorithm)
+      {
+      case SearchK1:
+        plan.numberOfSchemes = plan.numberOfElements = 1.0;
+        plan.cost = n;
+        break;
+      case SearchKN:
+        plan.numberOfSchemes = 1.0;
+        plan.numberOfElements = plan.cost = n;
+        break;
+      case SearchGreedy:
+      case SearchGreedyExtended:
+        plan.numberOfElements = plan.cost = n;
+        walkGreedy (plan, number_of_genes,
+                    (algorithm == SearchGreedyExtended) ?
+                        (double) beam_width : 1.0);
+        break;
+      case SearchRandom:
+        {
+          /* a merge builds one element and a split two, with two genes
+           * on average */
+          double proposals = (double) (search_chains * search_steps);
+          plan.numberOfSchemes = (double) search_chains + proposals;
+          plan.numberOfElements = n + 1.5 * proposals;
+          plan.cost = n + 3.0 * proposals;
+          break;
+        }
+      case SearchExhaustive:
+        if (number_of_schemes > 0)
+        {
+          set<t_partitionElementId> elements;
+          for (size_t i = 0; i < number_of_schemes; i++)
+          {
+            const t_partitioningScheme & scheme = schemes->at (i);
+            elements.insert (scheme.begin (), scheme.end ());
+          }
+          for (set<t_partitionElementId>::iterator it = elements.begin ();
+              it != elements.end (); it++)
+          {
+            plan.cost += (double) it->size ();
+          }
+          plan.numberOfSchemes = (double) number_of_schemes;
+          plan.numberOfElements = (double) elements.size ();
+        }
+        else
+        {
+          /* every subset of genes is an element */
+          plan.numberOfSchemes =
+              exhaustive_k ?
+                  (double) Stirling::count ((unsigned) number_of_genes,
+                                            (unsigned) exhaustive_k) :
+                  (double) Stirling::bell ((unsigned) number_of_genes);
+          plan.numberOfElements = pow (2.0, n) - 1.0;
+          plan.cost = n * pow (2.0, n - 1.0);
+        }
+        break;
+      default:
+        break;
+      }
+
+    finish (plan);
+    return plan;
+  }
+
+  searchPlan SearchPlanner::plan (double timeBudget)
+  {
+    searchPlan candidate = estimate (SearchGreedy);
+    if (candidate.seconds <= timeBudget)
+      return candidate;
+
+    size_t numberOfRates = sizeof(plannerSamplingRates)
+        / sizeof(plannerSamplingRates[0]);
+    for (size_t i = 0; i < numberOfRates; i++)
+    {
+      candidate = estimateHCluster (0, plannerSamplingRates[i]);
+      if (candidate.seconds <= timeBudget)
+        return candidate;
+    }
+
+    /* nothing fits, so go for the cheapest one */
+    return estimateHCluster (1, 0.0);
+  }
+
+  searchPlan SearchPlanner::getAutoPlan (void)
+  {
+    if (time_budget > 0.0)
+      return plan (time_budget);
+
+    if (number_of_genes <= PLANNER_GREEDY_GENES)
+      return estimate (SearchGreedy);
+
+    searchPlan plan;
+    plan.algorithm = SearchAuto;
+    plan.maxSamples = max_samples;
+    plan.samplesPercent = samples_percent;
+
+    double n = (double) number_of_genes;
+    plan.numberOfSchemes = 1.0;
+    plan.numberOfElements = n;
+    plan.cost = n;
+    walkHCluster (plan, number_of_genes, max_samples, samples_percent);
+    /* the second pass starts from the best scheme of the first one and
+     * samples as many pairs as it has elements, at most one per gene */
+    walkHCluster (plan, number_of_genes, (int) number_of_genes, 0.0);
+    /* and the greedy search refines its result, once small enough */
+    walkGreedy (plan, PLANNER_GREEDY_GENES, 1.0);
+
+    finish (plan);
+    return plan;
+  }
+
+} /* namespace partest */
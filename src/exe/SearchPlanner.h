@@ -0,0 +1,103 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file SearchPlanner.h
+ *
+ * @brief Cost estimation and selection of the search strategy
+ */
+
+#ifndef SEARCHPLANNER_H_
+#define SEARCHPLANNER_H_
+
+#include "util/GlobalDefs.h"
+
+/** Maximum number of genes for the greedy search without time budget */
+#define PLANNER_GREEDY_GENES 20
+
+namespace partest
+{
+
+  /** Search strategy and its estimated cost */
+  struct searchPlan
+  {
+    SearchAlgo algorithm;
+    int maxSamples; /** HCL samples per step, 0 for samplesPercent */
+    double samplesPercent; /** HCL fraction of pairs sampled per step */
+    double numberOfSchemes; /** Number of evaluated schemes */
+    double numberOfElements; /** Number of optimized elements */
+    double cost; /** Cost units of the optimized elements */
+    double seconds; /** Estimated wall time */
+    size_t peakMemory; /** Estimated peak memory in bytes */
+  };
+
+  /**
+   * @brief Planner of the search strategy.
+   *
+   * The cost of a strategy is estimated by walking its steps: with k
+   * elements in the scheme, the merged elements hold 2n/k genes on average.
+   * The wall time divides the total cost among the workers, and the peak
+   * memory is bounded by every worker optimizing the largest element.
+   */
+  class SearchPlanner
+  {
+  public:
+    /**
+     * @brief Estimates the cost of a search algorithm with the current
+     * configuration
+     */
+    static searchPlan estimate (SearchAlgo algorithm);
+
+    /**
+     * @brief Selects the most thorough strategy fitting a time budget
+     *
+     * Greedy search is preferred, then hierarchical clustering with
+     * decreasing sampling rates. If none fits, the cheapest one is chosen.
+     *
+     * @param[in] timeBudget The wall time budget in seconds
+     */
+    static searchPlan plan (double timeBudget);
+
+    /**
+     * @brief Gets the strategy of the auto search
+     *
+     * Without time budget and with more than PLANNER_GREEDY_GENES genes, the
+     * auto search runs hierarchical clustering twice and then the greedy
+     * search. Since the sizes of the intermediate schemes are unknown, both
+     * later passes are bounded by the number of genes and
+     * PLANNER_GREEDY_GENES elements respectively.
+     */
+    static searchPlan getAutoPlan (void);
+
+  private:
+    static searchPlan estimateHCluster (int maxSamples, double samplesPercent);
+
+    /** Adds the steps of hierarchical clustering from a scheme */
+    static void walkHCluster (searchPlan & plan, size_t numberOfElements,
+                              int maxSamples, double samplesPercent);
+
+    /** Adds the steps of greedy search from a scheme */
+    static void walkGreedy (searchPlan & plan, size_t numberOfElements,
+                            double width);
+    static void finish (searchPlan & plan);
+    static double getGeneCost (void);
+  };
+
+} /* namespace partest */
+
+#endif /* SEARCHPLANNER_H_ */
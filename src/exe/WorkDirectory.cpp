@@ -0,0 +1,323 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file WorkDirectory.cpp
+ * @author Diego Darriba
+ */
+
+#include "WorkDirectory.h"
+#include "ElementScheduler.h"
+#include "ProcessPool.h"
+#include "CostModel.h"
+#include "util/AsyncWriter.h"
+#include "util/FileUtilities.h"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+using namespace std;
+
+namespace partest
+{
+
+  void WorkDirectory::prepare (void)
+  {
+    if (coop_size <= 1)
+      return;
+
+    if (coop_id >= coop_size)
+    {
+      cerr << "[ERROR] Process index " << coop_id << " is out of the "
+          << coop_size << " cooperating processes." << endl;
+      exit_partest (EX_CONFIG);
+    }
+
+    if (!ckpAvailable)
+    {
+      cerr << "[ERROR] Cooperating processes share their results through "
+          << "checkpoints, which are not available." << endl;
+      exit_partest (EX_CONFIG);
+    }
+
+    string path = ckpPath + os_separator + COOP_DIR;
+    if (mkdir (path.c_str (), 0777) && errno != EEXIST)
+    {
+      cerr << "[ERROR] Cannot create the shared directory " << path << endl;
+      exit_partest (EX_IOERR);
+    }
+  }
+
+  /**
+   * @brief FNV-1a over the words of an id from a given basis, mixed with the
+   * MurmurHash3 finalizer
+   */
+  static uint64_t digestWords (const t_partitionElementId & id,
+                               uint64_t basis)
+  {
+    uint64_t h = basis;
+    for (size_t i = 0; i < id.getNumberOfWords (); i++)
+    {
+      uint64_t word = id.getWords ()[i];
+      for (size_t b = 0; b < sizeof(uint64_t); b++)
+      {
+        h ^= (word >> (8 * b)) & 0xFF;
+        h *= 1099511628211ULL;
+      }
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB93FE1A85EC3ULL;
+    h ^= h >> 33;
+    return h;
+  }
+
+  string WorkDirectory::getIdDump (PartitionElement * element)
+  {
+    const t_partitionElementId & id = element->getId ();
+    stringstream ss;
+    ss << hex << setfill ('0');
+    for (size_t i = id.getNumberOfWords (); i > 0; i--)
+      ss << setw (16) << (uint64_t) id.getWords ()[i - 1];
+    return ss.str ();
+  }
+
+  string WorkDirectory::getElementKey (PartitionElement * element)
+  {
+    const t_partitionElementId & id = element->getId ();
+    if (id.getNumberOfWords () <= COOP_KEY_WORDS)
+      return getIdDump (element);
+
+    /* too long for a file name: 128 bits of digest, and the done marker
+     * keeps the whole id to tell apart a colliding element */
+    stringstream ss;
+    ss << "h" << hex << setfill ('0') << setw (16)
+        << digestWords (id, 14695981039346656037ULL) << setw (16)
+        << digestWords (id, 0x84222325CBF29CE4ULL);
+    return ss.str ();
+  }
+
+  string WorkDirectory::getPath (const string & name)
+  {
+    return ckpPath + os_separator + COOP_DIR + os_separator + name;
+  }
+
+  bool WorkDirectory::claim (const string & key)
+  {
+    stringstream ss;
+    ss << coop_id;
+    string lockFile = getPath (key + ".lock");
+    if (FileUtilities::createExclusive (lockFile, ss.str ()))
+      return true;
+
+    /* after a restart, take back the unfinished claims */
+    string owner;
+    return FileUtilities::readContent (lockFile, owner) && owner == ss.str ();
+  }
+
+  void WorkDirectory::publish (const string & key, PartitionElement * element)
+  {
+    /* the checkpoint was written before the marker is created */
+    FileUtilities::createExclusive (getPath (key + ".done"),
+                                    getIdDump (element) + "\n");
+  }
+
+  bool WorkDirectory::isPublished (const string & key,
+                                   PartitionElement * element)
+  {
+    string content;
+    if (!FileUtilities::readContent (getPath (key + ".done"), content))
+      return false;
+
+    /* the marker is still being written until the line is complete */
+    if (!content.length () || content[content.length () - 1] != '\n')
+      return false;
+
+    if (content != getIdDump (element) + "\n")
+    {
+      cerr << "[ERROR] The shared files of element " << element->getName ()
+          << " belong to a different element with the same key " << key
+          << endl;
+      exit_partest (EX_SOFTWARE);
+    }
+    return true;
+  }
+
+  void WorkDirectory::load (PartitionElement * element, bool waitForDone)
+  {
+    if (element->isOptimized ())
+      return;
+
+    if (waitForDone)
+    {
+      string key = getElementKey (element);
+      size_t waited = 0;
+      while (!isPublished (key, element))
+      {
+        if (ModelOptimize::isInterrupted ())
+          ModelOptimize::exitInterrupted ();
+        usleep (COOP_POLL_INTERVAL);
+        waited += COOP_POLL_INTERVAL;
+        if (waited == (size_t) COOP_STALL_WARNING * 1000000)
+        {
+          string owner;
+          FileUtilities::readContent (getPath (key + ".lock"), owner);
+          cerr << "[WARNING] Still waiting for element "
+              << element->getName () << " claimed by process "
+              << (owner.length () ? owner : "none") << endl;
+        }
+      }
+    }
+
+    if (element->loadData () != CHECKPOINT_LOADED)
+    {
+      cerr << "[ERROR] Cannot load the result of element "
+          << element->getName () << " from the shared checkpoints" << endl;
+      exit_partest (EX_IOERR);
+    }
+  }
+
+  string WorkDirectory::getStepKey (const vector<PartitionElement *> & pending)
+  {
+    /* independent of the order of the elements */
+    uint64_t sum = 0, mix = 0;
+    for (size_t i = 0; i < pending.size (); i++)
+    {
+      uint64_t h = (uint64_t) pending[i]->getId ().hash ();
+      sum += h;
+      mix ^= h * 0x9E3779B97F4A7C15ULL;
+    }
+    stringstream ss;
+    ss << "step_" << hex << setfill ('0') << setw (16) << sum << setw (16)
+        << mix << "_" << dec << pending.size ();
+    return ss.str ();
+  }
+
+  void WorkDirectory::waitForStep (vector<PartitionElement *> & pending)
+  {
+    string barrierFile = getPath (getStepKey (pending));
+
+    if (I_AM_LEADER)
+    {
+      for (size_t i = 0; i < pending.size (); i++)
+      {
+        load (pending[i], true);
+      }
+      /* the step might have been already released by a previous run */
+      FileUtilities::createExclusive (barrierFile, "");
+    }
+    else
+    {
+      while (!FileUtilities::existsFile (barrierFile))
+      {
+        if (ModelOptimize::isInterrupted ())
+          ModelOptimize::exitInterrupted ();
+        usleep (COOP_POLL_INTERVAL);
+      }
+      for (size_t i = 0; i < pending.size (); i++)
+      {
+        load (pending[i], false);
+      }
+    }
+  }
+
+  void WorkDirectory::optimize (ModelOptimize & mo,
+                                vector<PartitionElement *> & pending)
+  {
+    if (pending.empty ())
+      return;
+
+    size_t batchSize = CostModel::getNumberOfWorkers ();
+    vector<PartitionElement *> claimed;
+    vector<size_t> indices;
+    vector<string> keys;
+    size_t numberOfClaimed = 0;
+    size_t next = 0;
+    while (next < pending.size ())
+    {
+      /* claim a few elements at a time, so that the processes balance */
+      claimed.clear ();
+      indices.clear ();
+      keys.clear ();
+      for (; next < pending.size () && claimed.size () < batchSize; next++)
+      {
+        PartitionElement * element = pending[next];
+        if (element->isOptimized () || element->isTagged ())
+          continue;
+
+        string key = getElementKey (element);
+        if (isPublished (key, element))
+          continue;
+        if (claim (key) && element->tryTag ())
+        {
+          claimed.push_back (element);
+          indices.push_back (next);
+          keys.push_back (key);
+        }
+      }
+
+      if (fork_workers > 1)
+      {
+        ProcessPool::optimize (mo, claimed);
+      }
+      else if (number_of_threads > 1)
+      {
+        ElementScheduler scheduler (mo, number_of_threads);
+        for (size_t i = 0; i < claimed.size (); i++)
+        {
+          scheduler.addElement (claimed[i]);
+        }
+        scheduler.run ();
+      }
+      else
+      {
+        for (size_t i = 0;
+            i < claimed.size () && !ModelOptimize::isInterrupted (); i++)
+        {
+          mo.optimizePartitionElement (claimed[i], (int) indices[i],
+                                       (int) pending.size ());
+        }
+      }
+
+      /* unfinished claims are never published, a later run resumes them */
+      if (ModelOptimize::isInterrupted ())
+        ModelOptimize::exitInterrupted ();
+
+      /* the other processes look for the results once they are published */
+      AsyncWriter::getInstance ()->flush ();
+      for (size_t i = 0; i < claimed.size (); i++)
+      {
+        publish (keys[i], claimed[i]);
+      }
+      numberOfClaimed += claimed.size ();
+    }
+
+    cout << timestamp () << " - optimized " << numberOfClaimed << " of "
+        << pending.size () << " elements, waiting for the other processes"
+        << endl;
+
+    waitForStep (pending);
+  }
+
+} /* namespace partest */
@@ -0,0 +1,116 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file WorkDirectory.h
+ *
+ * @brief Cooperation of independent processes through the output directory
+ */
+
+#ifndef WORKDIRECTORY_H_
+#define WORKDIRECTORY_H_
+
+#include "util/GlobalDefs.h"
+#include "indata/PartitionElement.h"
+#include "exe/ModelOptimize.h"
+
+#include <string>
+#include <vector>
+
+/** Microseconds between two checks of the shared directory */
+#define COOP_POLL_INTERVAL 500000
+/** Seconds waiting for an element before warning about a stalled process */
+#define COOP_STALL_WARNING 600
+/** Maximum number of id words spelled out in the shared file names */
+#define COOP_KEY_WORDS     4
+
+namespace partest
+{
+
+  /**
+   * @brief Work sharing among processes pointed at the same output directory.
+   *
+   * Every cooperating process runs the same deterministic search, so all of
+   * them reach the same steps with the same pending elements. Elements are
+   * claimed by atomically creating a lock file, and results are published
+   * through the regular element checkpoints followed by a done marker.
+   *
+   * The leader (process 0) waits for the done markers of every element in
+   * the step and then writes a barrier file. The other processes only wait
+   * for the barrier, and then load the results from the checkpoints. Steps
+   * are named after their set of pending elements, so a process started
+   * late, or resumed from a checkpoint, catches up with the others.
+   *
+   * A process restarted with the same index takes back the elements it had
+   * claimed but not finished.
+   */
+  class WorkDirectory
+  {
+  public:
+
+    /**
+     * @brief Checks the cooperation settings and creates the shared directory
+     */
+    static void prepare (void);
+
+    /**
+     * @brief Optimizes the pending elements of a search step together with
+     * the cooperating processes
+     *
+     * On return, every pending element is optimized.
+     *
+     * @param mo The model optimizer
+     * @param pending The elements of the step, sorted by decreasing cost
+     */
+    static void optimize (ModelOptimize & mo,
+                          std::vector<PartitionElement *> & pending);
+
+  private:
+    /** Gets the name of the shared files of an element */
+    static std::string getElementKey (PartitionElement * element);
+
+    /** Spells out every word of the id of an element */
+    static std::string getIdDump (PartitionElement * element);
+
+    /** Gets a path inside the shared directory */
+    static std::string getPath (const std::string & name);
+
+    /** Claims an element, or takes it back after a restart */
+    static bool claim (const std::string & key);
+
+    /** Publishes the checkpoint of an optimized element */
+    static void publish (const std::string & key, PartitionElement * element);
+
+    /** Checks whether an element was published, against its stored id */
+    static bool isPublished (const std::string & key,
+                             PartitionElement * element);
+
+    /** Waits for an element optimized by another process and loads it */
+    static void load (PartitionElement * element, bool waitForDone);
+
+    /** Gets the name of the barrier file of a step */
+    static std::string getStepKey (
+        const std::vector<PartitionElement *> & pending);
+
+    /** Waits until the leader releases a step */
+    static void waitForStep (std::vector<PartitionElement *> & pending);
+  };
+
+} /* namespace partest */
+
+#endif /* WORKDIRECTORY_H_ */
@@ -0,0 +1,416 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file DistanceMatrix.cpp
+ * @author Diego Darriba
+ */
+
+#include "DistanceMatrix.h"
+
+#include "util/Utilities.h"
+#include "model/ProteicModel.h"
+
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+namespace partest
+{
+
+  DistanceMatrix::DistanceMatrix () :
+      nextRow (0), capacity (0)
+  {
+    /* column layout of the packed parameters */
+    size_t column = 0;
+    numberOfFrequencies =
+        (data_type == DT_NUCLEIC) ? NUM_NUC_FREQS : NUM_PROT_FREQS;
+    rateColumn = column;
+    if (data_type == DT_NUCLEIC)
+      column += NUM_DNA_RATES;
+    frequencyColumn = column;
+    column += numberOfFrequencies;
+    alphaColumn = column++;
+    pinvColumn = column;
+#ifdef _IG_MODELS
+    column++;
+#endif
+    matrixColumn = column;
+    if (data_type == DT_PROTEIC)
+      column++;
+    branchColumn = column;
+    numberOfBranches =
+        (starting_topology == StartTopoFIXED) ?
+            (size_t) Utilities::numberOfBranches ((int) num_taxa) : 0;
+    column += numberOfBranches;
+    numberOfColumns = column;
+  }
+
+  DistanceMatrix::~DistanceMatrix ()
+  {
+  }
+
+  void DistanceMatrix::clear (void)
+  {
+    rowIndex.clear ();
+    rows.clear ();
+    terms.clear ();
+    modelRanking.clear ();
+    alphaRanking.clear ();
+    slotRow.clear ();
+  }
+
+  void DistanceMatrix::update (PartitioningScheme * scheme)
+  {
+    if (!scheme->isOptimized ())
+    {
+      cerr << "[ERROR] Attempting to get differences of unoptimized partitions"
+          << endl;
+      exit_partest (EX_SOFTWARE);
+    }
+
+    /* match the elements by identifier, since the element objects might
+     * have been purged from the partition map and rebuilt */
+    map<size_t, bool> kept;
+    vector<PartitionElement *> added;
+    for (size_t i = 0; i < scheme->getNumberOfElements (); i++)
+    {
+      PartitionElement * element = scheme->getElement (i);
+      map<t_partitionElementId, size_t>::iterator it = rowIndex.find (
+          element->getId ());
+      if (it != rowIndex.end ())
+      {
+        rows[it->second].element = element;
+        kept[it->second] = true;
+      }
+      else
+      {
+        added.push_back (element);
+      }
+    }
+
+    vector<size_t> removed;
+    for (map<size_t, rowEntry>::iterator it = rows.begin (); it != rows.end ();
+        it++)
+    {
+      if (kept.find (it->first) == kept.end ())
+        removed.push_back (it->first);
+    }
+    for (size_t i = 0; i < removed.size (); i++)
+    {
+      removeRow (removed[i]);
+    }
+    for (size_t i = 0; i < added.size (); i++)
+    {
+      addRow (added[i]);
+    }
+  }
+
+  void DistanceMatrix::getClosestPairs (size_t numberOfPairs,
+                                        vector<elementPair> & pairs) const
+  {
+    pairs.clear ();
+    if (!numberOfPairs || terms.empty ())
+      return;
+
+    double maxAlpha = alphaRanking.rbegin ()->distance;
+
+    /* threshold scan: an unread pair is at least as far as the sum of the
+     * next terms of both rankings */
+    set<t_pairKey> seen;
+    set<rankedPair> closest;
+    set<rankedPair>::const_iterator modelIt = modelRanking.begin ();
+    set<rankedPair>::const_iterator alphaIt = alphaRanking.begin ();
+    while (modelIt != modelRanking.end () && alphaIt != alphaRanking.end ())
+    {
+      addCandidate (*modelIt, maxAlpha, numberOfPairs, seen, closest);
+      addCandidate (*alphaIt, maxAlpha, numberOfPairs, seen, closest);
+      modelIt++;
+      alphaIt++;
+
+      if (closest.size () == numberOfPairs && modelIt != modelRanking.end ())
+      {
+        pairTerms bound;
+        bound.modelDistance = modelIt->distance;
+        bound.alphaDistance = alphaIt->distance;
+        if (closest.rbegin ()->distance < getDistance (bound, maxAlpha))
+          break;
+      }
+    }
+
+    pairs.reserve (closest.size ());
+    for (set<rankedPair>::const_iterator it = closest.begin ();
+        it != closest.end (); it++)
+    {
+      elementPair ep;
+      ep.e1 = rows.find (it->row1)->second.element;
+      ep.e2 = rows.find (it->row2)->second.element;
+      ep.distance = it->distance;
+      pairs.push_back (ep);
+    }
+  }
+
+  void DistanceMatrix::addCandidate (const rankedPair & rp, double maxAlpha,
+                                     size_t numberOfPairs,
+                                     set<t_pairKey> & seen,
+                                     set<rankedPair> & closest) const
+  {
+    t_pairKey key (rp.row1, rp.row2);
+    if (!seen.insert (key).second)
+      return;
+
+    rankedPair candidate;
+    candidate.distance = getDistance (terms.find (key)->second, maxAlpha);
+    candidate.row1 = rp.row1;
+    candidate.row2 = rp.row2;
+    closest.insert (candidate);
+    if (closest.size () > numberOfPairs)
+      closest.erase (--closest.end ());
+  }
+
+  void DistanceMatrix::addRow (PartitionElement * element)
+  {
+    size_t row = nextRow++;
+    size_t slot = slotRow.size ();
+
+    reserveSlots (slot + 1);
+    vector<double> values (numberOfColumns);
+    packParameters (element, &values[0]);
+    computeRowTerms (&values[0]);
+
+    for (size_t j = 0; j < slot; j++)
+    {
+      pairTerms pt;
+      pt.modelDistance = rowModel[j];
+      pt.alphaDistance = rowAlpha[j];
+      terms[t_pairKey (row, slotRow[j])] = pt;
+
+      rankedPair rp;
+      rp.row1 = row;
+      rp.row2 = slotRow[j];
+      rp.distance = pt.modelDistance;
+      modelRanking.insert (rp);
+      rp.distance = pt.alphaDistance;
+      alphaRanking.insert (rp);
+    }
+
+    for (size_t c = 0; c < numberOfColumns; c++)
+    {
+      getColumn (c)[slot] = values[c];
+    }
+    slotRow.push_back (row);
+
+    rowEntry entry;
+    entry.element = element;
+    entry.id = element->getId ();
+    entry.slot = slot;
+    rows[row] = entry;
+    rowIndex[entry.id] = row;
+  }
+
+  void DistanceMatrix::removeRow (size_t row)
+  {
+    for (map<size_t, rowEntry>::iterator it = rows.begin (); it != rows.end ();
+        it++)
+    {
+      if (it->first == row)
+        continue;
+
+      t_pairKey key =
+          row > it->first ? t_pairKey (row, it->first) :
+                            t_pairKey (it->first, row);
+      map<t_pairKey, pairTerms>::iterator pt = terms.find (key);
+
+      rankedPair rp;
+      rp.row1 = key.first;
+      rp.row2 = key.second;
+      rp.distance = pt->second.modelDistance;
+      modelRanking.erase (rp);
+      rp.distance = pt->second.alphaDistance;
+      alphaRanking.erase (rp);
+      terms.erase (pt);
+    }
+
+    /* fill the hole with the last slot */
+    map<size_t, rowEntry>::iterator it = rows.find (row);
+    size_t slot = it->second.slot;
+    size_t last = slotRow.size () - 1;
+    if (slot != last)
+    {
+      for (size_t c = 0; c < numberOfColumns; c++)
+      {
+        double * column = getColumn (c);
+        column[slot] = column[last];
+      }
+      slotRow[slot] = slotRow[last];
+      rows[slotRow[slot]].slot = slot;
+    }
+    slotRow.pop_back ();
+
+    rowIndex.erase (it->second.id);
+    rows.erase (it);
+  }
+
+  double DistanceMatrix::getDistance (const pairTerms & pt, double maxAlpha)
+  {
+    /* identical shapes everywhere contribute nothing */
+    if (maxAlpha > 0.0)
+      return pt.modelDistance + pt.alphaDistance / maxAlpha;
+    return pt.modelDistance;
+  }
+
+  void DistanceMatrix::reserveSlots (size_t numberOfSlots)
+  {
+    if (numberOfSlots <= capacity)
+      return;
+
+    size_t newCapacity = capacity ? 2 * capacity : 64;
+    while (newCapacity < numberOfSlots)
+      newCapacity *= 2;
+
+    vector<double> newParameters (numberOfColumns * newCapacity);
+    for (size_t c = 0; c < numberOfColumns; c++)
+    {
+      for (size_t j = 0; j < slotRow.size (); j++)
+      {
+        newParameters[c * newCapacity + j] = parameters[c * capacity + j];
+      }
+    }
+    parameters.swap (newParameters);
+    capacity = newCapacity;
+  }
+
+  void DistanceMatrix::packParameters (PartitionElement * element,
+                                       double * values) const
+  {
+    Model * model = element->getBestModel ()->getModel ();
+
+    if (data_type == DT_NUCLEIC)
+    {
+      const double * rates = model->getRates ();
+      for (size_t i = 0; i < NUM_DNA_RATES; i++)
+        values[rateColumn + i] = rates[i];
+    }
+    else
+    {
+      values[matrixColumn] =
+          (double) static_cast<ProteicModel *> (model)->getMatrix ();
+    }
+    const double * frequencies = model->getFrequencies ();
+    for (size_t i = 0; i < numberOfFrequencies; i++)
+      values[frequencyColumn + i] = frequencies[i];
+    values[alphaColumn] = model->getAlpha ();
+#ifdef _IG_MODELS
+    values[pinvColumn] = model->getpInv();
+#endif
+    if (numberOfBranches)
+    {
+      const double * branchLengths = element->getBranchLengths ();
+      for (size_t i = 0; i < numberOfBranches; i++)
+        values[branchColumn + i] = branchLengths[i];
+    }
+  }
+
+  void DistanceMatrix::computeRowTerms (const double * values)
+  {
+    size_t n = slotRow.size ();
+    rowModel.assign (n, 0.0);
+    rowAlpha.assign (n, 0.0);
+    if (!n)
+      return;
+
+    const double * alphas = getColumn (alphaColumn);
+    double alpha = values[alphaColumn];
+
+    if (data_type == DT_NUCLEIC)
+    {
+      /* same terms as NucleicModel::distanceTo, with the factor K that
+       * minimizes mse(Ra*K, Rb) computed for every row at once */
+      double denFactor = 0.0;
+      for (size_t i = 0; i < NUM_DNA_RATES; i++)
+        denFactor += values[rateColumn + i] * values[rateColumn + i];
+
+      workA.assign (n, 0.0);
+      Utilities::dotProducts (values + rateColumn, getColumn (rateColumn),
+                              NUM_DNA_RATES, capacity, n, &workA[0]);
+      for (size_t j = 0; j < n; j++)
+        workA[j] /= denFactor;
+
+      workB.assign (n, 0.0);
+      Utilities::scaledSquaredDistances (values + rateColumn,
+                                         getColumn (rateColumn),
+                                         NUM_DNA_RATES, capacity, n,
+                                         &workA[0], &workB[0]);
+
+      workA.assign (n, 0.0);
+      Utilities::squaredDistances (values + frequencyColumn,
+                                   getColumn (frequencyColumn),
+                                   numberOfFrequencies, capacity, n,
+                                   &workA[0]);
+
+      for (size_t j = 0; j < n; j++)
+      {
+        rowModel[j] = wgt_r * sqrt (workB[j]) + wgt_f * sqrt (workA[j])
+            + wgt_a * fabs (alpha - alphas[j]);
+      }
+    }
+    else
+    {
+      /* same terms as ProteicModel::distanceTo */
+      workA.assign (n, 0.0);
+      Utilities::squaredDistances (values + frequencyColumn,
+                                   getColumn (frequencyColumn),
+                                   numberOfFrequencies, capacity, n,
+                                   &workA[0]);
+
+      const double * matrices = getColumn (matrixColumn);
+      for (size_t j = 0; j < n; j++)
+      {
+        double matrixDistance = ProteicModel::getEuclideanDistance (
+            (ProtMatrix) values[matrixColumn], (ProtMatrix) matrices[j]);
+#ifdef _IG_MODELS
+        double invDistance = fabs(values[pinvColumn] - getColumn(pinvColumn)[j]);
+#else
+        double invDistance = 0.0;
+#endif
+        rowModel[j] = matrixDistance + invDistance + fabs (alpha - alphas[j])
+            + sqrt (workA[j]);
+      }
+    }
+
+    for (size_t j = 0; j < n; j++)
+    {
+      rowAlpha[j] = pow (alpha - alphas[j], 2);
+#ifdef _IG_MODELS
+      rowModel[j] += pow(values[pinvColumn] - getColumn(pinvColumn)[j], 2);
+#endif
+    }
+
+    if (numberOfBranches)
+    {
+      workA.assign (n, 0.0);
+      Utilities::squaredDistances (values + branchColumn,
+                                   getColumn (branchColumn), numberOfBranches,
+                                   capacity, n, &workA[0]);
+      for (size_t j = 0; j < n; j++)
+        rowModel[j] += workA[j];
+    }
+  }
+
+} /* namespace partest */
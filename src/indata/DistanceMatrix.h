@@ -0,0 +1,178 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file DistanceMatrix.h
+ *
+ * @brief Persistent distances between the elements of a partitioning scheme
+ */
+
+#ifndef DISTANCEMATRIX_H_
+#define DISTANCEMATRIX_H_
+
+#include "PartitioningScheme.h"
+#include "util/GlobalDefs.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+namespace partest
+{
+
+  /**
+   * @brief Distances between the elements of a partitioning scheme, kept
+   * across the steps of a clustering search.
+   *
+   * Rows are keyed by element identifier. Updating the matrix with the next
+   * scheme only drops the rows of the elements that are gone and computes
+   * the rows of the new ones, so a single merge costs O(k log k) instead of
+   * recomputing and sorting the k^2 pairs.
+   *
+   * The distance of a pair is its model distance plus its squared alpha
+   * difference, normalized by the maximum squared alpha difference among
+   * all pairs. Since that maximum changes with the scheme, the pairs are
+   * ranked by each raw term separately, and the closest pairs are merged
+   * from both rankings at query time, reading them only until no unread
+   * pair can be closer than the ones found.
+   *
+   * The model parameters and branch lengths of the live rows are packed by
+   * columns, so the distances of a new row to every other row are computed
+   * in a single vectorized pass.
+   */
+  class DistanceMatrix
+  {
+  public:
+    DistanceMatrix ();
+    virtual ~DistanceMatrix ();
+
+    /**
+     * @brief Synchronizes the matrix with the elements of a scheme
+     *
+     * @param[in] scheme The optimized partitioning scheme
+     */
+    void update (PartitioningScheme * scheme);
+
+    /**
+     * @brief Gets the number of pairs of elements
+     */
+    size_t getNumberOfPairs (void) const
+    {
+      return terms.size ();
+    }
+
+    /**
+     * @brief Gets the closest pairs of elements, sorted by distance
+     *
+     * @param[in] numberOfPairs Maximum number of pairs
+     * @param[out] pairs The closest pairs
+     */
+    void getClosestPairs (size_t numberOfPairs,
+                          std::vector<elementPair> & pairs) const;
+
+    /**
+     * @brief Removes every row
+     */
+    void clear (void);
+  private:
+    /** Raw distance terms of a pair */
+    struct pairTerms
+    {
+      double modelDistance; /** Model and branch lengths distance */
+      double alphaDistance; /** Squared alpha difference */
+    };
+
+    /** Entry of a pair ranking, the first row is the newest one */
+    struct rankedPair
+    {
+      double distance;
+      size_t row1;
+      size_t row2;
+      bool operator< (const rankedPair & other) const
+      {
+        if (distance != other.distance)
+          return distance < other.distance;
+        if (row1 != other.row1)
+          return row1 < other.row1;
+        return row2 < other.row2;
+      }
+    };
+
+    /** Element of a live row */
+    struct rowEntry
+    {
+      PartitionElement * element;
+      t_partitionElementId id;
+      size_t slot; /** Position in the parameter columns */
+    };
+
+    typedef std::pair<size_t, size_t> t_pairKey;
+
+    void addRow (PartitionElement * element);
+    void removeRow (size_t row);
+
+    /** Gets the distance of a pair, given the alpha normalization factor */
+    static double getDistance (const pairTerms & terms, double maxAlpha);
+
+    /** Adds a ranked pair to the closest ones, unless already there */
+    void addCandidate (const rankedPair & rp, double maxAlpha,
+                       size_t numberOfPairs, std::set<t_pairKey> & seen,
+                       std::set<rankedPair> & closest) const;
+
+    /** Copies the parameters of an element into a vector of columns */
+    void packParameters (PartitionElement * element, double * values) const;
+
+    /** Computes the raw terms of a packed vector to every live row */
+    void computeRowTerms (const double * values);
+
+    /** Gets a parameter column */
+    double * getColumn (size_t column)
+    {
+      return &parameters[column * capacity];
+    }
+
+    void reserveSlots (size_t numberOfSlots);
+
+    std::map<t_partitionElementId, size_t> rowIndex; /** Row of each element */
+    std::map<size_t, rowEntry> rows; /** Live rows */
+    std::map<t_pairKey, pairTerms> terms; /** Raw terms, keyed (newer, older) */
+    std::set<rankedPair> modelRanking; /** Pairs sorted by model distance */
+    std::set<rankedPair> alphaRanking; /** Pairs sorted by alpha distance */
+    size_t nextRow; /** Index of the next added row */
+
+    std::vector<double> parameters; /** Column-major packed parameters */
+    std::vector<size_t> slotRow; /** Row of each packed slot */
+    size_t capacity; /** Number of slots per column */
+    size_t numberOfColumns; /** Number of packed parameters per row */
+    size_t numberOfFrequencies; /** Number of state frequencies */
+    size_t numberOfBranches; /** Number of packed branch lengths */
+    size_t rateColumn; /** First substitution rate column */
+    size_t frequencyColumn; /** First state frequency column */
+    size_t alphaColumn; /** Gamma shape column */
+    size_t pinvColumn; /** Proportion of invariant sites column */
+    size_t matrixColumn; /** Amino-acid replacement matrix column */
+    size_t branchColumn; /** First branch length column */
+
+    std::vector<double> rowModel; /** Model terms of the last computed row */
+    std::vector<double> rowAlpha; /** Alpha terms of the last computed row */
+    std::vector<double> workA, workB; /** Kernel work buffers */
+  };
+
+} /* namespace partest */
+
+#endif /* DISTANCEMATRIX_H_ */
@@ -0,0 +1,185 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file NearestPairs.cpp
+ * @author Diego Darriba
+ */
+
+#include "NearestPairs.h"
+
+#include "util/Utilities.h"
+#include "util/VantagePointTree.h"
+
+#include <iostream>
+#include <algorithm>
+#include <set>
+#include <cmath>
+
+using namespace std;
+
+namespace partest
+{
+
+  /** Functor for sorting the pairs */
+  struct compareDistances
+  {
+    inline bool operator() (const elementPair & ep1, const elementPair & ep2)
+    {
+      return (ep1.distance < ep2.distance);
+    }
+  };
+
+  NearestPairs::NearestPairs (size_t _numberOfNeighbours) :
+      numberOfNeighbours (_numberOfNeighbours)
+  {
+  }
+
+  NearestPairs::~NearestPairs ()
+  {
+  }
+
+  void NearestPairs::getClosestPairs (PartitioningScheme * scheme,
+                                      size_t numberOfPairs,
+                                      vector<elementPair> & pairs) const
+  {
+    if (!scheme->isOptimized ())
+    {
+      cerr << "[ERROR] Attempting to get differences of unoptimized partitions"
+          << endl;
+      exit_partest (EX_SOFTWARE);
+    }
+
+    size_t numberOfElements = scheme->getNumberOfElements ();
+    size_t numberOfRates = (data_type == DT_NUCLEIC) ? NUM_DNA_RATES : 0;
+    size_t numberOfFrequencies =
+        (data_type == DT_NUCLEIC) ? NUM_NUC_FREQS : NUM_PROT_FREQS;
+    size_t numberOfBranches =
+        (starting_topology == StartTopoFIXED) ?
+            (size_t) Utilities::numberOfBranches ((int) num_taxa) : 0;
+
+    /* the largest squared alpha difference normalizes the alpha term */
+    double minAlpha = DOUBLE_INF, maxAlpha = -DOUBLE_INF;
+    for (size_t i = 0; i < numberOfElements; i++)
+    {
+      double alpha =
+          scheme->getElement (i)->getBestModel ()->getModel ()->getAlpha ();
+      minAlpha = min (minAlpha, alpha);
+      maxAlpha = max (maxAlpha, alpha);
+    }
+    double alphaRange = maxAlpha - minAlpha;
+    double alphaNorm = alphaRange * alphaRange;
+
+    /* embedding: rates up to scale, frequencies, alpha and branch lengths */
+    size_t dimension = numberOfRates + numberOfFrequencies + 1
+        + numberOfBranches;
+#ifdef _IG_MODELS
+    dimension++;
+#endif
+    vector<double> points (numberOfElements * dimension);
+    for (size_t i = 0; i < numberOfElements; i++)
+    {
+      PartitionElement * element = scheme->getElement (i);
+      Model * model = element->getBestModel ()->getModel ();
+      double * point = &points[i * dimension];
+
+      if (numberOfRates)
+      {
+        const double * rates = model->getRates ();
+        double norm = 0.0;
+        for (size_t j = 0; j < numberOfRates; j++)
+          norm += rates[j] * rates[j];
+        norm = sqrt (norm);
+        for (size_t j = 0; j < numberOfRates; j++)
+          *(point++) = wgt_r * rates[j] / norm;
+      }
+      const double * frequencies = model->getFrequencies ();
+      for (size_t j = 0; j < numberOfFrequencies; j++)
+        *(point++) = wgt_f * frequencies[j];
+      *(point++) =
+          alphaRange > 0.0 ?
+              model->getAlpha () * (wgt_a + 1.0 / alphaRange) : 0.0;
+#ifdef _IG_MODELS
+      *(point++) = model->getpInv();
+#endif
+      if (numberOfBranches)
+      {
+        const double * branchLengths = element->getBranchLengths ();
+        for (size_t j = 0; j < numberOfBranches; j++)
+          *(point++) = branchLengths[j];
+      }
+    }
+
+    /* candidate pairs, keyed (higher, lower) as in the full matrix */
+    VantagePointTree index (&points[0], numberOfElements, dimension);
+    set<pair<size_t, size_t> > candidates;
+    vector<size_t> neighbours;
+    for (size_t i = 0; i < numberOfElements; i++)
+    {
+      index.nearest (i, numberOfNeighbours, neighbours);
+      for (size_t j = 0; j < neighbours.size (); j++)
+      {
+        candidates.insert (
+            pair<size_t, size_t> (max (i, neighbours[j]),
+                                  min (i, neighbours[j])));
+      }
+    }
+
+    /* exact distances of the candidates */
+    pairs.clear ();
+    pairs.reserve (candidates.size ());
+    for (set<pair<size_t, size_t> >::iterator it = candidates.begin ();
+        it != candidates.end (); it++)
+    {
+      PartitionElement * ei = scheme->getElement (it->first);
+      PartitionElement * ej = scheme->getElement (it->second);
+      Model * mi = ei->getBestModel ()->getModel ();
+      Model * mj = ej->getBestModel ()->getModel ();
+
+      /* same terms as the distances of DistanceMatrix */
+      double distance = mi->distanceTo (mj);
+      if (numberOfBranches)
+      {
+        double treeDist = 0.0;
+        double * bl1 = ei->getBranchLengths ();
+        double * bl2 = ej->getBranchLengths ();
+        for (size_t cBranch = 0; cBranch < numberOfBranches; cBranch++)
+        {
+          treeDist += pow (bl1[cBranch] - bl2[cBranch], 2);
+        }
+        distance += treeDist;
+      }
+      if (alphaNorm > 0.0)
+        distance += pow (mi->getAlpha () - mj->getAlpha (), 2) / alphaNorm;
+#ifdef _IG_MODELS
+      distance += pow(mi->getpInv() - mj->getpInv(), 2);
+#endif
+
+      elementPair ep;
+      ep.e1 = ei;
+      ep.e2 = ej;
+      ep.distance = distance;
+      pairs.push_back (ep);
+    }
+
+    sort (pairs.begin (), pairs.end (), compareDistances ());
+    if (pairs.size () > numberOfPairs)
+      pairs.resize (numberOfPairs);
+  }
+
+} /* namespace partest */
@@ -0,0 +1,73 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file NearestPairs.h
+ *
+ * @brief Approximate closest pairs of elements for very large schemes
+ */
+
+#ifndef NEARESTPAIRS_H_
+#define NEARESTPAIRS_H_
+
+#include "PartitioningScheme.h"
+#include "util/GlobalDefs.h"
+
+#include <vector>
+
+namespace partest
+{
+
+  /**
+   * @brief Approximate closest pairs of the elements of a scheme.
+   *
+   * Every element is embedded as a vector of its model parameters (rates,
+   * frequencies, alpha and, for a fixed topology, branch lengths) and
+   * indexed in a vantage-point tree. The candidate pairs are each element
+   * with its nearest neighbours in that space, which are then ranked by
+   * the exact distance of DistanceMatrix.
+   *
+   * This takes O(n k log n) time and O(n k) memory for n elements and k
+   * neighbours, instead of materializing the n^2 pairs. The protein matrix
+   * is not embedded, so it only takes part in the final ranking.
+   */
+  class NearestPairs
+  {
+  public:
+    /**
+     * @param[in] numberOfNeighbours Neighbours examined for each element
+     */
+    NearestPairs (size_t numberOfNeighbours);
+    virtual ~NearestPairs ();
+
+    /**
+     * @brief Gets the closest candidate pairs of elements, sorted by distance
+     *
+     * @param[in] scheme The optimized partitioning scheme
+     * @param[in] numberOfPairs Maximum number of pairs
+     * @param[out] pairs The closest pairs
+     */
+    void getClosestPairs (PartitioningScheme * scheme, size_t numberOfPairs,
+                          std::vector<elementPair> & pairs) const;
+  private:
+    size_t numberOfNeighbours;
+  };
+
+} /* namespace partest */
+
+#endif /* NEARESTPAIRS_H_ */
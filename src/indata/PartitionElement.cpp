@@ -18,7 +18,10 @@
 
 #include "PartitionElement.h"
 
+#include "indata/PartitionMap.h"
 #include "util/Utilities.h"
+#include "util/AsyncWriter.h"
+#include "util/CheckpointStore.h"
 
 #include <pll/parsePartition.h>
 #include <stdlib.h>
@@ -36,20 +39,160 @@ using namespace std;
 namespace partest
 {
 
-  PartitionElement::PartitionElement (t_partitionElementId _id) :
+  /* serializes accesses to the checkpoint files among worker threads */
+  static pthread_mutex_t ckpLock = PTHREAD_MUTEX_INITIALIZER;
+
+  /* whether this process stores the checkpoints of its results */
+  static bool ckpWritable = true;
+
+  /* the serialized results have a fixed layout, independent of the layout
+   * of the model objects: counts are 64-bit, followed by their values */
+  static void writeSize (ostream & out, size_t value)
+  {
+    uint64_t storedValue = (uint64_t) value;
+    out.write ((char *) &storedValue, (streamsize) sizeof(uint64_t));
+  }
+
+  static size_t readSize (istream & in)
+  {
+    uint64_t storedValue = 0;
+    in.read ((char *) &storedValue, (streamsize) sizeof(uint64_t));
+    return (size_t) storedValue;
+  }
+
+  static void writeDouble (ostream & out, double value)
+  {
+    out.write ((char *) &value, (streamsize) sizeof(double));
+  }
+
+  static double readDouble (istream & in)
+  {
+    double value = 0.0;
+    in.read ((char *) &value, (streamsize) sizeof(double));
+    return value;
+  }
+
+  static void writeDoubles (ostream & out, const double * values,
+                            size_t numberOfValues)
+  {
+    writeSize (out, numberOfValues);
+    if (numberOfValues)
+      out.write ((char *) values,
+                 (streamsize) (numberOfValues * sizeof(double)));
+  }
+
+  static bool readDoubles (istream & in, vector<double> & values)
+  {
+    size_t numberOfValues = readSize (in);
+    if (!in)
+      return false;
+    values.resize (numberOfValues);
+    if (numberOfValues)
+      in.read ((char *) &values[0],
+               (streamsize) (numberOfValues * sizeof(double)));
+    return in.good ();
+  }
+
+  static void writeModel (ostream & out, Model * model)
+  {
+    if (data_type == DT_NUCLEIC)
+      writeSize (out,
+                 (size_t) static_cast<NucleicModel *> (model)->getMatrix ());
+    else
+      writeSize (out,
+                 (size_t) static_cast<ProteicModel *> (model)->getMatrix ());
+    writeSize (out, (size_t) model->getRateVariation ());
+    writeDouble (out, model->getLnL ());
+    writeDouble (out, model->getAlpha ());
+#ifdef _IG_MODELS
+    writeDouble (out, model->getpInv());
+#else
+    writeDouble (out, 0.0);
+#endif
+    writeDouble (out, model->getBranchLengthsScaler ());
+    writeDoubles (out, model->getFrequencies (),
+                  (size_t) model->getNumberOfFrequencies ());
+    writeDoubles (out, model->getRates (),
+                  data_type == DT_NUCLEIC ? NUM_DNA_RATES : 0);
+    string modelTree = model->getTree ();
+    writeSize (out, modelTree.length ());
+    out.write (modelTree.data (), (streamsize) modelTree.length ());
+  }
+
+  /* returns 0 if the serialized model is corrupted */
+  static Model * readModel (istream & in)
+  {
+    vector<double> freqs, rates;
+    string tree;
+    size_t matrix = readSize (in);
+    bitMask rateVariation = (bitMask) readSize (in);
+    double lnL = readDouble (in);
+    double alpha = readDouble (in);
+    double pInv = readDouble (in);
+    double blScaler = readDouble (in);
+    if (!readDoubles (in, freqs) || !readDoubles (in, rates))
+      return 0;
+    size_t treeLength = readSize (in);
+    if (!in)
+      return 0;
+    tree.resize (treeLength);
+    if (treeLength)
+      in.read (&tree[0], (streamsize) treeLength);
+    if (!in)
+      return 0;
+
+    Model * model;
+    if (data_type == DT_NUCLEIC)
+    {
+      if (rates.size () != NUM_DNA_RATES)
+        return 0;
+      model = new NucleicModel (static_cast<NucMatrix> (matrix),
+                                rateVariation, (int) num_taxa);
+      model->setRates (&rates[0]);
+    }
+    else
+    {
+      model = new ProteicModel (static_cast<ProtMatrix> (matrix),
+                                rateVariation, (int) num_taxa);
+    }
+    if (freqs.size () != (size_t) model->getNumberOfFrequencies ())
+    {
+      delete model;
+      return 0;
+    }
+
+    model->setFrequencies (&freqs[0]);
+    if (model->isGamma ())
+      model->setAlpha (alpha);
+#ifdef _IG_MODELS
+    if (model->isPInv())
+    model->setpInv(pInv);
+#else
+    (void) pInv;
+#endif
+    model->setLnL (lnL);
+    model->setBranchLengthsScaler (blScaler);
+    model->setTree (tree);
+    return model;
+  }
+
+  PartitionElement::PartitionElement (const t_partitionElementId & _id) :
       ready (false), id (_id), sampleSize (0.0), treeManager (0), sections (
-          id.size ()), ckpLoaded (false), tag (false), branchLengths (0)
+          id.size ()), ckpLoaded (false), tag (false), finished (false), evicted (
+          false), branchLengths (0)
   {
 
+    pthread_mutex_init (&stateLock, NULL);
     this->bestModel = 0;
     models.reserve (number_of_models);
     numberOfSections = id.size ();
     numberOfSites = 0;
     numberOfPatterns = 0;
+    vector<size_t> genes = id.getGenes ();
     name.append ("(");
     for (size_t i = 0; i < numberOfSections; i++)
     {
-      size_t part = id.at (i);
+      size_t part = genes[i];
 
       sections[i].start = (size_t) pllPartitions->partitionData[part]->lower
           + 1;
@@ -63,42 +206,6 @@ namespace partest
     }
     name.append (")");
 
-    stringstream ss;
-    /* prefix */
-    ss << "pt_";
-    size_t maxId = id.at (id.size () - 1);
-    size_t numchars = (size_t) ceil ((maxId + 1) / 6.0);
-    size_t curPos = 0;
-    for (long currentChar = (long) numchars - 1; currentChar >= 0;
-        currentChar--)
-    {
-      size_t charRangeStart = 6 * (numchars - (size_t) currentChar - 1);
-      size_t charRangeEnd = 6 * (numchars - (size_t) currentChar);
-      int value = 0;
-      for (size_t k = charRangeStart; k < charRangeEnd; k++)
-      {
-        if (id[curPos] == k)
-        {
-          value += Utilities::binaryPow (k - charRangeStart);
-          curPos++;
-          if (k == maxId)
-            break;
-        }
-      }
-      ss << Utilities::toBase64 (value);
-    }
-    string sstr = ss.str ();
-    if (sstr.length () < MAX_FILE_LENGTH)
-    {
-      ckpname = ss.str ();
-      ckphash = "";
-    }
-    else
-    {
-      ckpname = sstr.substr (0, MAX_FILE_LENGTH);
-      ckphash = sstr.substr (MAX_FILE_LENGTH, MAX_FILE_LENGTH - sstr.length ());
-    }
-
     sampleSize = numberOfSites;
 
     loadData ();
@@ -108,7 +215,7 @@ namespace partest
   {
     if (!isOptimized ())
     {
-      treeManager = new PllTreeManager (id, phylip, sections, numberOfSites);
+      treeManager = static_cast<PllTreeManager *> (createTreeManager ());
       numberOfPatterns = treeManager->getNumberOfPatterns ();
 
       if (models.size () == 0)
@@ -195,7 +302,9 @@ namespace partest
       }
     }
 
+    pthread_mutex_lock (&stateLock);
     ready = true;
+    pthread_mutex_unlock (&stateLock);
     return EX_OK;
   }
 
@@ -210,7 +319,9 @@ namespace partest
     delete treeManager;
     treeManager = 0;
 
+    pthread_mutex_lock (&stateLock);
     ready = false;
+    pthread_mutex_unlock (&stateLock);
 
     return EX_OK;
 
@@ -232,6 +343,7 @@ namespace partest
     }
     delete bestModel;
 
+    pthread_mutex_destroy (&stateLock);
   }
 
   TreeManager * PartitionElement::getTreeManager (void)
@@ -244,8 +356,14 @@ namespace partest
     return treeManager;
   }
 
+  TreeManager * PartitionElement::createTreeManager (void) const
+  {
+    return new PllTreeManager (id, phylip, sections, numberOfSites);
+  }
+
   double * PartitionElement::getBranchLengths (void)
   {
+    ensureResident ();
     if (starting_topology == StartTopoFIXED && !branchLengths && ready)
     {
       /* if topology is fixed for each element, keep the branch lengths */
@@ -256,6 +374,7 @@ namespace partest
 
   vector<Model *> PartitionElement::getModels (void) const
   {
+    ensureResident ();
     if (models.size () == 0)
     {
       cerr << "[ERROR] Models are not ready" << endl;
@@ -266,6 +385,7 @@ namespace partest
 
   size_t PartitionElement::getNumberOfModels (void) const
   {
+    ensureResident ();
     return models.size ();
   }
 
@@ -295,6 +415,7 @@ namespace partest
 
   Model * PartitionElement::getModel (size_t index)
   {
+    ensureResident ();
     if (index >= models.size ())
     {
       cerr << "[ERROR] Model " << index << " is above the number of models ("
@@ -313,14 +434,22 @@ namespace partest
     }
     this->bestModel = model->clone ();
 
+    /* set after every model, so other threads never see a partial result */
+    pthread_mutex_lock (&stateLock);
+    finished = true;
+    pthread_mutex_unlock (&stateLock);
+
     if (!ckpLoaded)
     {
       storeData ();
+      if (id.size () > 1)
+        PartitionMap::getInstance ()->updateResident (this);
     }
   }
 
   SelectionModel * PartitionElement::getBestModel (void)
   {
+    ensureResident ();
     if (!bestModel)
     {
       cerr << "[ERROR] BestModel has not been set." << endl;
@@ -331,6 +460,7 @@ namespace partest
 
   double PartitionElement::getLnL (void) const
   {
+    ensureResident ();
     return bestModel->getModel ()->getLnL ();
   }
 
@@ -341,12 +471,47 @@ namespace partest
 
   bool PartitionElement::isReady (void)
   {
-    return ready;
+    pthread_mutex_lock (&stateLock);
+    bool isready = ready;
+    pthread_mutex_unlock (&stateLock);
+    return isready;
+  }
+
+  void PartitionElement::setTagged (bool tag_status)
+  {
+    pthread_mutex_lock (&stateLock);
+    tag = tag_status;
+    pthread_mutex_unlock (&stateLock);
+  }
+
+  bool PartitionElement::isTagged (void)
+  {
+    pthread_mutex_lock (&stateLock);
+    bool tagged = tag;
+    pthread_mutex_unlock (&stateLock);
+    return tagged;
+  }
+
+  bool PartitionElement::tryTag (void)
+  {
+    bool tagged = false;
+    pthread_mutex_lock (&stateLock);
+    if (!(tag || finished))
+    {
+      tag = true;
+      tagged = true;
+    }
+    pthread_mutex_unlock (&stateLock);
+    return tagged;
   }
 
   bool PartitionElement::isOptimized (void)
   {
-    return (models.size () > 0) && (models.at (0)->isOptimized ());
+    /* evicted elements stay finished */
+    pthread_mutex_lock (&stateLock);
+    bool isfinished = finished;
+    pthread_mutex_unlock (&stateLock);
+    return isfinished;
   }
 
   double PartitionElement::getEpsilon (void)
@@ -366,214 +531,122 @@ namespace partest
 
   int PartitionElement::loadData (void)
   {
-    if (!ckpAvailable)
-      return CHECKPOINT_UNAVAILABLE;
+    pthread_mutex_lock (&ckpLock);
+    int ckpStatus = readCheckpoint ();
+    pthread_mutex_unlock (&ckpLock);
+    return ckpStatus;
+  }
 
-    const char * ckpFilename = (ckpPath + os_separator + ckpname).c_str ();
-    fstream ofs (ckpFilename, ios::in);
-    ofs.seekg (0, ios_base::beg);
+  int PartitionElement::storeData (void)
+  {
+    pthread_mutex_lock (&ckpLock);
+    int ckpStatus = writeCheckpoint ();
+    pthread_mutex_unlock (&ckpLock);
+    return ckpStatus;
+  }
 
-    if (!ofs)
-      return CHECKPOINT_UNEXISTENT;
+  size_t PartitionElement::getMemoryFootprint (void) const
+  {
+    size_t modelSize =
+        data_type == DT_NUCLEIC ? sizeof(NucleicModel) : sizeof(ProteicModel);
+    size_t numberOfValues =
+        data_type == DT_NUCLEIC ?
+            NUM_NUC_FREQS + NUM_DNA_RATES : NUM_PROT_FREQS;
 
-    streampos curpos = 0;
-    while (!ofs.eof () && !ckpLoaded)
+    size_t footprint = 0;
+    for (size_t i = 0; i < models.size (); i++)
     {
-      ofs.seekg (curpos, ios_base::cur);
-      size_t ckpSize;
-      ofs.read ((char *) &(ckpSize), (streamsize) sizeof(size_t));
+      footprint += modelSize + numberOfValues * sizeof(double)
+          + models[i]->getTree ().size ();
+    }
+    if (bestModel)
+      footprint += sizeof(SelectionModel);
+    if (branchLengths)
+      footprint += (size_t) Utilities::numberOfBranches ((int) num_taxa)
+          * sizeof(double);
+    return footprint;
+  }
 
-      size_t hashlen;
-      ofs.read ((char *) &hashlen, (streamsize) sizeof(size_t));
-      if (hashlen > 0)
-      {
-        char * charhash = (char *) malloc (hashlen + 1);
-        ofs.read ((char *) charhash, (streamsize) hashlen);
-        charhash[hashlen] = '\0';
-        if (!strcmp (charhash, ckphash.c_str ()))
-        {
-          ckpLoaded = true;
-        }
-      }
-      else if (ckphash == "")
-      {
-        ckpLoaded = true;
-      }
+  bool PartitionElement::evict (void)
+  {
+    /* data must be already in the checkpoint and not in use */
+    if (!ckpAvailable || evicted || ready || !isOptimized ())
+      return false;
 
-      if (!ckpLoaded)
-      {
-        if (ckpSize <= 0)
-        {
-          cerr << "ERROR LOADING CHECKPOINTS" << endl;
-          exit_partest (EX_SOFTWARE);
-        }
-        curpos = (streampos) ckpSize - (streampos) hashlen
-            - (streampos) sizeof(size_t);
-      }
+    pthread_mutex_lock (&ckpLock);
+    for (size_t i = 0; i < models.size (); i++)
+    {
+      delete models[i];
     }
-
-    if (ckpLoaded)
+    models.clear ();
+    delete bestModel;
+    bestModel = 0;
+    if (branchLengths)
     {
-      ofs.read ((char *) &(numberOfSections), (streamsize) sizeof(size_t));
-      ofs.read ((char *) &(numberOfSites), (streamsize) sizeof(size_t));
-      ofs.read ((char *) &(numberOfPatterns), (streamsize) sizeof(size_t));
-      size_t ckpNumberOfModels;
-      ofs.read ((char *) &(ckpNumberOfModels), (streamsize) sizeof(size_t));
+      free (branchLengths);
+      branchLengths = 0;
+    }
+    ckpLoaded = false;
+    evicted = true;
+    pthread_mutex_unlock (&ckpLock);
 
-      if (ckpNumberOfModels != number_of_models)
-      {
-        if (!force_overriding)
-        {
-          cerr << "[ERROR]   ";
-        }
-        else
-        {
-          cerr << "[WARNING] ";
-        }
-        cerr
-            << "Number of models in checkpoint files does not match the expected number"
-            << endl;
-        cerr
-            << "          of models. Configuration might changed. Checkpoint loading for this "
-            << endl;
-        cerr << number_of_models << " instead of " << ckpNumberOfModels << endl;
-        cerr << "          element was aborted." << endl;
-        if (force_overriding)
-        {
-          ckpLoaded = false;
-          ofs.close ();
-          /* deleting checkpoint file */
-          if (remove (ckpFilename))
-          {
-            cerr << "[ERROR] There was an error removing checkointing file "
-                << ckpFilename << ". Please remove it manually and try again."
-                << endl;
-            exit_partest (EX_IOERR);
-          }
-        }
-        else
-        {
-          cerr << endl
-              << "If you really want to proceed, remove checkpointing files or re-run with --force-override, --disable-output or --disable-ckp arguments."
-              << endl << endl;
-          exit_partest (EX_IOERR);
-        }
-        return CHECKPOINT_UNEXISTENT;
-      }
-      size_t modelSize =
-          data_type == DT_NUCLEIC ? sizeof(NucleicModel) : sizeof(ProteicModel);
-      for (size_t i = 0; i < number_of_models; i++)
-      {
-        Model * model = 0;
-        switch (data_type)
-          {
-          case DT_NUCLEIC:
-            model = (NucleicModel *) alloca(modelSize);
-            break;
-          case DT_PROTEIC:
-            model = (ProteicModel *) alloca(modelSize);
-            break;
-          default:
-            assert(0);
-          }
+    return true;
+  }
 
-        ofs.read ((char *) model, (streamsize) modelSize);
-        double * freqs = (double *) alloca(
-            (size_t )model->getNumberOfFrequencies () * sizeof(double));
-        ofs.read (
-            (char *) freqs,
-            (streamsize) ((size_t) model->getNumberOfFrequencies ()
-                * sizeof(double)));
-
-        double * rates = 0;
-        if (data_type == DT_NUCLEIC)
-        {
-          rates = (double *) alloca(NUM_DNA_RATES * sizeof(double));
-          ofs.read ((char *) rates,
-                    (streamsize) (NUM_DNA_RATES * sizeof(double)));
-          //model->setRates(rates);
-        }
-        size_t len_tree;
-        ofs.read ((char *) &len_tree, sizeof(size_t));
-
-        char * ctree = (char *) malloc (len_tree);
-
-        ofs.read ((char *) ctree, (streamsize) len_tree);
-        if (data_type == DT_NUCLEIC)
-        {
-          NucleicModel * finalModel = new NucleicModel (
-              ((NucleicModel *) model)->getMatrix (),
-              model->getRateVariation (), (int) num_taxa);
-          finalModel->setFrequencies (freqs);
-          finalModel->setRates (rates);
-          if (model->isGamma ())
-            finalModel->setAlpha (model->getAlpha ());
-#ifdef _IG_MODELS
-          if (model->isPInv())
-          finalModel->setpInv(model->getpInv());
-#endif
-          finalModel->setLnL (model->getLnL ());
-          finalModel->setTree (ctree);
-          models.push_back (finalModel);
-        }
-        else
-        {
-          ProteicModel * finalModel = new ProteicModel (
-              ((ProteicModel *) model)->getMatrix (),
-              model->getRateVariation (), (int) num_taxa);
-          finalModel->setFrequencies (freqs);
-          if (model->isGamma ())
-            finalModel->setAlpha (model->getAlpha ());
-#ifdef _IG_MODELS
-          if (model->isPInv())
-          finalModel->setpInv(model->getpInv());
-#endif
-          finalModel->setLnL (model->getLnL ());
-          finalModel->setTree (ctree);
-          models.push_back (finalModel);
-        }
-        free (ctree);
-      }
-      int bestModelIndex;
-      ofs.read ((char *) &bestModelIndex, (streamsize) sizeof(int));
-
-      SelectionModel * sm = (SelectionModel *) alloca(sizeof(SelectionModel));
-      ofs.read ((char *) sm, sizeof(SelectionModel));
-      SelectionModel * selectionmodel = new SelectionModel (
-          models.at ((size_t) bestModelIndex), sm->getValue ());
-      selectionmodel->setWeight (sm->getWeight ());
-      selectionmodel->setCumWeight (sm->getCumWeight ());
-      selectionmodel->setDelta (sm->getDelta ());
-      selectionmodel->setBicScore (sm->getBicScore ());
-      selectionmodel->setAicScore (sm->getAicScore ());
-      selectionmodel->setAiccScore (sm->getAiccScore ());
-      selectionmodel->setIndex (bestModelIndex);
-      setBestModel (selectionmodel);
-      delete selectionmodel;
-    }
+  void PartitionElement::ensureResident (void) const
+  {
+    if (!evicted)
+      return;
 
-    /* branch lengths */
-    size_t numBranches;
-    ofs.read ((char *) &numBranches, (streamsize) sizeof(size_t));
-    if (numBranches)
+    PartitionElement * self = const_cast<PartitionElement *> (this);
+    bool reloaded = false;
+    pthread_mutex_lock (&ckpLock);
+    if (evicted)
     {
-      if (branchLengths)
+      int ckpStatus = self->readCheckpoint ();
+      if (ckpStatus != CHECKPOINT_LOADED)
       {
-        free (branchLengths);
+        cerr << "[ERROR] Cannot reload evicted element " << name
+            << " from checkpoint" << endl;
+        exit_partest (EX_IOERR);
       }
-      branchLengths = (double *) malloc (numBranches * sizeof(double));
-      ofs.read ((char *) branchLengths,
-                (streamsize) (numBranches * sizeof(double)));
+      self->evicted = false;
+      reloaded = true;
     }
-    ofs.close ();
-    return ckpLoaded ? CHECKPOINT_LOADED : CHECKPOINT_UNEXISTENT;
+    pthread_mutex_unlock (&ckpLock);
+
+    if (reloaded)
+      PartitionMap::getInstance ()->updateResident (self);
   }
 
-  int PartitionElement::storeData (void)
+  int PartitionElement::readCheckpoint (void)
   {
     if (!ckpAvailable)
       return CHECKPOINT_UNAVAILABLE;
 
+    /* the record might be still queued for writing */
+    string payload;
+    if (!AsyncWriter::getInstance ()->find (id, payload)
+        && !CheckpointStore::getInstance ()->load (id, payload))
+      return CHECKPOINT_UNEXISTENT;
+
+    /* the loaded result must not be stored again */
+    ckpLoaded = true;
+    istringstream in (payload, ios::in | ios::binary);
+    if (readResult (in) != number_of_models)
+    {
+      cerr << "[ERROR] Corrupted checkpoint record for element " << name
+          << endl;
+      exit_partest (EX_IOERR);
+    }
+    return CHECKPOINT_LOADED;
+  }
+
+  int PartitionElement::writeCheckpoint (void)
+  {
+    if (!ckpAvailable || !ckpWritable)
+      return CHECKPOINT_UNAVAILABLE;
+
     if (!isOptimized ())
     {
       cerr
@@ -588,93 +661,184 @@ namespace partest
       branchLengths = treeManager->getBranchLengths ();
     }
 
-    fstream ofs ((ckpPath + os_separator + ckpname).c_str (),
-                 ios::in | ios::out | ios::app);
+    /* written in the background, together with other records */
+    ostringstream out (ios::out | ios::binary);
+    writeResult (out);
+    AsyncWriter::getInstance ()->store (id, out.str ());
 
-    //ofs.open((ckpPath + os_separator + ckpname).c_str());
-    size_t modelSize =
-        data_type == DT_NUCLEIC ? sizeof(NucleicModel) : sizeof(ProteicModel);
-    int numberOfFrequencies = data_type == DT_NUCLEIC ?
-    NUM_NUC_FREQS :
-                                                        NUM_PROT_FREQS;
-    int numberOfRates = data_type == DT_NUCLEIC ?
-    NUM_DNA_RATES :
-                                                  0;
-
-    size_t treeStrLen = 0;
-    for (size_t i = 0; i < models.size (); i++)
+    return CHECKPOINT_SAVED;
+  }
+
+  size_t PartitionElement::readResult (istream & in)
+  {
+    /* the layout is known since construction, and other threads might be
+     * reading it to estimate costs */
+    size_t storedNumberOfSections = readSize (in);
+    size_t storedNumberOfSites = readSize (in);
+    numberOfPatterns = readSize (in);
+    size_t storedNumberOfModels = readSize (in);
+    if (!in || storedNumberOfSections != numberOfSections
+        || storedNumberOfSites != numberOfSites)
+      return 0;
+    if (storedNumberOfModels != number_of_models)
+      return storedNumberOfModels;
+
+    for (size_t i = 0; i < number_of_models; i++)
     {
-      treeStrLen += models[i]->getTree ().size () + 1;
-    }
-    size_t hashlen = ckphash.length ();
-    size_t ckpSize = 6 * sizeof(size_t) + hashlen + treeStrLen
-        + models.size ()
-            * (modelSize + sizeof(size_t)
-                + ((size_t) (numberOfFrequencies + numberOfRates))
-                    * sizeof(double)) + sizeof(int) + sizeof(SelectionModel)
-        + (branchLengths ?
-            (size_t) Utilities::numberOfBranches ((int) num_taxa)
-                * sizeof(double) :
-            sizeof(size_t));
-    ofs.write ((char *) &ckpSize, sizeof(size_t));
-    ofs.write ((char *) &hashlen, sizeof(size_t));
-    if (hashlen > 0)
-    {
-      ofs.write ((char *) ckphash.c_str (), hashlen);
-    }
-    ofs.write ((char *) &numberOfSections, sizeof(size_t));
-    ofs.write ((char *) &numberOfSites, (streamsize) sizeof(size_t));
-    ofs.write ((char *) &numberOfPatterns, (streamsize) sizeof(size_t));
-    ofs.write ((char *) &number_of_models, (streamsize) sizeof(size_t));
-    int bestModelIndex = 0;
-    for (size_t i = 0; i < models.size (); i++)
+      Model * model = readModel (in);
+      if (!model)
+        return 0;
+      models.push_back (model);
+    }
+
+    size_t bestModelIndex = readSize (in);
+    double value = readDouble (in);
+    double weight = readDouble (in);
+    double cumWeight = readDouble (in);
+    double delta = readDouble (in);
+    double bicScore = readDouble (in);
+    double aicScore = readDouble (in);
+    double aiccScore = readDouble (in);
+    double dtScore = readDouble (in);
+
+    /* branch lengths must be in place before storing the best model */
+    vector<double> storedBranchLengths;
+    if (!readDoubles (in, storedBranchLengths)
+        || bestModelIndex >= models.size ())
+      return 0;
+    if (storedBranchLengths.size ())
     {
-      Model * model = models.at (i);
-      if (model == getBestModel ()->getModel ())
+      if (branchLengths)
       {
-        bestModelIndex = (int) i;
+        free (branchLengths);
       }
-      model->setFrequencies (model->getFrequencies ());
-      ofs.write ((char *) model, (streamsize) modelSize);
+      branchLengths = (double *) malloc (
+          storedBranchLengths.size () * sizeof(double));
+      memcpy (branchLengths, &storedBranchLengths[0],
+              storedBranchLengths.size () * sizeof(double));
+    }
 
-      assert(numberOfFrequencies == model->getNumberOfFrequencies ());
-      ofs.write (
-          (char *) model->getFrequencies (),
-          (streamsize) ((size_t) model->getNumberOfFrequencies ()
-              * sizeof(double)));
+    SelectionModel * selectionmodel = new SelectionModel (
+        models.at (bestModelIndex), value);
+    selectionmodel->setWeight (weight);
+    selectionmodel->setCumWeight (cumWeight);
+    selectionmodel->setDelta (delta);
+    selectionmodel->setBicScore (bicScore);
+    selectionmodel->setAicScore (aicScore);
+    selectionmodel->setAiccScore (aiccScore);
+    selectionmodel->setDTScore (dtScore);
+    selectionmodel->setIndex ((int) bestModelIndex);
+    setBestModel (selectionmodel);
+    delete selectionmodel;
+
+    return storedNumberOfModels;
+  }
 
-      if (data_type == DT_NUCLEIC)
+  void PartitionElement::writeResult (ostream & out)
+  {
+    writeSize (out, numberOfSections);
+    writeSize (out, numberOfSites);
+    writeSize (out, numberOfPatterns);
+    writeSize (out, number_of_models);
+    size_t bestModelIndex = 0;
+    for (size_t i = 0; i < models.size (); i++)
+    {
+      Model * model = models.at (i);
+      if (model == getBestModel ()->getModel ())
       {
-        ofs.write ((char *) model->getRates (),
-                   (streamsize) (NUM_DNA_RATES * sizeof(double)));
+        bestModelIndex = i;
       }
-      size_t tree_len = strlen (model->getTree ().c_str ()) + 1;
-      ofs.write ((char *) &tree_len, (streamsize) sizeof(size_t));
-      ofs.write ((char *) model->getTree ().c_str (), (streamsize) tree_len);
+
+      writeModel (out, model);
     }
+
     /* best model */
     SelectionModel * selectionmodel = getBestModel ();
-    ofs.write ((char *) &bestModelIndex, (streamsize) sizeof(int));
-    ofs.write ((char *) selectionmodel, (streamsize) sizeof(SelectionModel));
+    writeSize (out, bestModelIndex);
+    writeDouble (out, selectionmodel->getValue ());
+    writeDouble (out, selectionmodel->getWeight ());
+    writeDouble (out, selectionmodel->getCumWeight ());
+    writeDouble (out, selectionmodel->getDelta ());
+    writeDouble (out, selectionmodel->getBicScore ());
+    writeDouble (out, selectionmodel->getAicScore ());
+    writeDouble (out, selectionmodel->getAiccScore ());
+    writeDouble (out, selectionmodel->getDTScore ());
 
     /* branch lengths */
-    if (branchLengths)
+    writeDoubles (
+        out, branchLengths,
+        branchLengths ?
+            (size_t) Utilities::numberOfBranches ((int) num_taxa) : 0);
+  }
+
+  void PartitionElement::packResult (string & buffer)
+  {
+    if (!isOptimized ())
     {
-      size_t numBranches = (size_t) Utilities::numberOfBranches (
-          (int) num_taxa);
-      ofs.write ((char *) &numBranches, (streamsize) sizeof(size_t));
-      ofs.write ((char *) branchLengths,
-                 (streamsize) (numBranches * sizeof(double)));
+      cerr
+          << "[INTERNAL_ERROR] Attempting to pack unoptimized Partition Element"
+          << endl;
+      exit_partest (EX_SOFTWARE);
     }
-    else
+    ostringstream out (ios::out | ios::binary);
+    writeResult (out);
+    buffer = out.str ();
+  }
+
+  void PartitionElement::unpackResult (const char * buffer, size_t length)
+  {
+    istringstream in (string (buffer, length), ios::in | ios::binary);
+    if (readResult (in) != number_of_models)
     {
-      size_t zero = 0;
-      ofs.write ((char *) &zero, (streamsize) sizeof(size_t));
+      cerr << "[ERROR] Corrupted optimization result for element " << name
+          << endl;
+      exit_partest (EX_SOFTWARE);
     }
+  }
+
+  void PartitionElement::storeModel (size_t index)
+  {
+    /* forked workers store them too, their elements are lost otherwise */
+    if (!ckpAvailable)
+      return;
 
-    ofs.close ();
+    ostringstream out (ios::out | ios::binary);
+    writeModel (out, models.at (index));
+    AsyncWriter::getInstance ()->store (id, out.str (), index + 1);
+  }
 
-    return CHECKPOINT_SAVED;
+  bool PartitionElement::loadModel (size_t index)
+  {
+    if (!ckpAvailable)
+      return false;
+
+    string payload;
+    if (!AsyncWriter::getInstance ()->find (id, payload, index + 1)
+        && !CheckpointStore::getInstance ()->load (id, payload, index + 1))
+      return false;
+
+    istringstream in (payload, ios::in | ios::binary);
+    Model * model = readModel (in);
+    if (!model)
+    {
+      cerr << "[WARNING] Corrupted checkpoint record for model " << index
+          << " of element " << name << endl;
+      return false;
+    }
+    if (model->getRateVariation () != models.at (index)->getRateVariation ())
+    {
+      delete model;
+      return false;
+    }
+
+    delete models[index];
+    models[index] = model;
+    return true;
+  }
+
+  void PartitionElement::disableCheckpointWrites (void)
+  {
+    ckpWritable = false;
   }
 
   void PartitionElement::print (ostream & out)
@@ -31,8 +31,10 @@
 #include "model/NucleicModel.h"
 #include "model/ProteicModel.h"
 
+#include <iostream>
 #include <string>
 #include <vector>
+#include <pthread.h>
 
 namespace partest
 {
@@ -41,8 +43,8 @@ namespace partest
   {
 
   public:
-    PartitionElement (t_partitionElementId id);
-    t_partitionElementId getId (void)
+    PartitionElement (const t_partitionElementId & id);
+    const t_partitionElementId & getId (void) const
     {
       return id;
     }
@@ -70,28 +72,128 @@ namespace partest
 
     double * getBranchLengths (void);
 
-    void setTagged (bool tag_status)
-    {
-      tag = tag_status;
-    }
-    bool isTagged ()
-    {
-      return tag;
-    }
+    void setTagged (bool tag_status);
+    bool isTagged (void);
+
+    /**
+     * @brief Atomically tags the element for optimization
+     *
+     * @return true, if the element was neither optimized nor tagged before
+     */
+    bool tryTag (void);
 
     bool isReady (void);
+
+    /**
+     * @brief Checks whether every model is optimized and the best one is
+     * selected. Elements with only some of their models optimized, e.g., by
+     * model replicas or after a resume, are not finished yet.
+     */
     bool isOptimized (void);
     double getEpsilon (void);
 
     TreeManager * getTreeManager (void);
 
+    /**
+     * @brief Builds a new tree manager for the element data
+     *
+     * @return A new tree manager, that must be deleted by the caller
+     */
+    TreeManager * createTreeManager (void) const;
+
     double getSampleSize (void);
 
     int loadData (void);
     int storeData (void);
 
+    /**
+     * @brief Serializes the optimized data, e.g., for sending it through MPI
+     *
+     * The buffer follows the checkpoint record layout.
+     *
+     * @param[out] buffer The serialized data
+     */
+    void packResult (std::string & buffer);
+
+    /**
+     * @brief Restores the optimized data serialized with packResult
+     *
+     * @param[in] buffer The serialized data
+     * @param[in] length Length of the buffer in bytes
+     */
+    void unpackResult (const char * buffer, size_t length);
+
+    /**
+     * @brief Stores the optimized parameters of a single model, so that an
+     * interrupted element resumes from its finished models
+     *
+     * @param[in] index The model index
+     */
+    void storeModel (size_t index);
+
+    /**
+     * @brief Restores a model stored with storeModel
+     *
+     * The structures of the element must be already set up.
+     *
+     * @param[in] index The model index
+     *
+     * @return true, if the model was restored
+     */
+    bool loadModel (size_t index);
+
+    /**
+     * @brief Stops writing checkpoints from this process, e.g., in worker
+     * processes whose results are stored by their parent
+     */
+    static void disableCheckpointWrites (void);
+
+    /**
+     * @brief Gets the approximate memory used by the optimized data
+     */
+    size_t getMemoryFootprint (void) const;
+
+    /**
+     * @brief Releases the optimized data, which is stored in the checkpoint.
+     *
+     * Evicted data is transparently reloaded from the checkpoint the next
+     * time it is accessed.
+     *
+     * @return true, if the data was released
+     */
+    bool evict (void);
+
+    bool isEvicted (void) const
+    {
+      return evicted;
+    }
+
     void print (std::ostream & out);
   private:
+    int readCheckpoint (void);
+    int writeCheckpoint (void);
+
+    /**
+     * @brief Reads the optimized data of a checkpoint record
+     *
+     * @return The number of models in the record, or 0 if the record is
+     * corrupted. If it does not match the current number of models, no model
+     * is read.
+     */
+    size_t readResult (std::istream & in);
+
+    /**
+     * @brief Writes the optimized data of a checkpoint record
+     */
+    void writeResult (std::ostream & out);
+
+    /**
+     * @brief Reloads the evicted data, if needed
+     */
+    void ensureResident (void) const;
+
+    /** Lock for the state shared among worker threads */
+    pthread_mutex_t stateLock;
 
     bool ready;
 
@@ -104,7 +206,7 @@ namespace partest
     std::vector<Model *> models;
     SelectionModel * bestModel;
 
-    std::string name, ckpname, ckphash;
+    std::string name;
     double sampleSize;
 
     PllTreeManager * treeManager;
@@ -113,6 +215,8 @@ namespace partest
 
     bool ckpLoaded;
     bool tag;
+    bool finished; /** Whether the best model is selected */
+    bool evicted; /** Whether the optimized data was released */
 
     double * branchLengths;
   };
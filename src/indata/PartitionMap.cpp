@@ -38,30 +38,148 @@ namespace partest
   PartitionMap::PartitionMap ()
   {
     _keep.reserve (number_of_genes);
-    partitions = new vector<partitionMappingInfo> (
-        (size_t) pllPartitions->numberOfPartitions);
     numberOfElements = numberOfPartitions =
         (size_t) pllPartitions->numberOfPartitions;
+    singleGeneElements.resize (numberOfPartitions);
     for (size_t i = 0; i < numberOfPartitions; i++)
     {
-      t_partitionElementId nextId;
-      nextId.push_back (i);
-      partitions->at (i).partitionId = nextId;
-      partitions->at (i).partitionElement = new PartitionElement (nextId);
+      t_partitionElementId nextId = PartitionElementId::singleGene (i);
+      singleGeneElements[i] = new PartitionElement (nextId);
     }
+    slots.resize (PARTITION_MAP_INITIAL_SLOTS);
+    residentBytes = 0;
+    pthread_mutex_init (&mapLock, NULL);
   }
 
   PartitionMap::~PartitionMap ()
   {
-    for (size_t i = 0; i < numberOfElements; i++)
+    for (size_t i = 0; i < numberOfPartitions; i++)
+    {
+      delete singleGeneElements[i];
+    }
+    for (size_t i = 0; i < slots.size (); i++)
+    {
+      if (slots[i].partitionElement)
+        delete slots[i].partitionElement;
+    }
+    pthread_mutex_destroy (&mapLock);
+  }
+
+  size_t PartitionMap::findSlot (const t_partitionElementId & id,
+                                 size_t hash) const
+  {
+    /* linear probing, the table is never more than half full */
+    size_t mask = slots.size () - 1;
+    size_t slot = hash & mask;
+    while (slots[slot].partitionElement)
+    {
+      if (slots[slot].hash == hash
+          && slots[slot].partitionElement->getId () == id)
+        break;
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  void PartitionMap::insertElement (PartitionElement * element)
+  {
+    size_t numberOfMerged = numberOfElements - numberOfPartitions;
+    if (2 * (numberOfMerged + 1) > slots.size ())
+    {
+      /* grow and rehash */
+      vector<partitionMappingInfo> oldSlots (slots.size () * 2);
+      oldSlots.swap (slots);
+      for (size_t i = 0; i < oldSlots.size (); i++)
+      {
+        if (oldSlots[i].partitionElement)
+        {
+          slots[findSlot (oldSlots[i].partitionElement->getId (),
+                          oldSlots[i].hash)] = oldSlots[i];
+        }
+      }
+    }
+
+    size_t hash = element->getId ().hash ();
+    size_t slot = findSlot (element->getId (), hash);
+    assert(!slots[slot].partitionElement);
+    slots[slot].hash = hash;
+    slots[slot].partitionElement = element;
+    numberOfElements++;
+  }
+
+  void PartitionMap::eraseSlot (size_t slot)
+  {
+    /* backward shift deletion keeps the probe sequences unbroken */
+    size_t mask = slots.size () - 1;
+    size_t hole = slot;
+    size_t next = (hole + 1) & mask;
+    while (slots[next].partitionElement)
     {
-      delete partitions->at (i).partitionElement;
+      size_t home = slots[next].hash & mask;
+      if (((next - home) & mask) >= ((next - hole) & mask))
+      {
+        slots[hole] = slots[next];
+        hole = next;
+      }
+      next = (next + 1) & mask;
     }
-    delete partitions;
+    slots[hole] = partitionMappingInfo ();
+    numberOfElements--;
+  }
+
+  void PartitionMap::releaseSlot (partitionMappingInfo & slot)
+  {
+    if (slot.resident)
+    {
+      lru.erase (slot.lruPosition);
+      residentBytes -= slot.footprint;
+      slot.resident = false;
+      slot.footprint = 0;
+    }
+  }
+
+  void PartitionMap::updateResident (PartitionElement * element)
+  {
+    pthread_mutex_lock (&mapLock);
+    partitionMappingInfo & slot = slots[findSlot (element->getId (),
+                                                  element->getId ().hash ())];
+    if (slot.partitionElement == element)
+    {
+      releaseSlot (slot);
+      slot.footprint = element->getMemoryFootprint ();
+      slot.resident = true;
+      slot.lruPosition = lru.insert (lru.begin (), element);
+      residentBytes += slot.footprint;
+    }
+    pthread_mutex_unlock (&mapLock);
+  }
+
+  void PartitionMap::enforceMemoryBudget (void)
+  {
+    if (!map_memory_budget || !ckpAvailable)
+      return;
+
+    pthread_mutex_lock (&mapLock);
+    list<PartitionElement *>::iterator it = lru.end ();
+    while (residentBytes > map_memory_budget && it != lru.begin ())
+    {
+      --it;
+      PartitionElement * element = *it;
+      partitionMappingInfo & slot = slots[findSlot (element->getId (),
+                                                    element->getId ().hash ())];
+      if (element->evict ())
+      {
+        residentBytes -= slot.footprint;
+        slot.resident = false;
+        slot.footprint = 0;
+        it = lru.erase (it);
+      }
+    }
+    pthread_mutex_unlock (&mapLock);
   }
 
   PartitionElement * PartitionMap::getPartitionElement (
-      t_partitionElementId partitionId)
+      const t_partitionElementId & partitionId)
   {
 
     if (!partitionId.size ())
@@ -72,43 +190,61 @@ namespace partest
 
     if (partitionId.size () == 1)
     {
-      return partitions->at (partitionId.at (0)).partitionElement;
+      return singleGeneElements.at (partitionId.front ());
     }
 
-    sort (partitionId.begin (), partitionId.end ());
-
-    /* search for element */
-    for (size_t i = 0; i < partitions->size (); i++)
+    /* lookup and creation form a single critical section, so concurrent
+     * workers never build the same element twice */
+    pthread_mutex_lock (&mapLock);
+    size_t slot = findSlot (partitionId, partitionId.hash ());
+    PartitionElement * element = slots[slot].partitionElement;
+    if (element)
     {
-      partitionMappingInfo pInfo = partitions->at (i);
-      if (pInfo.partitionId == partitionId)
+      if (slots[slot].resident)
       {
-        return pInfo.partitionElement;
+        /* most recently used */
+        lru.splice (lru.begin (), lru, slots[slot].lruPosition);
       }
     }
+    else
+    {
+      /* we need to merge partitions */
+      element = new PartitionElement (partitionId);
+      insertElement (element);
 
-    /* we need to merge partitions */
-    partitionMappingInfo pInfo;
-    pInfo.partitionId = partitionId;
-
-    pInfo.partitionElement = new PartitionElement (partitionId);
-
-    partitions->push_back (pInfo);
-    numberOfElements++;
+      if (element->isOptimized ())
+      {
+        /* loaded from checkpoint */
+        partitionMappingInfo & newSlot = slots[findSlot (partitionId,
+                                                         partitionId.hash ())];
+        newSlot.footprint = element->getMemoryFootprint ();
+        newSlot.resident = true;
+        newSlot.lruPosition = lru.insert (lru.begin (), element);
+        residentBytes += newSlot.footprint;
+      }
+    }
+    pthread_mutex_unlock (&mapLock);
 
-    return pInfo.partitionElement;
+    return element;
   }
 
-  void PartitionMap::deletePartitionElement (t_partitionElementId id)
+  void PartitionMap::deletePartitionElement (const t_partitionElementId & id)
   {
 
-    for (size_t i = numberOfPartitions; i < numberOfElements; i++)
+    if (id.size () > 1)
     {
-      if (partitions->at (i).partitionId == id)
+      pthread_mutex_lock (&mapLock);
+      size_t slot = findSlot (id, id.hash ());
+      PartitionElement * element = slots[slot].partitionElement;
+      if (element)
+      {
+        releaseSlot (slots[slot]);
+        eraseSlot (slot);
+      }
+      pthread_mutex_unlock (&mapLock);
+      if (element)
       {
-        delete partitions->at (i).partitionElement;
-        partitions->erase (partitions->begin () + (long) i);
-        numberOfElements--;
+        delete element;
         return;
       }
     }
@@ -118,22 +254,30 @@ namespace partest
     exit_partest (EX_SOFTWARE);
   }
 
-  void PartitionMap::purgePartitionMap (t_partitionElementId id)
+  void PartitionMap::purgePartitionMap (const t_partitionElementId & id)
   {
 
     if (id.size () <= 1)
       return;
 
-    /* Loop backwards over complex elements */
-    for (size_t i = numberOfElements - 1; i >= numberOfPartitions; i--)
+    /* gather first, since deletions shift the slots */
+    vector<t_partitionElementId> purged;
+    for (size_t i = 0; i < slots.size (); i++)
     {
-      t_partitionElementId mId = partitions->at (i).partitionId;
+      PartitionElement * element = slots[i].partitionElement;
+      if (!element)
+        continue;
+      const t_partitionElementId & mId = element->getId ();
       if (mId != id && Utilities::intersec (mId, id)
           && !Utilities::contains (_keep, mId))
       {
-        deletePartitionElement (mId);
+        purged.push_back (mId);
       }
     }
+    for (size_t i = 0; i < purged.size (); i++)
+    {
+      deletePartitionElement (purged[i]);
+    }
   }
 
   void PartitionMap::keep (t_partitioningScheme id)
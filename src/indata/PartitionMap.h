@@ -27,6 +27,11 @@
 
 #include <stdlib.h>
 #include <vector>
+#include <list>
+#include <pthread.h>
+
+/** Initial number of slots of the merged elements index, a power of 2 */
+#define PARTITION_MAP_INITIAL_SLOTS 1024
 
 #include "PartitionElement.h"
 #include "util/GlobalDefs.h"
@@ -34,17 +39,18 @@
 namespace partest
 {
 
+  /** Slot of the merged elements hash index */
   struct partitionMappingInfo
   {
     partitionMappingInfo () :
-        partitionId (1), partitionElement (0)
-    {
-    }
-    t_partitionElementId partitionId;
-    PartitionElement * partitionElement;
-    ~partitionMappingInfo (void)
+        hash (0), partitionElement (0), resident (false), footprint (0)
     {
     }
+    size_t hash; /** Hash of the element id */
+    PartitionElement * partitionElement; /** Element, or 0 for an empty slot */
+    bool resident; /** Whether the element is in the LRU list */
+    size_t footprint; /** Accounted memory of the optimized data */
+    std::list<PartitionElement *>::iterator lruPosition; /** Position in the LRU list */
   };
 
   /**
@@ -65,14 +71,15 @@ namespace partest
      *
      * @return The partition.
      */
-    PartitionElement * getPartitionElement (t_partitionElementId partitionId);
+    PartitionElement * getPartitionElement (
+        const t_partitionElementId & partitionId);
 
     /**
      * @brief Deletes a PartitionElement
      *
      * @param[in] id PartitionElement's id.
      */
-    void deletePartitionElement (t_partitionElementId id);
+    void deletePartitionElement (const t_partitionElementId & id);
 
     /**
      * @brief Gets the number of elements already created in the map.
@@ -97,7 +104,24 @@ namespace partest
       return numberOfPartitions;
     }
 
-    void purgePartitionMap (t_partitionElementId id);
+    void purgePartitionMap (const t_partitionElementId & id);
+
+    /**
+     * @brief Updates the accounted memory of an optimized merged element and
+     * marks it as the most recently used one.
+     *
+     * @param[in] element The element
+     */
+    void updateResident (PartitionElement * element);
+
+    /**
+     * @brief Evicts the least recently used optimized elements to their
+     * checkpoints until the memory budget is met.
+     *
+     * Evicted elements free their models, so this is only called between
+     * search steps, when no worker holds pointers into any element.
+     */
+    void enforceMemoryBudget (void);
     void keep (t_partitioningScheme id);
     void keep_add (t_partitioningScheme id);
     void keep_remove (t_partitioningScheme id);
@@ -114,11 +138,41 @@ namespace partest
 
     virtual ~PartitionMap ();
 
+    /**
+     * @brief Finds the slot of a merged element in the hash index
+     *
+     * @param[in] id The element id
+     * @param[in] hash The hash of the element id
+     *
+     * @return The slot of the element, or the empty slot where it belongs.
+     */
+    size_t findSlot (const t_partitionElementId & id, size_t hash) const;
+
+    /**
+     * @brief Inserts a merged element in the hash index
+     */
+    void insertElement (PartitionElement * element);
+
+    /**
+     * @brief Removes the element in a slot of the hash index
+     */
+    void eraseSlot (size_t slot);
+
+    /**
+     * @brief Removes a slot from the LRU list
+     */
+    void releaseSlot (partitionMappingInfo & slot);
+
     size_t numberOfElements; /** Number of partitions already created in the map. */
     size_t numberOfPartitions; /** Number of single-gene partitions */
-    std::vector<partitionMappingInfo> * partitions; /** Vector containing all the partitions created. */
+    std::vector<PartitionElement *> singleGeneElements; /** Single-gene partitions, indexed by gene */
+    std::vector<partitionMappingInfo> slots; /** Open-addressing index of the merged partitions */
     t_partitioningScheme _keep; /** Set of elements to keep in purge operations*/
 
+    std::list<PartitionElement *> lru; /** Resident merged elements, most recently used first */
+    size_t residentBytes; /** Accounted memory of the resident merged elements */
+    pthread_mutex_t mapLock; /** Lock for the LRU state, updated by worker threads */
+
     static PartitionMap * instance;
   };
 
@@ -27,6 +27,7 @@
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <cassert>
 
 #define UNDEFINED -1
 
@@ -43,8 +44,8 @@ namespace partest
       if (e1 == e2)
         return 0;
 
-      t_partitionElementId i1 = e1->getId ();
-      t_partitionElementId i2 = e2->getId ();
+      const t_partitionElementId & i1 = e1->getId ();
+      const t_partitionElementId & i2 = e2->getId ();
 
       if (i1 == i2)
       {
@@ -62,9 +63,11 @@ namespace partest
       id (schemeVector->size ()), partitions (schemeVector->size ())
   {
 
-    eps = 0;
     tree = 0;
     currentElement = 0;
+    mergeTotalsComputed = false;
+    mergeTotalIc = mergeTotalLnL = 0.0;
+    mergeTotalParameters = 0;
     code = 0;
     sort (schemeVector->begin (), schemeVector->end ());
     numberOfElements = schemeVector->size ();
@@ -84,15 +87,6 @@ namespace partest
       delete code;
     if (tree)
       free (tree);
-    if (eps)
-    {
-      for (size_t i = 0; i < eps->size (); i++)
-      {
-        elementPair *ep = eps->at (i);
-        free (ep);
-      }
-      delete eps;
-    }
   }
 
   PartitionElement * PartitioningScheme::getElement (size_t _id)
@@ -118,105 +112,6 @@ namespace partest
     return optimized;
   }
 
-  /** Functor for sorting the pairs */
-  struct compareDistancesVector
-  {
-    inline bool operator() (elementPair * struct1, elementPair * struct2)
-    {
-      return (struct1->distance < struct2->distance);
-    }
-  };
-
-  vector<elementPair *> * PartitioningScheme::getElementDistances ()
-  {
-
-    if (!eps)
-    {
-
-      if (!isOptimized ())
-      {
-        cerr
-            << "[ERROR] Attempting to get differences of unoptimized partitions"
-            << endl;
-        exit_partest (EX_SOFTWARE);
-      }
-
-      eps = new vector<elementPair *> (
-          (numberOfElements * (numberOfElements - 1)) / 2);
-
-      vector<double> alphaValues (
-          numberOfElements * (numberOfElements + 1) / 2);
-#ifdef _IG_MODELS
-      vector<double> pinvValues(
-          numberOfElements * (numberOfElements + 1) / 2);
-#endif
-      vector<double> distances (numberOfElements * (numberOfElements + 1) / 2);
-      double sumAlpha = 0.0;
-      double maxAlpha = 0.0;
-      for (size_t i = 1; i < numberOfElements; i++)
-      {
-        for (size_t j = 0; j < i; j++)
-        {
-          Model * mi = getElement (i)->getBestModel ()->getModel ();
-          Model * mj = getElement (j)->getBestModel ()->getModel ();
-          size_t index = (i * (i - 1) / 2) + j;
-#ifdef _IG_MODELS
-          pinvValues.at(index) = pow(mi->getpInv() - mj->getpInv(), 2);
-#endif
-          alphaValues.at (index) = pow (mi->getAlpha () - mj->getAlpha (), 2);
-          sumAlpha += alphaValues.at (index);
-          if (alphaValues.at (index) > maxAlpha)
-          {
-            maxAlpha = alphaValues.at (index);
-          }
-          distances.at (index) = mi->distanceTo (mj);
-          if (starting_topology == StartTopoFIXED)
-          {
-            double treeDist = 0.0;
-            double * bl1 = getElement (i)->getBranchLengths ();
-            double * bl2 = getElement (j)->getBranchLengths ();
-            for (int cBranch = 0;
-                cBranch < Utilities::numberOfBranches ((int) num_taxa);
-                cBranch++)
-            {
-              treeDist += pow (bl1[cBranch] - bl2[cBranch], 2);
-            }
-            distances.at (index) += treeDist;
-          }
-        }
-      }
-      double minDistance = DOUBLE_INF;
-      for (size_t i = 1; i < numberOfElements; i++)
-      {
-        for (size_t j = 0; j < i; j++)
-        {
-          size_t index = (i * (i - 1) / 2) + j;
-          alphaValues.at (index) /= maxAlpha;
-          distances.at (index) += alphaValues[index];
-#ifdef _IG_MODELS
-          distances.at(index) += pinvValues[index]
-#endif
-          ;
-          elementPair * ep = (elementPair *) malloc (sizeof(elementPair));
-          ep->e1 = getElement (i);
-          ep->e2 = getElement (j);
-          ep->distance = distances.at (index);
-          eps->at (index) = ep;
-
-          if (distances.at (index) < minDistance)
-          {
-            //el1 = getElement(i)->getId();
-            //el2 = getElement(j)->getId();
-            minDistance = distances.at (index);
-          }
-        }
-      }
-      sort (eps->begin (), eps->end (), compareDistancesVector ());
-    }
-
-    return eps;
-  }
-
   string PartitioningScheme::getName ()
   {
     stringstream ss;
@@ -245,11 +140,11 @@ namespace partest
       char * charcode = (char *) malloc (codeLines * number_of_genes + 1);
       for (size_t i = 0; i < numberOfElements; i++)
       {
-        t_partitionElementId _id = getElement (i)->getId ();
+        vector<size_t> genes = getElement (i)->getId ().getGenes ();
         hashmap[i] = UNDEFINED;
-        for (size_t j = 0; j < _id.size (); j++)
+        for (size_t j = 0; j < genes.size (); j++)
         {
-          intcode[_id.at (j)] = (int) i;
+          intcode[genes[j]] = (int) i;
         }
       }
       hashmap[intcode[0]] = 0;
@@ -419,6 +314,101 @@ namespace partest
     return score;
   }
 
+  /**
+   * @brief Gets the highest likelihood among the candidate models
+   */
+  static double maxCandidateLnL (PartitionElement * element)
+  {
+    double maxLnL = -DOUBLE_INF;
+    for (size_t i = 0; i < element->getNumberOfModels (); i++)
+    {
+      maxLnL = max (maxLnL, element->getModel (i)->getLnL ());
+    }
+    return maxLnL;
+  }
+
+  double PartitioningScheme::getMergeIcLowerBound (PartitionElement * e1,
+                                                   PartitionElement * e2)
+  {
+    if (ic_type == DT || !isOptimized () || !e1->getNumberOfModels ())
+      return -DOUBLE_INF;
+
+    double lnL = maxCandidateLnL (e1) + maxCandidateLnL (e2);
+
+    /* every element is built with the same candidate set */
+    int minParameters = 0;
+    for (size_t i = 0; i < e1->getNumberOfModels (); i++)
+    {
+      Model * model = e1->getModel (i);
+      int k =
+          reoptimize_branch_lengths ?
+              model->getNumberOfFreeParameters () :
+              model->getModelFreeParameters ();
+      if (!i || k < minParameters)
+        minParameters = k;
+    }
+
+    if (reoptimize_branch_lengths)
+    {
+      double score = ModelSelector::computeIc (
+          ic_type, lnL, minParameters,
+          e1->getSampleSize () + e2->getSampleSize ());
+      for (size_t i = 0; i < partitions.size (); i++)
+      {
+        PartitionElement * pe = partitions.at (i);
+        if (pe != e1 && pe != e2)
+          score += pe->getBestModel ()->getValue ();
+      }
+      return score;
+    }
+    else
+    {
+      int k = Utilities::numberOfBranches ((int) num_taxa) + minParameters;
+      for (size_t i = 0; i < partitions.size (); i++)
+      {
+        PartitionElement * pe = partitions.at (i);
+        if (pe != e1 && pe != e2)
+        {
+          lnL += pe->getLnL ();
+          k += pe->getBestModel ()->getModel ()->getModelFreeParameters ();
+        }
+      }
+      return ModelSelector::computeIc (ic_type, lnL, k, seq_len);
+    }
+  }
+
+  double PartitioningScheme::getMergeIcValue (PartitionElement * e1,
+                                              PartitionElement * e2,
+                                              PartitionElement * merged)
+  {
+    assert(merged->isOptimized ());
+
+    if (!mergeTotalsComputed)
+    {
+      mergeTotalIc = getIcValue ();
+      mergeTotalLnL = getLnL ();
+      mergeTotalParameters = (int) getNumberOfFreeParameters ();
+      mergeTotalsComputed = true;
+    }
+
+    if (reoptimize_branch_lengths)
+    {
+      return mergeTotalIc - e1->getBestModel ()->getValue ()
+          - e2->getBestModel ()->getValue ()
+          + merged->getBestModel ()->getValue ();
+    }
+    else
+    {
+      double lnL = mergeTotalLnL - e1->getLnL () - e2->getLnL ()
+          + merged->getLnL ();
+      int k = mergeTotalParameters
+          - e1->getBestModel ()->getModel ()->getModelFreeParameters ()
+          - e2->getBestModel ()->getModel ()->getModelFreeParameters ()
+          + merged->getBestModel ()->getModel ()->getModelFreeParameters ();
+      return ModelSelector::computeIc (ic_type, lnL, k, seq_len);
+    }
+  }
+
   double PartitioningScheme::getLinkedIcValue ()
   {
     if (!isOptimized ())
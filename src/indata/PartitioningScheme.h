@@ -98,11 +98,6 @@ namespace partest
      */
     char * getTree (void) const;
 
-    /**
-     * @brief Gets the closest pair of partitions.
-     */
-    std::vector<elementPair *> * getElementDistances ();
-
     /**
      * @brief Gets the number of lines of the code
      */
@@ -141,15 +136,51 @@ namespace partest
 
     unsigned int getNumberOfFreeParameters ();
 
+    /**
+     * @brief Gets a lower bound of the IC value of the scheme resulting from
+     * merging two of its elements.
+     *
+     * The merged likelihood cannot exceed the sum of the likelihoods of both
+     * elements, and the merged element needs at least as many free parameters
+     * as the simplest candidate model.
+     *
+     * @param[in] e1 The first element to merge
+     * @param[in] e2 The second element to merge
+     *
+     * @return The lower bound, or -DOUBLE_INF if it cannot be computed.
+     */
+    double getMergeIcLowerBound (PartitionElement * e1, PartitionElement * e2);
+
+    /**
+     * @brief Gets the IC value of the scheme resulting from replacing two of
+     * its elements by their merge, without building that scheme.
+     *
+     * The totals of this scheme are computed once, so each call only visits
+     * the three elements involved.
+     *
+     * @param[in] e1 The first merged element
+     * @param[in] e2 The second merged element
+     * @param[in] merged The optimized union of both elements
+     *
+     * @return The IC value of the merged scheme
+     */
+    double getMergeIcValue (PartitionElement * e1, PartitionElement * e2,
+                            PartitionElement * merged);
+
     void print (std::ostream & out);
   private:
     t_partitioningScheme id;
     std::vector<PartitionElement*> partitions; /** Array of reference to the partitions of this scheme */
     size_t currentElement; /** Current element index for the step-by-step construction of the scheme */
     size_t numberOfElements; /** The number of partitions */
-    std::vector<elementPair *> * eps;
     char * tree;
 
+    /* totals for scoring merges, computed on demand */
+    bool mergeTotalsComputed;
+    double mergeTotalIc; /** IC value of the scheme */
+    double mergeTotalLnL; /** Log-likelihood of the scheme */
+    int mergeTotalParameters; /** Free parameters of the scheme */
+
     /** Number of lines of the scheme code */
     size_t codeLines;
 
@@ -7,7 +7,7 @@
 
 #include "PllTreeManager.h"
 #include "util/Utilities.h"
-#include "indata/PartitionMap.h"
+#include "indata/TopologyCache.h"
 #include "model/NucleicModel.h"
 #include "model/ProteicModel.h"
 
@@ -17,8 +17,6 @@
 #include <iostream>
 #include <iomanip>
 
-#define ESTIMATE_PARAMETERS 0
-
 using namespace std;
 
 namespace partest
@@ -26,17 +24,22 @@ namespace partest
 
   static pllInstance * buildTree (bool use_multithread)
   {
+    /* concurrent elements and model replicas share the thread budget */
+    int instance_threads = number_of_threads
+        / (number_of_workers * (model_threads > 1 ? model_threads : 1));
+
     pllInstanceAttr attr;
     attr.fastScaling = PLL_FALSE;
     attr.randomNumberSeed = 0x54321;
     attr.rateHetModel = PLL_GAMMA;
     attr.saveMemory = PLL_FALSE;
     attr.useRecom = PLL_FALSE;
-    attr.numberOfThreads = use_multithread ? number_of_threads : 1;
+    attr.numberOfThreads =
+        (use_multithread && instance_threads > 1) ? instance_threads : 1;
     return (pllCreateInstance (&attr));
   }
 
-  PllTreeManager::PllTreeManager (const t_partitionElementId id,
+  PllTreeManager::PllTreeManager (const t_partitionElementId & id,
                                   const pllAlignmentData * _phylip,
                                   const vector<PEsection> & sections,
                                   size_t numberOfSites) :
@@ -146,56 +149,63 @@ namespace partest
       case StartTopoFIXED:
       case StartTopoFIXEDML:
         {
+          /* parsed topologies are shared through the cache */
           pllNewickTree * nt;
+          bool ownTopology = false;
           if (pergene_branch_lengths)
           {
             if (sections.size () == 1)
             {
-              nt = pllNewickParseString (pergene_starting_tree[sections[0].id]);
+              nt = TopologyCache::getInstance ()->getGeneTopology (
+                  sections[0].id);
             }
             else
             {
-              t_partitionElementId nextId (sections.size ());
+              t_partitionElementId nextId;
               for (size_t i = 0; i < sections.size (); i++)
               {
-                nextId[i] = sections[i].id;
+                nextId.insert (sections[i].id);
               }
               nt = Utilities::averageBranchLengths (nextId);
+              ownTopology = true;
             }
           }
           else
           {
-            nt = pllNewickParseString (starting_tree);
+            nt = TopologyCache::getInstance ()->getStartingTopology ();
           }
+          TopologyCache::lockParser ();
           pllTreeInitTopologyNewick (_tree, nt, PLL_FALSE);
-          pllNewickParseDestroy (&nt);
+          if (ownTopology)
+            pllNewickParseDestroy (&nt);
+          TopologyCache::unlockParser ();
           break;
         }
       case StartTopoUSER:
-        pllNewickTree * nt;
-        if (pergene_branch_lengths)
         {
-          if (sections.size () == 1)
-          {
-            nt = pllNewickParseFile (user_tree->c_str ());
-          }
-          else
+          pllNewickTree * nt;
+          bool ownTopology = false;
+          if (pergene_branch_lengths && sections.size () > 1)
           {
-            t_partitionElementId nextI (sections.size ());
+            t_partitionElementId nextI;
             for (size_t i = 0; i < sections.size (); i++)
             {
-              nextI[i] = sections[i].id;
+              nextI.insert (sections[i].id);
             }
             nt = Utilities::averageBranchLengths (nextI);
+            ownTopology = true;
           }
+          else
+          {
+            nt = TopologyCache::getInstance ()->getUserTopology ();
+          }
+          TopologyCache::lockParser ();
+          pllTreeInitTopologyNewick (_tree, nt, PLL_FALSE);
+          if (ownTopology)
+            pllNewickParseDestroy (&nt);
+          TopologyCache::unlockParser ();
+          break;
         }
-        else
-        {
-          nt = pllNewickParseFile (user_tree->c_str ());
-        }
-        pllTreeInitTopologyNewick (_tree, nt, PLL_FALSE);
-        pllNewickParseDestroy (&nt);
-        break;
       default:
         assert(0);
         break;
@@ -310,67 +320,6 @@ namespace partest
       }
       else
       {
-#if(ESTIMATE_PARAMETERS)
-        PartitionMap * partitionMap = PartitionMap::getInstance();
-        double alpha = 0.0;
-        double frequencies[NUM_NUC_FREQS];
-        for (int j = 0; j < NUM_NUC_FREQS; j++)
-        {
-          frequencies[j] = 0.25;
-        }
-        double rates[NUM_DNA_RATES];
-        for (int j = 0; j < NUM_DNA_RATES; j++)
-        {
-          rates[j] = 0.0;
-        }
-        for (size_t i = 0; i < _id.size(); i++)
-        {
-          t_partitionElementId singleId(1);
-          singleId.at(0) = _id.at(i);
-          PartitionElement * element =
-          partitionMap->getPartitionElement(singleId);
-//					double * elementFreqs =
-//							element->getBestModel()->getModel()->getFrequencies();
-//					for (int j = 0; j < NUM_NUC_FREQS; j++) {
-//						frequencies[j] += elementFreqs[j] / id.size();
-//					}
-          double * elementRates =
-          element->getBestModel()->getModel()->getRates();
-          for (int j = 0; j < NUM_DNA_RATES; j++)
-          {
-            rates[j] += elementRates[j] / _id.size();
-          }
-          alpha += element->getBestModel()->getModel()->getAlpha()
-          / _id.size();
-        }
-
-//				if (!_model->isPF()) {
-//					for (int i = 0; i < NUM_NUC_FREQS; i++) {
-//						frequencies[i] = 0.25;
-//					}
-//				}
-
-        pllSetFixedBaseFrequencies(frequencies, NUM_NUC_FREQS, index,
-            _partitions, _tree);
-        current_part->optimizeBaseFrequencies = _model->isPF();
-
-        if (strcmp(_model->getMatrixName().c_str(), "012345"))
-        {
-          for (int i = 0; i < NUM_DNA_RATES; i++)
-          {
-            rates[i] = 1;
-          }
-        }
-        pllSetFixedSubstitutionMatrix(rates, NUM_DNA_RATES, index,
-            _partitions, _tree);
-        current_part->optimizeSubstitutionRates = PLL_TRUE;
-
-        current_part->alpha = alpha;
-        current_part->optimizeAlphaParameter = PLL_TRUE;
-        pllMakeGammaCats(current_part->alpha, current_part->gammaRates,
-            4, _tree->useMedian);
-
-#else
         if (!_model->isPF ())
         {
           for (int i = 0; i < NUM_NUC_FREQS; i++)
@@ -387,7 +336,6 @@ namespace partest
         current_part->optimizeBaseFrequencies = _model->isPF ();
         pllMakeGammaCats (current_part->alpha, current_part->gammaRates, 4,
                           _tree->useMedian);
-#endif
       }
 
       free (symmetryPar);
@@ -401,7 +349,7 @@ namespace partest
       current_part->optimizeSubstitutionRates = PLL_FALSE;
       current_part->optimizeAlphaParameter = PLL_TRUE;
       current_part->protModels = pModel->getMatrix ();
-      current_part->alpha = 1.0;
+      current_part->alpha = setAlphaFreqs ? _model->getAlpha () : 1.0;
       for (int i = 0; i < NUM_PROT_FREQS; i++)
       {
         current_part->freqExponents[i] = 1.0;
@@ -559,8 +507,9 @@ namespace partest
     bp.storedBranchLengths = &storedBranchLengths;
     bp.tree_mgr = this;
     bp.tree = _tree;
-    branchLengthMultiplier = Utilities::minimize_brent (BL_SCALER_MIN, 1.0,
-    BL_SCALER_MAX,
+    branchLengthMultiplier = Utilities::minimize_brent (BL_SCALER_MIN,
+                                                        branchLengthMultiplier,
+                                                        BL_SCALER_MAX,
                                                         1e-2, &score, &f2x, &bp,
                                                         brent_target);
 #else
@@ -21,7 +21,7 @@ namespace partest
   class PllTreeManager : public TreeManager
   {
   public:
-    PllTreeManager (const t_partitionElementId id,
+    PllTreeManager (const t_partitionElementId & id,
                     const pllAlignmentData * phylip,
                     const std::vector<PEsection> & sections,
                     size_t numberOfSites);
@@ -0,0 +1,138 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file TopologyCache.cpp
+ * @author Diego Darriba
+ */
+
+#include "TopologyCache.h"
+
+#include <cstdlib>
+#include <cassert>
+#include <iostream>
+
+using namespace std;
+
+namespace partest
+{
+
+  static pthread_mutex_t instanceLock = PTHREAD_MUTEX_INITIALIZER;
+
+  /* taken after the cache lock, never before it */
+  static pthread_mutex_t parserLock = PTHREAD_MUTEX_INITIALIZER;
+
+  TopologyCache::TopologyCache () :
+      startingTopology (0), userTopology (0)
+  {
+    geneTopologies.resize (number_of_genes, (pllNewickTree *) 0);
+    pthread_mutex_init (&cacheLock, NULL);
+  }
+
+  TopologyCache::~TopologyCache ()
+  {
+    if (startingTopology)
+      pllNewickParseDestroy (&startingTopology);
+    if (userTopology)
+      pllNewickParseDestroy (&userTopology);
+    for (size_t i = 0; i < geneTopologies.size (); i++)
+    {
+      if (geneTopologies[i])
+        pllNewickParseDestroy (&geneTopologies[i]);
+    }
+
+    pthread_mutex_destroy (&cacheLock);
+  }
+
+  void TopologyCache::lockParser (void)
+  {
+    pthread_mutex_lock (&parserLock);
+  }
+
+  void TopologyCache::unlockParser (void)
+  {
+    pthread_mutex_unlock (&parserLock);
+  }
+
+  pllNewickTree * TopologyCache::getStartingTopology (void)
+  {
+    pthread_mutex_lock (&cacheLock);
+    if (!startingTopology)
+    {
+      lockParser ();
+      startingTopology = pllNewickParseString (starting_tree);
+      unlockParser ();
+    }
+    pthread_mutex_unlock (&cacheLock);
+    return startingTopology;
+  }
+
+  pllNewickTree * TopologyCache::getGeneTopology (size_t gene)
+  {
+    assert(pergene_starting_tree && gene < geneTopologies.size ());
+
+    pthread_mutex_lock (&cacheLock);
+    if (!geneTopologies[gene])
+    {
+      lockParser ();
+      geneTopologies[gene] = pllNewickParseString (pergene_starting_tree[gene]);
+      unlockParser ();
+    }
+    pthread_mutex_unlock (&cacheLock);
+    return geneTopologies[gene];
+  }
+
+  pllNewickTree * TopologyCache::getUserTopology (void)
+  {
+    pthread_mutex_lock (&cacheLock);
+    if (!userTopology)
+    {
+      lockParser ();
+      userTopology = pllNewickParseFile (user_tree->c_str ());
+      unlockParser ();
+      if (!userTopology)
+      {
+        cerr << "[ERROR] Cannot parse user tree " << *user_tree << endl;
+        exit_partest (EX_IOERR);
+      }
+    }
+    pthread_mutex_unlock (&cacheLock);
+    return userTopology;
+  }
+
+  TopologyCache * TopologyCache::instance = 0;
+
+  TopologyCache * TopologyCache::getInstance ()
+  {
+    pthread_mutex_lock (&instanceLock);
+    if (!instance)
+    {
+      instance = new TopologyCache ();
+    }
+    pthread_mutex_unlock (&instanceLock);
+    return instance;
+  }
+
+  void TopologyCache::deleteInstance ()
+  {
+    if (instance)
+      delete instance;
+    instance = 0;
+  }
+
+} /* namespace partest */
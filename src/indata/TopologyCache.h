@@ -0,0 +1,96 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file TopologyCache.h
+ *
+ * @brief Cache of parsed starting topologies shared by the PLL instances
+ */
+
+#ifndef TOPOLOGYCACHE_H_
+#define TOPOLOGYCACHE_H_
+
+#include "util/GlobalDefs.h"
+
+#include <vector>
+#include <pthread.h>
+
+namespace partest
+{
+
+  /**
+   * @brief Cache of the parsed starting topologies.
+   *
+   * Topologies are parsed once and cloned into every PLL instance instead
+   * of parsing the Newick string for each element. The PLL instances
+   * themselves are not recycled: the PLL API cannot reload an alignment
+   * into an existing instance, so every tree manager creates and destroys
+   * its own.
+   */
+  class TopologyCache
+  {
+  public:
+
+    /**
+     * @brief Gets the parsed global starting topology
+     *
+     * The topology is owned by the cache and must not be destroyed.
+     */
+    pllNewickTree * getStartingTopology (void);
+
+    /**
+     * @brief Gets the parsed per-gene starting topology
+     *
+     * The topology is owned by the cache and must not be destroyed.
+     *
+     * @param gene The gene index
+     */
+    pllNewickTree * getGeneTopology (size_t gene);
+
+    /**
+     * @brief Gets the parsed user topology
+     *
+     * The topology is owned by the cache and must not be destroyed.
+     */
+    pllNewickTree * getUserTopology (void);
+
+    /**
+     * @brief Serializes the calls into the PLL Newick parser and topology
+     * builder, which keep global state and are not thread safe
+     */
+    static void lockParser (void);
+    static void unlockParser (void);
+
+    static TopologyCache * getInstance (void);
+    static void deleteInstance (void);
+
+  private:
+    TopologyCache ();
+    virtual ~TopologyCache ();
+
+    pllNewickTree * startingTopology; /** Parsed global starting topology */
+    pllNewickTree * userTopology; /** Parsed user topology */
+    std::vector<pllNewickTree *> geneTopologies; /** Parsed per-gene topologies */
+
+    pthread_mutex_t cacheLock;
+    static TopologyCache * instance;
+  };
+
+} /* namespace partest */
+
+#endif /* TOPOLOGYCACHE_H_ */
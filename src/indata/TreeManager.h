@@ -18,7 +18,7 @@ namespace partest
   {
   public:
 
-    TreeManager (const t_partitionElementId _id, size_t numberOfSites,
+    TreeManager (const t_partitionElementId & _id, size_t numberOfSites,
                  size_t numberOfPatterns);
     virtual ~TreeManager ();
 
@@ -79,6 +79,14 @@ namespace partest
       return branchLengthMultiplier;
     }
 
+    /**
+     * Sets the starting point for the branch length scaler optimization
+     */
+    void setBranchLengthMultiplier (double value)
+    {
+      branchLengthMultiplier = value;
+    }
+
   protected:
     t_partitionElementId _id;
     size_t numberOfTaxa;
@@ -140,7 +140,7 @@ namespace partest
     return distance;
   }
 
-  double ProteicModel::getEuclideanDistance (ProtMatrix m1, ProtMatrix m2) const
+  double ProteicModel::getEuclideanDistance (ProtMatrix m1, ProtMatrix m2)
   {
     if (m1 == m2)
     {
@@ -55,11 +55,12 @@ namespace partest
     double distanceTo (Model * other) const;
     virtual void print (std::ostream& out, const char * prefix = "") const;
     virtual ~ProteicModel ();
-  private:
+
     /**
      * @brief Compute euclidean distances between amino-acid replacement matrices
      */
-    double getEuclideanDistance (ProtMatrix m1, ProtMatrix m2) const;
+    static double getEuclideanDistance (ProtMatrix m1, ProtMatrix m2);
+  private:
     ProtMatrix matrix; /** Amino-acid replacement matrix. */
   };
 
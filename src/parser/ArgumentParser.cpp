@@ -34,9 +34,9 @@ namespace partest
 {
 
 #ifdef _IG_MODELS
-#define NUM_ARGUMENTS 30
+#define NUM_ARGUMENTS 45
 #else
-#define NUM_ARGUMENTS 28
+#define NUM_ARGUMENTS 43
 #endif
 
   void ArgumentParser::init ()
@@ -52,15 +52,24 @@ namespace partest
     option options_list[] =
       {
         { ARG_HELP, 'h', "help", false },
+        { ARG_BEAM_WIDTH, 0, "beam-width", true },
+        { ARG_CHAINS, 0, "chains", true },
+        { ARG_CHAIN_STEPS, 0, "chain-steps", true },
         { ARG_CONFIG_FILE, 'c', "config-file", true },
         { ARG_CONFIG_HELP, 0, "config-help", false },
         { ARG_CONFIG_TEMPLATE, 0, "config-template", false },
+        { ARG_COOP_ID, 0, "coop-id", true },
+        { ARG_COOP_SIZE, 0, "coop-size", true },
         { ARG_DATA_TYPE, 'd', "data-type", true },
         { ARG_DISABLE_CHECKPOINT, 0, "disable-ckp", false },
         { ARG_DISABLE_OUTPUT, 0, "disable-output", false },
+        { ARG_DISABLE_WARM_START, 0, "disable-warm-start", false },
+        { ARG_DRY_RUN, 0, "dry-run", false },
         { ARG_EPSILON, 'e', "epsilon", true },
+        { ARG_EXHAUSTIVE_K, 0, "exhaustive-k", true },
         { ARG_INPUT_FORMAT, 'f', "input-format", true },
         { ARG_FORCE_OVERRIDE, 0, "force-override", false },
+        { ARG_FORK_WORKERS, 0, "fork-workers", true },
         { ARG_FREQUENCIES, 'F', "empirical-frequencies", false },
         { ARG_PERGENE_BL, 'g', "pergene-bl", false },
 #ifdef _IG_MODELS
@@ -69,14 +78,22 @@ namespace partest
 #endif
         { ARG_INPUT_FILE, 'i', "input-file", true },
         { ARG_KEEP_BRANCH_LENGTHS, 'k', "keep-branches", false },
+        { ARG_MAP_MEMORY, 0, "map-memory", true },
+        { ARG_MODEL_THREADS, 0, "model-threads", true },
         { ARG_SAMPLE_SIZE, 'n', "sample-size", true },
         { ARG_NON_STOP, 'N', "non-stop", false },
         { ARG_OUTPUT, 'o', "output", true },
         { ARG_OPTIMIZE, 'O', "optimize", true },
         { ARG_NUM_PROCS, 'p', "num-procs", true },
         { ARG_HCLUSTER_REPS, 'r', "replicates", true },
+        { ARG_HCL_NEIGHBOURS, 0, "hcl-neighbours", true },
         { ARG_IC_TYPE, 's', "selection-criterion", true },
         { ARG_SEARCH_ALGORITHM, 'S', "search", true },
+        { ARG_SEED, 0, "seed", true },
+        { ARG_SYNC_INTERVAL, 0, "sync-interval", true },
+        { ARG_TEMPERATURE, 0, "temperature", true },
+        { ARG_TEMPERATURE_RATIO, 0, "temperature-ratio", true },
+        { ARG_TIME_BUDGET, 0, "time-budget", true },
         { ARG_TOPOLOGY, 't', "topology", true },
         { ARG_FINAL_TREE, 'T', "get-final-tree", false },
         { ARG_USER_TREE, 'u', "user-tree", true },
@@ -299,6 +316,24 @@ namespace partest
           outputAvailable = false;
           ckpAvailable = false;
           break;
+        case ARG_DISABLE_WARM_START:
+          /* optimize merged elements from default parameters */
+          warm_start = false;
+          break;
+        case ARG_DRY_RUN:
+          /* estimate the search cost only */
+          dry_run = true;
+          break;
+        case ARG_TIME_BUDGET:
+          /* set the wall time budget of the auto search in seconds */
+          if (!Utilities::isNumeric (value) || atof (value) <= 0.0)
+          {
+            cerr << "[ERROR] \"--time-budget " << value
+                << "\" is not a valid time budget." << endl;
+            exit_partest (EX_CONFIG);
+          }
+          time_budget = atof (value);
+          break;
         case ARG_EPSILON:
           /* epsilon used for optimization algorithm */
           if (Utilities::isNumeric (value))
@@ -417,7 +452,7 @@ namespace partest
                 << "Exhaustive algorithm (horribly computationally expensive)"
                 << endl;
             cerr << "  -S " << setw (12) << left << ARG_SEARCH_RANDOM
-                << "Random walk algorithm (Chinese restaurant process)" << endl;
+                << "Parallel tempering random search" << endl;
             cerr << "  -S " << setw (12) << left << ARG_SEARCH_GREEDY
                 << "Greedy hill climbing algorithm" << endl;
             cerr << "  -S " << setw (12) << left << ARG_SEARCH_GREEDY_EXT
@@ -472,6 +507,170 @@ namespace partest
           /* keep branch lengths from the initial topology */
           reoptimize_branch_lengths = false;
           break;
+        case ARG_BEAM_WIDTH:
+          /* set the number of schemes kept per extended greedy step */
+          if (!Utilities::isInteger (value) || atoi (value) < 1)
+          {
+            cerr << "[ERROR] \"--beam-width " << value
+                << "\" is not a valid beam width." << endl;
+            exit_partest (EX_CONFIG);
+          }
+          beam_width = (size_t) atoi (value);
+          break;
+        case ARG_CHAINS:
+          /* set the number of parallel tempering chains */
+          if (!Utilities::isInteger (value) || atoi (value) < 1)
+          {
+            cerr << "[ERROR] \"--chains " << value
+                << "\" is not a valid number of chains." << endl;
+            exit_partest (EX_CONFIG);
+          }
+          search_chains = (size_t) atoi (value);
+          break;
+        case ARG_CHAIN_STEPS:
+          /* set the number of steps of every chain */
+          if (!Utilities::isInteger (value) || atoi (value) < 1)
+          {
+            cerr << "[ERROR] \"--chain-steps " << value
+                << "\" is not a valid number of steps." << endl;
+            exit_partest (EX_CONFIG);
+          }
+          search_steps = (size_t) atoi (value);
+          break;
+        case ARG_COOP_SIZE:
+          /* set the number of processes sharing the output directory */
+          if (!Utilities::isInteger (value) || atoi (value) < 1)
+          {
+            cerr << "[ERROR] \"--coop-size " << value
+                << "\" is not a valid number of processes." << endl;
+            exit_partest (EX_CONFIG);
+          }
+#ifdef HAVE_MPI
+          if (atoi (value) > 1)
+          {
+            cerr << "[ERROR] Cooperative runs are not available with MPI."
+                << endl;
+            exit_partest (EX_CONFIG);
+          }
+#endif
+          coop_size = atoi (value);
+          break;
+        case ARG_FORK_WORKERS:
+          /* set the number of forked worker processes */
+          if (!Utilities::isInteger (value) || atoi (value) < 0)
+          {
+            cerr << "[ERROR] \"--fork-workers " << value
+                << "\" is not a valid number of processes." << endl;
+            exit_partest (EX_CONFIG);
+          }
+#ifdef HAVE_MPI
+          if (atoi (value) > 1)
+          {
+            cerr << "[ERROR] Forked workers are not available with MPI."
+                << endl;
+            exit_partest (EX_CONFIG);
+          }
+#endif
+          fork_workers = atoi (value);
+          break;
+        case ARG_COOP_ID:
+          /* set the index of this process among the cooperating ones */
+          if (!Utilities::isInteger (value) || atoi (value) < 0)
+          {
+            cerr << "[ERROR] \"--coop-id " << value
+                << "\" is not a valid process index." << endl;
+            exit_partest (EX_CONFIG);
+          }
+          coop_id = atoi (value);
+          break;
+        case ARG_SEED:
+          /* set the seed of the random search chains */
+          if (!Utilities::isInteger (value) || atoi (value) < 0)
+          {
+            cerr << "[ERROR] \"--seed " << value
+                << "\" is not a valid seed." << endl;
+            exit_partest (EX_CONFIG);
+          }
+          search_seed = (unsigned long) atol (value);
+          break;
+        case ARG_TEMPERATURE:
+          /* set the temperature of the coldest random search chain */
+          if (!Utilities::isNumeric (value) || atof (value) <= 0.0)
+          {
+            cerr << "[ERROR] \"--temperature " << value
+                << "\" is not a valid temperature." << endl;
+            exit_partest (EX_CONFIG);
+          }
+          search_temperature = atof (value);
+          break;
+        case ARG_TEMPERATURE_RATIO:
+          /* set the ratio between the temperatures of consecutive chains */
+          if (!Utilities::isNumeric (value) || atof (value) < 1.0)
+          {
+            cerr << "[ERROR] \"--temperature-ratio " << value
+                << "\" is not a valid ratio. It must be at least 1." << endl;
+            exit_partest (EX_CONFIG);
+          }
+          search_temperature_ratio = atof (value);
+          break;
+        case ARG_SYNC_INTERVAL:
+          /* set the seconds between synchronizations of the output */
+          if (!Utilities::isInteger (value) || atoi (value) < 0)
+          {
+            cerr << "[ERROR] \"--sync-interval " << value
+                << "\" is not a valid number of seconds." << endl;
+            exit_partest (EX_CONFIG);
+          }
+          sync_interval = atoi (value);
+          break;
+        case ARG_EXHAUSTIVE_K:
+          /* set the number of subsets of the exhaustive search schemes */
+          if (!Utilities::isInteger (value) || atoi (value) < 1)
+          {
+            cerr << "[ERROR] \"--exhaustive-k " << value
+                << "\" is not a valid number of subsets." << endl;
+            exit_partest (EX_CONFIG);
+          }
+          exhaustive_k = (size_t) atoi (value);
+          break;
+        case ARG_HCL_NEIGHBOURS:
+          /* set the number of nearest neighbours for hcluster candidates */
+          if (!Utilities::isInteger (value) || atoi (value) < 1)
+          {
+            cerr << "[ERROR] \"--hcl-neighbours " << value
+                << "\" is not a valid number of neighbours." << endl;
+            exit_partest (EX_CONFIG);
+          }
+          hcl_neighbours = (size_t) atoi (value);
+          break;
+        case ARG_MAP_MEMORY:
+          /* set the memory budget of the partition map in MB */
+          if (!Utilities::isInteger (value) || atoi (value) < 1)
+          {
+            cerr << "[ERROR] \"--map-memory " << value
+                << "\" is not a valid memory budget." << endl;
+            exit_partest (EX_CONFIG);
+          }
+          map_memory_budget = (size_t) atoi (value) * 1024 * 1024;
+          break;
+        case ARG_MODEL_THREADS:
+          /* set the number of concurrent model evaluations per element */
+#ifdef HAVE_PTHREADS
+          if (!Utilities::isInteger (value) || atoi (value) < 1)
+          {
+            cerr << "[ERROR] \"--model-threads " << value
+                << "\" is not a valid number of threads." << endl;
+            exit_partest (EX_CONFIG);
+          }
+          model_threads = atoi (value);
+#else
+          cerr
+          << "[ERROR] PThreads version is not available."
+          << " You must recompile with PTHREADS flag."
+          << endl;
+          exit_partest(EX_CONFIG);
+#endif
+          break;
         case ARG_NON_STOP:
           /* continue until the end / non stop on local maxima */
           non_stop = true;
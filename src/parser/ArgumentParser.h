@@ -66,23 +66,35 @@
 enum ArgIndex
 {
   ARG_NULL, ARG_CONFIG_FILE, /** Argument for configuration file name */
+  ARG_BEAM_WIDTH, /** Argument for the extended greedy search beam width */
+  ARG_CHAINS, /** Argument for the number of random search chains */
+  ARG_CHAIN_STEPS, /** Argument for the number of random search steps */
   ARG_CONFIG_HELP, /** Argument for show help about configuration */
   ARG_CONFIG_TEMPLATE, /** Argument for show a configuration template */
+  ARG_COOP_ID, /** Argument for the index of a cooperating process */
+  ARG_COOP_SIZE, /** Argument for the number of cooperating processes */
   ARG_DATA_TYPE, /** Argument for data type (aa/nt) */
   ARG_EPSILON, /** Argument for setting the optimization epsilon */
+  ARG_EXHAUSTIVE_K, /** Argument for the number of subsets in exhaustive search */
   ARG_DISABLE_CHECKPOINT, /** Argument for disabling the checkpointing */
   ARG_DISABLE_OUTPUT, /** Argument for disable writing output files */
+  ARG_DISABLE_WARM_START, /** Argument for disabling the warm start of candidate models */
+  ARG_DRY_RUN, /** Argument for estimating the search cost only */
   ARG_FINAL_TREE, /** Argument for computing final tree */
   ARG_FORCE_OVERRIDE, /** Argument for forcing the override of existent output files */
+  ARG_FORK_WORKERS, /** Argument for the number of forked worker processes */
   ARG_FREQUENCIES, /** Argument for including +F models */
   ARG_GAMMA, /** Argument for including +G models */
   ARG_HCLUSTER_REPS, /** Number of hcluster replicates */
+  ARG_HCL_NEIGHBOURS, /** Argument for approximate hcluster candidates */
   ARG_HELP, /** Argument for show help */
   ARG_IC_TYPE, /** Argument for selection criterion */
   ARG_INPUT_FILE, /** Argument for input data file */
   ARG_INPUT_FORMAT, /** Argument for input data format */
   ARG_INV, /** Argument for including +I models */
   ARG_KEEP_BRANCH_LENGTHS, /** Argument for keeping branch lengths from the initial topology */
+  ARG_MAP_MEMORY, /** Argument for the memory budget of the partition map */
+  ARG_MODEL_THREADS, /** Argument for number of concurrent model evaluations per element */
   ARG_NON_STOP, /** Search until the end */
   ARG_NUM_PROCS, /** Argument for number of processors */
   ARG_OPTIMIZE, /** Argument for search algorithm */
@@ -90,6 +102,11 @@ enum ArgIndex
   ARG_PERGENE_BL, /** Argument for estimating per-gene branch lengths */
   ARG_SAMPLE_SIZE, /** Argument for sample size type */
   ARG_SEARCH_ALGORITHM, /** Argument for search algorithm */
+  ARG_SEED, /** Argument for the random search seed */
+  ARG_SYNC_INTERVAL, /** Argument for the interval of output synchronizations */
+  ARG_TEMPERATURE, /** Argument for the temperature of the coldest random search chain */
+  ARG_TEMPERATURE_RATIO, /** Argument for the ratio between random search chain temperatures */
+  ARG_TIME_BUDGET, /** Argument for the auto search time budget */
   ARG_TOPOLOGY, /** Argument for starting topology type */
   ARG_USER_TREE, /** Argument for input user tree file */
   ARG_VERBOSE, /** Argument for setting verbosity level */
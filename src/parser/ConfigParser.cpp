@@ -117,7 +117,7 @@ namespace partest
     pllPartitionInfo * pinfo;
     pllQueueInit (&pllPartsQueue);
 
-    partitions->at (0).partitionId.push_back (0);
+    partitions->at (0).partitionId.insert (0);
     pinfo = (pllPartitionInfo *) malloc (sizeof(pllPartitionInfo));
     pinfo->ascBias = PLL_FALSE;
     pllQueueInit (&(pinfo->regionList));
@@ -162,7 +162,7 @@ namespace partest
 
       for (size_t i = 0; i < number_of_genes; i++)
       {
-        partitions->at (i).partitionId.push_back (i);
+        partitions->at (i).partitionId.insert (i);
         pinfo = (pllPartitionInfo *) malloc (sizeof(pllPartitionInfo));
         pinfo->ascBias = PLL_FALSE;
         pllQueueInit (&(pinfo->regionList));
@@ -453,7 +453,17 @@ namespace partest
         exit_partest (EX_CONFIG);
       }
 
-      string samples_str = ini.Get (SEARCH_TAG, SEARCH_ALGORITHM_REPS, "1");
+      string samples_str = ini.Get (SEARCH_TAG, SEARCH_ALGORITHM_REPS, "");
+      if (samples_str.length () && search_algo == SearchRandom)
+      {
+        cerr << "[ERROR] \"" << SEARCH_ALGORITHM_REPS
+            << "\" does not apply to the random search. Use \""
+            << SEARCH_CHAINS_TAG << "\" and \"" << SEARCH_STEPS_TAG
+            << "\" instead." << endl;
+        exit_partest (EX_CONFIG);
+      }
+      if (!samples_str.length ())
+        samples_str = "1";
       if (Utilities::isInteger (samples_str.c_str ()))
       {
         /* apply absolute number of replicates */
@@ -493,6 +503,67 @@ namespace partest
         }
       }
 
+      /* random search chains */
+      string chains_str = ini.Get (SEARCH_TAG, SEARCH_CHAINS_TAG, "");
+      if (chains_str.length ())
+      {
+        if (!Utilities::isInteger (chains_str.c_str ())
+            || atoi (chains_str.c_str ()) < 1)
+        {
+          cerr << "[ERROR] \"" << SEARCH_CHAINS_TAG << " = " << chains_str
+              << "\" is not a valid number of chains." << endl;
+          exit_partest (EX_CONFIG);
+        }
+        search_chains = (size_t) atoi (chains_str.c_str ());
+      }
+      string steps_str = ini.Get (SEARCH_TAG, SEARCH_STEPS_TAG, "");
+      if (steps_str.length ())
+      {
+        if (!Utilities::isInteger (steps_str.c_str ())
+            || atoi (steps_str.c_str ()) < 1)
+        {
+          cerr << "[ERROR] \"" << SEARCH_STEPS_TAG << " = " << steps_str
+              << "\" is not a valid number of steps." << endl;
+          exit_partest (EX_CONFIG);
+        }
+        search_steps = (size_t) atoi (steps_str.c_str ());
+      }
+      string seed_str = ini.Get (SEARCH_TAG, SEARCH_SEED_TAG, "");
+      if (seed_str.length ())
+      {
+        if (!Utilities::isInteger (seed_str.c_str ()))
+        {
+          cerr << "[ERROR] \"" << SEARCH_SEED_TAG << " = " << seed_str
+              << "\" is not a valid seed." << endl;
+          exit_partest (EX_CONFIG);
+        }
+        search_seed = (unsigned long) atol (seed_str.c_str ());
+      }
+      string temperature_str = ini.Get (SEARCH_TAG, SEARCH_TEMPERATURE_TAG, "");
+      if (temperature_str.length ())
+      {
+        if (!Utilities::isNumeric (temperature_str.c_str ())
+            || atof (temperature_str.c_str ()) <= 0.0)
+        {
+          cerr << "[ERROR] \"" << SEARCH_TEMPERATURE_TAG << " = "
+              << temperature_str << "\" is not a valid temperature." << endl;
+          exit_partest (EX_CONFIG);
+        }
+        search_temperature = atof (temperature_str.c_str ());
+      }
+      string ratio_str = ini.Get (SEARCH_TAG, SEARCH_TEMP_RATIO_TAG, "");
+      if (ratio_str.length ())
+      {
+        if (!Utilities::isNumeric (ratio_str.c_str ())
+            || atof (ratio_str.c_str ()) < 1.0)
+        {
+          cerr << "[ERROR] \"" << SEARCH_TEMP_RATIO_TAG << " = " << ratio_str
+              << "\" is not a valid ratio. It must be at least 1." << endl;
+          exit_partest (EX_CONFIG);
+        }
+        search_temperature_ratio = atof (ratio_str.c_str ());
+      }
+
       /** PARTITIONS **/
       std::vector<std::string> * keys = ini.getGenes (
       PARTITIONS_TAG);
@@ -700,7 +771,7 @@ namespace partest
           partitionInfo pInfo = partitions->at (i);
           if (!pInfo.name.compare (parsedPart))
           {
-            nextSingleElement = pInfo.partitionId.at (0);
+            nextSingleElement = pInfo.partitionId.front ();
             break;
           }
         }
@@ -709,7 +780,7 @@ namespace partest
           cerr << "[ERROR] Partition " << parsedPart << " not found" << endl;
           exit_partest (EX_IOERR);
         }
-        nextPart.push_back (nextSingleElement);
+        nextPart.insert (nextSingleElement);
         parsedPart = strtok (NULL, ",");
       }
       scheme->push_back (nextPart);
@@ -800,7 +871,18 @@ namespace partest
     cout << "      auto     - Auto selected search algorithm" << endl;
     cout << SEARCH_TAG << "/" << SEARCH_ALGORITHM_REPS << endl;
     cout
-        << "      (int) # - Maximum number of replicates on each HCluster/Random step"
+        << "      (int) # - Maximum number of replicates on each HCluster step"
+        << endl;
+    cout << SEARCH_TAG << "/" << SEARCH_CHAINS_TAG << ", " << SEARCH_STEPS_TAG
+        << ", " << SEARCH_SEED_TAG << endl;
+    cout << "      (int) # - Number of chains, steps per chain and seed of the"
+        << endl;
+    cout << "                Random search" << endl;
+    cout << SEARCH_TAG << "/" << SEARCH_TEMPERATURE_TAG << ", "
+        << SEARCH_TEMP_RATIO_TAG << endl;
+    cout << "      (float) # - Temperature of the coldest chain and ratio"
+        << endl;
+    cout << "                  between consecutive chains of the Random search"
         << endl;
     cout << MODELS_TAG << "/" << MODELS_INCLUDE_TAG << endl;
     cout << "      all    - Evaluate the whole set of models" << endl;
@@ -36,6 +36,11 @@
 #define SEARCH_TAG             "search"
 #define SEARCH_ALGORITHM_TAG   "algorithm"
 #define SEARCH_ALGORITHM_REPS  "replicates"
+#define SEARCH_CHAINS_TAG      "chains"
+#define SEARCH_STEPS_TAG       "steps"
+#define SEARCH_SEED_TAG        "seed"
+#define SEARCH_TEMPERATURE_TAG "temperature"
+#define SEARCH_TEMP_RATIO_TAG  "temperature-ratio"
 
 #define MODELS_TAG          "models"
 #define MODELS_INCLUDE_TAG  "include"
@@ -23,19 +23,24 @@
 #include "ExhaustiveSearchAlgorithm.h"
 
 #include "util/GlobalDefs.h"
+#include "util/Utilities.h"
 #include "exe/ModelOptimize.h"
 #include "exe/ModelSelector.h"
 #include "exe/PartitionSelector.h"
 #include "indata/PartitioningScheme.h"
+#include "indata/PartitionMap.h"
 
 #include <algorithm>    /* std::adjacent_find */
 #include <iostream>
+#include <fstream>
+#include <cstdio>
 #include <vector>
 
 namespace partest
 {
 
-  ExhaustiveSearchAlgorithm::ExhaustiveSearchAlgorithm ()
+  ExhaustiveSearchAlgorithm::ExhaustiveSearchAlgorithm () :
+      minParameters (0)
   {
   }
 
@@ -43,6 +48,180 @@ namespace partest
   {
   }
 
+  PartitioningScheme * ExhaustiveSearchAlgorithm::buildScheme (
+      const vector<unsigned> & kappa, unsigned numberOfSubsets)
+  {
+    t_partitioningScheme schemeId (numberOfSubsets);
+    for (size_t gene = 0; gene < kappa.size (); gene++)
+    {
+      schemeId.at (kappa[gene]).insert (gene);
+    }
+    return new PartitioningScheme (&schemeId);
+  }
+
+  void ExhaustiveSearchAlgorithm::advance (Stirling::iterator * it)
+  {
+    /* the increment operators are not virtual */
+    if (exhaustive_k)
+      ++(*static_cast<Stirling::iterator_k *> (it));
+    else
+      ++(*it);
+  }
+
+  void ExhaustiveSearchAlgorithm::setBoundData (
+      PartitioningScheme * singleGeneScheme)
+  {
+    size_t n = singleGeneScheme->getNumberOfElements ();
+    geneMaxLnL.resize (n);
+    geneLnL.resize (n);
+    geneValue.resize (n);
+    geneParameters.resize (n);
+    geneSampleSize.resize (n);
+
+    for (size_t i = 0; i < n; i++)
+    {
+      PartitionElement * element = singleGeneScheme->getElement (i);
+      size_t gene = element->getId ().front ();
+
+      double maxLnL = -DOUBLE_INF;
+      for (size_t j = 0; j < element->getNumberOfModels (); j++)
+      {
+        Model * model = element->getModel (j);
+        maxLnL = max (maxLnL, model->getLnL ());
+
+        /* every element is built with the same candidate set */
+        int k =
+            reoptimize_branch_lengths ?
+                model->getNumberOfFreeParameters () :
+                model->getModelFreeParameters ();
+        if ((!i && !j) || k < minParameters)
+          minParameters = k;
+      }
+      geneMaxLnL[gene] = maxLnL;
+      geneLnL[gene] = element->getLnL ();
+      geneValue[gene] = element->getBestModel ()->getValue ();
+      geneParameters[gene] =
+          element->getBestModel ()->getModel ()->getModelFreeParameters ();
+      geneSampleSize[gene] = element->getSampleSize ();
+    }
+  }
+
+  double ExhaustiveSearchAlgorithm::getIcLowerBound (
+      const vector<unsigned> & kappa, unsigned numberOfSubsets)
+  {
+    if (ic_type == DT || geneMaxLnL.empty ())
+      return -DOUBLE_INF;
+
+    vector<double> lnL (numberOfSubsets, 0.0);
+    vector<size_t> sampleSize (numberOfSubsets, 0);
+    vector<size_t> genes (numberOfSubsets, 0);
+    vector<size_t> firstGene (numberOfSubsets, 0);
+    for (size_t gene = 0; gene < kappa.size (); gene++)
+    {
+      unsigned subset = kappa[gene];
+      if (!genes[subset]++)
+        firstGene[subset] = gene;
+      lnL[subset] += geneMaxLnL[gene];
+      sampleSize[subset] += geneSampleSize[gene];
+    }
+
+    if (reoptimize_branch_lengths)
+    {
+      double score = 0.0;
+      for (unsigned i = 0; i < numberOfSubsets; i++)
+      {
+        if (genes[i] == 1)
+          score += geneValue[firstGene[i]];
+        else
+          score += ModelSelector::computeIc (ic_type, lnL[i], minParameters,
+                                             sampleSize[i]);
+      }
+      return score;
+    }
+    else
+    {
+      double totalLnL = 0.0;
+      int k = Utilities::numberOfBranches ((int) num_taxa);
+      for (unsigned i = 0; i < numberOfSubsets; i++)
+      {
+        if (genes[i] == 1)
+        {
+          totalLnL += geneLnL[firstGene[i]];
+          k += geneParameters[firstGene[i]];
+        }
+        else
+        {
+          totalLnL += lnL[i];
+          k += minParameters;
+        }
+      }
+      return ModelSelector::computeIc (ic_type, totalLnL, k, seq_len);
+    }
+  }
+
+  void ExhaustiveSearchAlgorithm::saveCheckpoint (
+      const enumerationState & state)
+  {
+    if (!ckpAvailable || !(I_AM_LEADER))
+      return;
+
+    string ckpFilename = ckpPath + os_separator + ckpExhaustiveSearch;
+    string tmpFilename = ckpFilename + ".tmp";
+    fstream ofs (tmpFilename.c_str (), ios::out | ios::binary | ios::trunc);
+    if (!ofs)
+      return;
+
+    size_t n = state.kappa.size ();
+    size_t bestSize = state.bestKappa.size ();
+    ofs.write ((char *) &n, sizeof(size_t));
+    ofs.write ((char *) &exhaustive_k, sizeof(size_t));
+    ofs.write ((char *) &state.position, sizeof(unsigned long long));
+    ofs.write ((char *) &state.evaluated, sizeof(unsigned long long));
+    ofs.write ((char *) &state.skipped, sizeof(unsigned long long));
+    ofs.write ((char *) &state.kappa[0], (streamsize) (n * sizeof(unsigned)));
+    ofs.write ((char *) &bestSize, sizeof(size_t));
+    if (bestSize)
+      ofs.write ((char *) &state.bestKappa[0],
+                 (streamsize) (bestSize * sizeof(unsigned)));
+    ofs.close ();
+
+    /* the previous checkpoint is replaced only by a complete one */
+    rename (tmpFilename.c_str (), ckpFilename.c_str ());
+  }
+
+  bool ExhaustiveSearchAlgorithm::loadCheckpoint (enumerationState & state)
+  {
+    if (!ckpAvailable)
+      return false;
+
+    fstream ifs ((ckpPath + os_separator + ckpExhaustiveSearch).c_str (),
+                 ios::in | ios::binary);
+    if (!ifs)
+      return false;
+
+    size_t n, k, bestSize;
+    ifs.read ((char *) &n, sizeof(size_t));
+    ifs.read ((char *) &k, sizeof(size_t));
+    if (!ifs || n != number_of_genes || k != exhaustive_k)
+    {
+      /* checkpoint of a different search */
+      return false;
+    }
+    state.kappa.resize (n);
+    ifs.read ((char *) &state.position, sizeof(unsigned long long));
+    ifs.read ((char *) &state.evaluated, sizeof(unsigned long long));
+    ifs.read ((char *) &state.skipped, sizeof(unsigned long long));
+    ifs.read ((char *) &state.kappa[0], (streamsize) (n * sizeof(unsigned)));
+    ifs.read ((char *) &bestSize, sizeof(size_t));
+    if (!ifs || (bestSize && bestSize != n))
+      return false;
+    state.bestKappa.resize (bestSize);
+    if (bestSize)
+      ifs.read ((char *) &state.bestKappa[0],
+                (streamsize) (bestSize * sizeof(unsigned)));
+    return (bool) ifs;
+  }
+
   PartitioningScheme * ExhaustiveSearchAlgorithm::start (
       PartitioningScheme * startingPoint)
   {
@@ -53,36 +232,186 @@ namespace partest
       cerr << "[ERROR] Not implemented yet" << endl;
       exit_partest (EX_UNAVAILABLE);
     }
-    else
+    else if (number_of_schemes > 0)
     {
       ModelOptimize * modelOptimize = new ModelOptimize ();
+      vector<PartitioningScheme *> candidateSchemes (number_of_schemes);
+      //double bestScore;
+
+      for (size_t currentStep = 0; currentStep < number_of_schemes;
+          currentStep++)
+      {
+        t_partitioningScheme scheme = schemes->at (currentStep);
+        candidateSchemes.at (currentStep) = new PartitioningScheme (&scheme);
+        cout << timestamp () << " [EXH] Step " << currentStep + 1 << "/"
+            << number_of_schemes << endl;
+        if (modelOptimize->optimizePartitioningScheme (
+            candidateSchemes.at (currentStep)) != EX_OK)
+          ModelOptimize::exitInterrupted ();
+      }
+      PartitionSelector ps (candidateSchemes);
+      bestScheme = ps.getBestScheme ();
+      //bestScore = ps.getBestScheme()->getIcValue();
+    }
+    else
+    {
+      if (exhaustive_k > number_of_genes)
+      {
+        cerr << "[ERROR] Cannot build schemes with " << exhaustive_k
+            << " subsets out of " << number_of_genes << " genes" << endl;
+        exit_partest (EX_CONFIG);
+      }
 
-      if (number_of_schemes > 0)
+      unsigned n = (unsigned) number_of_genes;
+      unsigned long long totalSchemes =
+          exhaustive_k ? Stirling::count (n, (unsigned) exhaustive_k) :
+                         Stirling::bell (n);
+      if (totalSchemes == (unsigned long long) -1)
       {
-        vector<PartitioningScheme *> candidateSchemes (number_of_schemes);
-        //double bestScore;
+        cerr << "[ERROR] Too many schemes for exhaustive search" << endl;
+        exit_partest (EX_CONFIG);
+      }
+
+      SchemeManager schemeManager;
+      /* broadcast as MPI_INT, so it cannot be a bool */
+      int continueExec = 1;
+
+      if (I_AM_ROOT)
+      {
+        double bestScore = DOUBLE_INF;
+        enumerationState state;
+        state.position = state.evaluated = state.skipped = 0;
+
+        Stirling::iterator * it =
+            exhaustive_k ?
+                new Stirling::iterator_k (n, (unsigned) exhaustive_k) :
+                new Stirling::iterator (n);
 
-        for (size_t currentStep = 0; currentStep < number_of_schemes;
-            currentStep++)
+        if (loadCheckpoint (state))
         {
-          t_partitioningScheme scheme = schemes->at (currentStep);
-          candidateSchemes.at (currentStep) = new PartitioningScheme (&scheme);
-          cout << timestamp () << " [EXH] Step " << currentStep + 1 << "/"
-              << number_of_schemes << endl;
-          modelOptimize->optimizePartitioningScheme (
-              candidateSchemes.at (currentStep));
+          cout << timestamp () << " [EXH] Resuming from scheme "
+              << state.position + 1 << "/" << totalSchemes << endl;
+          it->setKappa (state.kappa);
         }
-        PartitionSelector ps (candidateSchemes);
-        bestScheme = ps.getBestScheme ();
-        //bestScore = ps.getBestScheme()->getIcValue();
+        else
+        {
+          state.position = state.evaluated = state.skipped = 0;
+          state.kappa = **it;
+          state.bestKappa.clear ();
+        }
+
+        /* the K=N scheme gives the single gene scores for the bounds */
+        t_partitioningScheme singleGeneId (number_of_genes);
+        for (size_t gene = 0; gene < number_of_genes; gene++)
+        {
+          singleGeneId.at (gene) = PartitionElementId::singleGene (gene);
+        }
+        PartitioningScheme * singleGeneScheme = new PartitioningScheme (
+            &singleGeneId);
+        schemeManager.addScheme (singleGeneScheme);
+        if (!state.bestKappa.empty ())
+        {
+          bestScheme = buildScheme (
+              state.bestKappa,
+              *max_element (state.bestKappa.begin (), state.bestKappa.end ())
+                  + 1);
+          schemeManager.addScheme (bestScheme);
+        }
+        cout << timestamp () << " [EXH] Optimizing single gene elements"
+            << endl;
+        schemeManager.optimize (mo);
+        setBoundData (singleGeneScheme);
+        delete singleGeneScheme;
+
+        if (bestScheme)
+        {
+          bestScore = bestScheme->getIcValue ();
+          PartitionMap::getInstance ()->keep (bestScheme->getId ());
+        }
+
+        int currentStep = 0;
+        vector<PartitioningScheme *> chunk;
+        vector<vector<unsigned> > chunkKappa;
+        chunk.reserve (EXHAUSTIVE_CHUNK_SIZE);
+        do
+        {
+          /* stream the next chunk of schemes that may beat the best one */
+          chunk.clear ();
+          chunkKappa.clear ();
+          while (chunk.size () < EXHAUSTIVE_CHUNK_SIZE
+              && state.position < totalSchemes)
+          {
+            const vector<unsigned> & kappa = **it;
+            if (getIcLowerBound (kappa, it->subsets ()) >= bestScore)
+            {
+              state.skipped++;
+            }
+            else
+            {
+              chunk.push_back (buildScheme (kappa, it->subsets ()));
+              chunkKappa.push_back (kappa);
+            }
+            if (++state.position < totalSchemes)
+              advance (it);
+          }
+          state.kappa = **it;
+
+          continueExec = !chunk.empty ();
+#ifdef HAVE_MPI
+          MPI_Bcast (&continueExec, 1, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
+          if (!continueExec)
+            break;
+
+          cout << timestamp () << " [EXH] Step " << ++currentStep << ": "
+              << chunk.size () << " schemes" << endl;
+          schemeManager.addSchemes (chunk);
+          schemeManager.optimize (mo);
+
+          for (size_t i = 0; i < chunk.size (); i++)
+          {
+            double score = chunk[i]->getIcValue ();
+            if (score < bestScore)
+            {
+              if (bestScheme)
+                delete bestScheme;
+              bestScheme = chunk[i];
+              bestScore = score;
+              state.bestKappa = chunkKappa[i];
+              PartitionMap::getInstance ()->keep (bestScheme->getId ());
+            }
+            else
+            {
+              delete chunk[i];
+            }
+          }
+          state.evaluated += chunk.size ();
+
+          printStepLog (currentStep, bestScheme, (size_t) state.skipped);
+          printStep (SearchExhaustive, bestScore);
+          cout << timestamp () << " [EXH] Evaluated " << state.evaluated
+              << " and skipped " << state.skipped << " out of "
+              << state.position << "/" << totalSchemes << " schemes"
+              << endl;
+
+          saveCheckpoint (state);
+        } while (continueExec);
+
+        delete it;
       }
+#ifdef HAVE_MPI
       else
       {
-        //TODO: UNINPLEMENTED
-        cerr << "TO BE IMPLEMENTED" << endl;
-        exit_partest (EX_UNAVAILABLE);
+        /* single gene elements */
+        schemeManager.optimize (mo);
+        MPI_Bcast (&continueExec, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        while (continueExec)
+        {
+          schemeManager.optimize (mo);
+          MPI_Bcast (&continueExec, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        }
       }
-
+#endif
     }
     return bestScheme;
 
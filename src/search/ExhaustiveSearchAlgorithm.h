@@ -26,6 +26,12 @@
 #define EXHAUSTIVESEARCHALGORITHM_H_
 
 #include "SearchAlgorithm.h"
+#include "util/Stirling.h"
+
+#include <vector>
+
+/** Number of candidate schemes optimized at once */
+#define EXHAUSTIVE_CHUNK_SIZE 256
 
 namespace partest
 {
@@ -35,6 +41,13 @@ namespace partest
    *
    * This algorithm constructs and evaluates all possible partitioning schemes.
    * It is not recommended at all unless the number of gene-partitions is very very low.
+   *
+   * Unless a fixed set of schemes is given, the schemes are streamed from
+   * the restricted growth strings of the Stirling iterators, either all of
+   * them or only those with exactly exhaustive_k subsets. They are evaluated
+   * in chunks, so the elements shared among schemes are optimized only once,
+   * and the schemes whose IC lower bound cannot beat the best score are
+   * skipped. The enumeration position is checkpointed after every chunk.
    */
   class ExhaustiveSearchAlgorithm : public SearchAlgorithm
   {
@@ -42,6 +55,53 @@ namespace partest
     ExhaustiveSearchAlgorithm ();
     virtual ~ExhaustiveSearchAlgorithm ();
     virtual PartitioningScheme * start (PartitioningScheme * startingPoint = 0);
+  private:
+    /** Builds the scheme of a restricted growth string */
+    static PartitioningScheme * buildScheme (const std::vector<unsigned> & kappa,
+                                             unsigned numberOfSubsets);
+
+    /** Moves the iterator to the next scheme */
+    static void advance (Stirling::iterator * it);
+
+    /**
+     * @brief Gathers the single gene results used for the IC lower bounds
+     *
+     * @param[in] singleGeneScheme The optimized K=N scheme
+     */
+    void setBoundData (PartitioningScheme * singleGeneScheme);
+
+    /**
+     * @brief Computes a lower bound of the IC value of a scheme
+     *
+     * Single gene subsets contribute their exact score. Larger subsets
+     * cannot reach a higher likelihood than the sum of the best candidate
+     * likelihoods of their genes, and need at least as many free parameters
+     * as the simplest candidate model.
+     *
+     * @return The lower bound, or -DOUBLE_INF if it cannot be computed.
+     */
+    double getIcLowerBound (const std::vector<unsigned> & kappa,
+                            unsigned numberOfSubsets);
+
+    /** Enumeration state kept in the checkpoint */
+    struct enumerationState
+    {
+      unsigned long long position; /** Index of the next scheme */
+      unsigned long long evaluated; /** Number of optimized schemes */
+      unsigned long long skipped; /** Number of schemes skipped by bound */
+      std::vector<unsigned> kappa; /** Next scheme */
+      std::vector<unsigned> bestKappa; /** Best scheme, empty if none */
+    };
+
+    void saveCheckpoint (const enumerationState & state);
+    bool loadCheckpoint (enumerationState & state);
+
+    std::vector<double> geneMaxLnL; /** Best candidate likelihood per gene */
+    std::vector<double> geneLnL; /** Likelihood of the best model per gene */
+    std::vector<double> geneValue; /** IC value of the best model per gene */
+    std::vector<int> geneParameters; /** Model parameters of the best model */
+    std::vector<size_t> geneSampleSize; /** Sample size per gene */
+    int minParameters; /** Free parameters of the simplest candidate */
   };
 
 } /* namespace partest */
@@ -0,0 +1,264 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file GreedyExtendedSearchAlgorithm.cpp
+ * @author Diego Darriba
+ */
+
+#include "GreedyExtendedSearchAlgorithm.h"
+
+#include "util/Utilities.h"
+#include "exe/ModelOptimize.h"
+#include "indata/PartitionMap.h"
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+
+namespace partest
+{
+
+  GreedyExtendedSearchAlgorithm::GreedyExtendedSearchAlgorithm ()
+  {
+  }
+
+  GreedyExtendedSearchAlgorithm::~GreedyExtendedSearchAlgorithm ()
+  {
+  }
+
+  double GreedyExtendedSearchAlgorithm::getBeamCutoff (
+      vector<PartitioningScheme *> & beam,
+      vector<vector<mergeCandidate> > & expansions)
+  {
+    vector<double> scores;
+    for (size_t b = 0; b < beam.size (); b++)
+    {
+      PartitioningScheme * scheme = beam[b];
+      for (size_t i = 0; i < expansions[b].size (); i++)
+      {
+        const mergeCandidate & candidate = expansions[b][i];
+        if (candidate.merged->isOptimized ())
+        {
+          scores.push_back (
+              scheme->getMergeIcValue (
+                  scheme->getElement (candidate.elementIndex1),
+                  scheme->getElement (candidate.elementIndex2),
+                  candidate.merged));
+        }
+      }
+    }
+
+    if (scores.size () < beam_width)
+      return DOUBLE_INF;
+    nth_element (scores.begin (), scores.begin () + (beam_width - 1),
+                 scores.end ());
+    return scores[beam_width - 1];
+  }
+
+  PartitioningScheme * GreedyExtendedSearchAlgorithm::start (
+      PartitioningScheme * startingPoint)
+  {
+
+    SchemeManager schemeManager;
+
+    PartitioningScheme *bestScheme = 0;
+    double bestScore = DOUBLE_INF;
+    vector<PartitioningScheme *> beam;
+    int currentStep = 0;
+    size_t maxSteps = number_of_genes;
+
+    int continueExec = (number_of_genes > 1);
+    if (I_AM_ROOT)
+    {
+
+      /* building first scheme */
+      cout << timestamp () << " [GRE] Step " << ++currentStep << "/" << maxSteps
+          << endl;
+      if (startingPoint)
+      {
+        bestScheme = startingPoint;
+        maxSteps = startingPoint->getNumberOfElements ();
+      }
+      else
+      {
+        t_partitioningScheme firstSchemeId (number_of_genes);
+        for (size_t gene = 0; gene < number_of_genes; gene++)
+        {
+          firstSchemeId.at (gene) = PartitionElementId::singleGene (gene);
+        }
+        bestScheme = new PartitioningScheme (&firstSchemeId);
+      }
+      beam.push_back (bestScheme);
+
+      schemeManager.addScheme (bestScheme);
+      schemeManager.optimize (mo);
+#ifdef HAVE_MPI
+      MPI_Bcast (&continueExec, 1, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
+
+      printStepLog (currentStep, bestScheme);
+      bestScore = bestScheme->getIcValue ();
+
+      while (continueExec)
+      {
+        cout << timestamp () << " [GRE] Step " << ++currentStep << "/"
+            << maxSteps << " (beam of " << beam.size () << " schemes)"
+            << endl;
+
+        /* expand every scheme in the beam */
+        vector<vector<mergeCandidate> > expansions (beam.size ());
+        size_t numberOfMerges = 0;
+        for (size_t b = 0; b < beam.size (); b++)
+        {
+          getMergeCandidates (beam[b], DOUBLE_INF, expansions[b]);
+          numberOfMerges += expansions[b].size ();
+        }
+
+        /* merges that cannot beat the beam_width known scores are hopeless */
+        double cutoff = getBeamCutoff (beam, expansions);
+        size_t skipped = 0;
+        for (size_t b = 0; b < beam.size (); b++)
+        {
+          vector<mergeCandidate> & candidates = expansions[b];
+          size_t kept = 0;
+          for (size_t i = 0; i < candidates.size (); i++)
+          {
+            mergeCandidate & candidate = candidates[i];
+            if (!candidate.merged->isOptimized ()
+                && beam[b]->getMergeIcLowerBound (
+                    beam[b]->getElement (candidate.elementIndex1),
+                    beam[b]->getElement (candidate.elementIndex2)) >= cutoff)
+            {
+              skipped++;
+              continue;
+            }
+            /* shared elements are optimized only once */
+            if (!candidate.merged->isOptimized ())
+              schemeManager.addElement (candidate.merged);
+            candidates[kept++] = candidate;
+          }
+          candidates.resize (kept);
+        }
+        schemeManager.optimize (mo);
+
+        if (skipped)
+        {
+          cout << timestamp () << " [GRE] Skipped " << skipped << "/"
+              << numberOfMerges << " merges by IC lower bound" << endl;
+        }
+
+        /* rank the merges of the whole beam */
+        vector<beamCandidate> ranking;
+        ranking.reserve (numberOfMerges - skipped);
+        for (size_t b = 0; b < beam.size (); b++)
+        {
+          PartitioningScheme * scheme = beam[b];
+          for (size_t i = 0; i < expansions[b].size (); i++)
+          {
+            beamCandidate bc;
+            bc.parent = b;
+            bc.merge = expansions[b][i];
+            bc.score = scheme->getMergeIcValue (
+                scheme->getElement (bc.merge.elementIndex1),
+                scheme->getElement (bc.merge.elementIndex2), bc.merge.merged);
+            ranking.push_back (bc);
+          }
+        }
+        stable_sort (ranking.begin (), ranking.end ());
+
+        /* different parents can lead to the same scheme */
+        vector<PartitioningScheme *> nextBeam;
+        for (size_t i = 0; i < ranking.size () && nextBeam.size () < beam_width;
+            i++)
+        {
+          PartitioningScheme * scheme = buildMergedScheme (
+              beam[ranking[i].parent], ranking[i].merge);
+          bool duplicated = false;
+          for (size_t j = 0; j < nextBeam.size () && !duplicated; j++)
+          {
+            duplicated = (nextBeam[j]->getId () == scheme->getId ());
+          }
+          if (duplicated)
+            delete scheme;
+          else
+            nextBeam.push_back (scheme);
+        }
+
+        for (size_t b = 0; b < beam.size (); b++)
+        {
+          if (beam[b] != bestScheme)
+            delete beam[b];
+        }
+        beam = nextBeam;
+
+        if (beam.empty ())
+        {
+          continueExec = false;
+#ifdef HAVE_MPI
+          MPI_Bcast (&continueExec, 1, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
+          break;
+        }
+
+        double score = beam[0]->getIcValue ();
+        printStepLog (currentStep, beam[0], skipped);
+
+        bool improved = (score < bestScore);
+        if (improved)
+        {
+          /* the starting point belongs to the caller */
+          if (bestScheme != startingPoint)
+            delete bestScheme;
+          bestScheme = beam[0];
+          bestScore = score;
+        }
+        printStep (SearchGreedyExtended, score);
+
+        continueExec = ((non_stop || improved)
+            && (beam[0]->getNumberOfElements () > 1));
+
+#ifdef HAVE_MPI
+        MPI_Bcast (&continueExec, 1, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
+      }
+
+      for (size_t b = 0; b < beam.size (); b++)
+      {
+        if (beam[b] != bestScheme)
+          delete beam[b];
+      }
+    }
+
+#ifdef HAVE_MPI
+    else
+    {
+      /* the root optimizes the first scheme even for a single gene */
+      do
+      {
+        schemeManager.optimize (mo);
+        MPI_Bcast (&continueExec, 1, MPI_INT, 0, MPI_COMM_WORLD);
+      }
+      while (continueExec);
+    }
+#endif
+
+    return bestScheme;
+  }
+
+} /* namespace partest */
@@ -0,0 +1,80 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file GreedyExtendedSearchAlgorithm.h
+ * @author Diego Darriba
+ * @brief Algorithm for performing a greedy beam search
+ */
+
+#ifndef GREEDYEXTENDEDSEARCHALGORITHM_H_
+#define GREEDYEXTENDEDSEARCHALGORITHM_H_
+
+#include "GreedySearchAlgorithm.h"
+
+#include "util/GlobalDefs.h"
+#include <vector>
+
+namespace partest
+{
+
+  /**
+   * @brief Extended greedy search, keeping the beam_width best schemes of
+   * every step instead of only the best one.
+   *
+   * Every scheme in the beam is expanded with all its pairwise merges. The
+   * expansions of different schemes share most merged elements through the
+   * partition map, so the unique elements of a step are optimized in a
+   * single batch. Merges whose IC lower bound cannot enter the next beam
+   * are not optimized.
+   *
+   * The search stops when no scheme of the next beam improves the best
+   * score, unless non_stop is set.
+   */
+  class GreedyExtendedSearchAlgorithm : public GreedySearchAlgorithm
+  {
+  public:
+    GreedyExtendedSearchAlgorithm ();
+    virtual ~GreedyExtendedSearchAlgorithm ();
+    virtual PartitioningScheme * start (PartitioningScheme * startingPoint = 0);
+  private:
+    /** Merge of a scheme in the beam */
+    struct beamCandidate
+    {
+      double score; /** IC value of the merged scheme */
+      size_t parent; /** Index of the scheme in the beam */
+      mergeCandidate merge;
+      bool operator< (const beamCandidate & other) const
+      {
+        return score < other.score;
+      }
+    };
+
+    /**
+     * @brief Gets the score over which a merge cannot enter the next beam
+     *
+     * It is the beam_width-th best score among the merges whose element is
+     * already optimized, or DOUBLE_INF if there are not enough of them.
+     */
+    static double getBeamCutoff (std::vector<PartitioningScheme *> & beam,
+                                 std::vector<std::vector<mergeCandidate> > & expansions);
+  };
+
+} /* namespace partest */
+
+#endif /* GREEDYEXTENDEDSEARCHALGORITHM_H_ */
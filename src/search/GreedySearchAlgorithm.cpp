@@ -34,46 +34,63 @@ using namespace std;
 namespace partest
 {
 
-  struct nextSchemeFunctor
+  struct nextMergeFunctor
   {
-    nextSchemeFunctor (PartitioningScheme * _scheme) :
-        elementIndex1 (1), elementIndex2 (0), scheme (_scheme)
+    nextMergeFunctor (PartitioningScheme * _scheme, double _threshold =
+                          DOUBLE_INF) :
+        elementIndex1 (1), elementIndex2 (0), scheme (_scheme),
+        threshold (_threshold), skippedSchemes (0)
     {
       numberOfElements = scheme->getNumberOfElements ();
       numberOfSchemes = (numberOfElements * (numberOfElements - 1)) / 2;
       currentScheme = 0;
     }
 
-    ~nextSchemeFunctor ()
+    ~nextMergeFunctor ()
     {
 
     }
-    PartitioningScheme * operator() (void)
+    bool operator() (mergeCandidate & candidate)
     {
 
-      if (currentScheme >= numberOfSchemes)
-        return 0;
-
-      t_partitioningScheme nextSchemeId;
-      nextSchemeId.reserve (numberOfElements - 1);
+      /* skip the merges that cannot improve the threshold score */
+      while (currentScheme < numberOfSchemes
+          && scheme->getMergeIcLowerBound (
+              scheme->getElement (elementIndex1),
+              scheme->getElement (elementIndex2)) >= threshold)
+      {
+        skippedSchemes++;
+        nextPair ();
+      }
 
-      t_partitionElementId e1 = scheme->getElement (elementIndex1)->getId ();
-      t_partitionElementId e2 = scheme->getElement (elementIndex2)->getId ();
-      t_partitionElementId nextId;
-      Utilities::mergeIds (nextId, e1, e2);
-      nextSchemeId.push_back (nextId);
+      if (currentScheme >= numberOfSchemes)
+        return false;
 
-      /* fill */
-      for (size_t k = 0; k < numberOfElements; k++)
-      {
+      /* the scratch identifier keeps its storage, so no allocation is done
+       * unless the merged element is new to the partition map */
+      Utilities::mergeIds (mergedId,
+                           scheme->getElement (elementIndex1)->getId (),
+                           scheme->getElement (elementIndex2)->getId ());
+      candidate.elementIndex1 = elementIndex1;
+      candidate.elementIndex2 = elementIndex2;
+      candidate.merged = PartitionMap::getInstance ()->getPartitionElement (
+          mergedId);
 
-        t_partitionElementId eX = scheme->getElement (k)->getId ();
-        if (eX != e1 && eX != e2)
-        {
-          nextSchemeId.push_back (eX);
-        }
-      }
+      nextPair ();
 
+      return true;
+    }
+    size_t size ()
+    {
+      return ((numberOfElements * (numberOfElements - 1)) / 2);
+    }
+    size_t skipped ()
+    {
+      return skippedSchemes;
+    }
+  private:
+    void nextPair (void)
+    {
       currentScheme++;
       elementIndex2++;
       if (elementIndex2 == elementIndex1)
@@ -81,60 +98,54 @@ namespace partest
         elementIndex1++;
         elementIndex2 = 0;
       }
-
-      return (new PartitioningScheme (&nextSchemeId));
-    }
-    size_t size ()
-    {
-      return ((numberOfElements * (numberOfElements - 1)) / 2);
     }
-  private:
+
     size_t elementIndex1, elementIndex2;
     size_t numberOfElements, numberOfSchemes, currentScheme;
     PartitioningScheme * scheme;
+    double threshold;
+    size_t skippedSchemes;
+    t_partitionElementId mergedId; /** Scratch identifier of the merges */
   };
 
-  GreedySearchAlgorithm::GreedySearchAlgorithm ()
+  size_t GreedySearchAlgorithm::getMergeCandidates (
+      PartitioningScheme * scheme, double threshold,
+      vector<mergeCandidate> & candidates)
   {
-  }
+    nextMergeFunctor nextMerge (scheme, threshold);
+    candidates.clear ();
+    candidates.reserve (nextMerge.size ());
 
-  GreedySearchAlgorithm::~GreedySearchAlgorithm ()
-  {
+    mergeCandidate candidate;
+    while (nextMerge (candidate))
+    {
+      candidates.push_back (candidate);
+    }
+    return nextMerge.skipped ();
   }
 
-  vector<PartitioningScheme *> GreedySearchAlgorithm::getNextSchemes (
-      const t_partitioningScheme * startingScheme)
+  PartitioningScheme * GreedySearchAlgorithm::buildMergedScheme (
+      PartitioningScheme * scheme, const mergeCandidate & candidate)
   {
-
-    vector<PartitioningScheme *> nextSchemes;
-    for (size_t i = 1; i < startingScheme->size (); i++)
+    t_partitioningScheme nextSchemeId;
+    nextSchemeId.reserve (scheme->getNumberOfElements () - 1);
+    nextSchemeId.push_back (candidate.merged->getId ());
+    for (size_t k = 0; k < scheme->getNumberOfElements (); k++)
     {
-      t_partitionElementId e1 = startingScheme->at (i);
-      for (size_t j = 0; j < i; j++)
+      if (k != candidate.elementIndex1 && k != candidate.elementIndex2)
       {
-
-        t_partitioningScheme nextSchemeId (startingScheme->size () - 1);
-
-        /* merge elements i and j */
-        t_partitionElementId e2 = startingScheme->at (j);
-        t_partitionElementId nextId;
-        Utilities::mergeIds (nextId, e1, e2);
-
-        /* fill */
-        for (size_t k = 0; k < startingScheme->size (); k++)
-        {
-
-          t_partitionElementId eX = startingScheme->at (k);
-          if (eX != e1 && eX != e2)
-          {
-            nextSchemeId.push_back (eX);
-          }
-        }
-        nextSchemes.push_back (new PartitioningScheme (&nextSchemeId));
+        nextSchemeId.push_back (scheme->getElement (k)->getId ());
       }
     }
-    return nextSchemes;
+    return new PartitioningScheme (&nextSchemeId);
+  }
 
+  GreedySearchAlgorithm::GreedySearchAlgorithm ()
+  {
+  }
+
+  GreedySearchAlgorithm::~GreedySearchAlgorithm ()
+  {
   }
 
   PartitioningScheme * GreedySearchAlgorithm::start (
@@ -169,9 +180,7 @@ namespace partest
             number_of_genes);
         for (size_t gene = 0; gene < number_of_genes; gene++)
         {
-          t_partitionElementId geneId (1);
-          geneId.at (0) = gene;
-          firstSchemeId->at (gene) = geneId;
+          firstSchemeId->at (gene) = PartitionElementId::singleGene (gene);
         }
 
         localBestScheme = bestScheme = new PartitioningScheme (firstSchemeId);
@@ -197,25 +206,65 @@ namespace partest
       {
         cout << timestamp () << " [GRE] Step " << ++currentStep << "/"
             << maxSteps << endl;
-        nextSchemeFunctor nextScheme (localBestScheme);
-        nextSchemes.reserve (nextScheme.size ());
-
-        while (PartitioningScheme * scheme = nextScheme ())
+        /* a merge whose IC lower bound does not beat the best score is
+         * hopeless, unless the search goes on through local maxima */
+        vector<mergeCandidate> candidates;
+        size_t skipped = getMergeCandidates (
+            localBestScheme, non_stop ? DOUBLE_INF : bestScore, candidates);
+        for (size_t i = 0; i < candidates.size (); i++)
         {
-          if (!scheme->isOptimized ())
-            schemeManager.addScheme (scheme);
-          nextSchemes.push_back (scheme);
+          if (!candidates[i].merged->isOptimized ())
+            schemeManager.addElement (candidates[i].merged);
         }
         schemeManager.optimize (mo);
 
+        if (skipped)
+        {
+          cout << timestamp () << " [GRE] Skipped " << skipped << "/"
+              << candidates.size () + skipped << " merges by IC lower bound"
+              << endl;
+        }
+
+        if (candidates.empty ())
+        {
+          /* no merge can improve the best scheme */
+          printStepLog (currentStep, localBestScheme, skipped);
+          continueExec = false;
+#ifdef HAVE_MPI
+          MPI_Bcast (&continueExec, 1, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
+          break;
+        }
+
         numberOfPartitions = localBestScheme->getNumberOfElements () - 1;
 
+        /* rank the merges by the IC of the resulting scheme, computed from
+         * the merged elements alone. Only the best one is built */
+        size_t bestCandidate = 0;
+        double bestMergeScore = DOUBLE_INF;
+        for (size_t i = 0; i < candidates.size (); i++)
+        {
+          double mergeScore = localBestScheme->getMergeIcValue (
+              localBestScheme->getElement (candidates[i].elementIndex1),
+              localBestScheme->getElement (candidates[i].elementIndex2),
+              candidates[i].merged);
+          if (mergeScore < bestMergeScore)
+          {
+            bestMergeScore = mergeScore;
+            bestCandidate = i;
+          }
+        }
+        nextSchemes.push_back (
+            buildMergedScheme (localBestScheme, candidates[bestCandidate]));
+
         PartitionSelector _ps (nextSchemes);
         //ps.print(cout);
+        if (localBestScheme != bestScheme)
+          delete localBestScheme;
         localBestScheme = _ps.getBestScheme ();
         score = localBestScheme->getIcValue ();
 
-        printStepLog (currentStep, localBestScheme);
+        printStepLog (currentStep, localBestScheme, skipped);
 
         if (score < bestScore)
         {
@@ -33,15 +33,43 @@
 namespace partest
 {
 
+  /** Candidate merge of two elements of a scheme */
+  struct mergeCandidate
+  {
+    size_t elementIndex1;
+    size_t elementIndex2;
+    PartitionElement * merged; /** Union of both elements */
+  };
+
   class GreedySearchAlgorithm : public partest::SearchAlgorithm
   {
   public:
     GreedySearchAlgorithm ();
     virtual ~GreedySearchAlgorithm ();
     virtual PartitioningScheme * start (PartitioningScheme * startingPoint = 0);
-  private:
-    std::vector<PartitioningScheme *> getNextSchemes (
-        const t_partitioningScheme * startingScheme);
+  protected:
+    /**
+     * @brief Gets the merges of every pair of elements of a scheme
+     *
+     * The merged elements are taken from the partition map, so they might
+     * be already optimized.
+     *
+     * @param[in] scheme The optimized scheme
+     * @param[in] threshold Merges whose IC lower bound is not below the
+     *            threshold are skipped
+     * @param[out] candidates The merges
+     *
+     * @return The number of skipped merges
+     */
+    static size_t getMergeCandidates (PartitioningScheme * scheme,
+                                      double threshold,
+                                      std::vector<mergeCandidate> & candidates);
+
+    /**
+     * @brief Builds the scheme resulting from a merge
+     */
+    static PartitioningScheme * buildMergedScheme (
+        PartitioningScheme * scheme, const mergeCandidate & candidate);
   };
 
 } /* namespace partest */
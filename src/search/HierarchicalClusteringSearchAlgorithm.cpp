@@ -29,6 +29,8 @@
 #include "exe/PartitionSelector.h"
 #include "indata/PartitioningScheme.h"
 #include "indata/PartitionMap.h"
+#include "indata/DistanceMatrix.h"
+#include "indata/NearestPairs.h"
 
 #include <iostream>
 #include <cmath>
@@ -52,6 +54,8 @@ namespace partest
 
     SchemeManager schemeManager;
     vector<PartitioningScheme *> nextSchemes;
+    DistanceMatrix distances;
+    NearestPairs nearestPairs (hcl_neighbours);
 
     PartitioningScheme *bestScheme = 0, *localBestScheme = 0;
     double bestScore, score;
@@ -75,9 +79,7 @@ namespace partest
             number_of_genes);
         for (size_t gene = 0; gene < number_of_genes; gene++)
         {
-          t_partitionElementId geneId (1);
-          geneId.at (0) = gene;
-          firstSchemeId->at (gene) = geneId;
+          firstSchemeId->at (gene) = PartitionElementId::singleGene (gene);
         }
         nextSchemes.push_back (new PartitioningScheme (firstSchemeId));
         maxSteps = firstSchemeId->size ();
@@ -86,6 +88,7 @@ namespace partest
       bestScore = DOUBLE_INF;
 
       int currentStep = 0;
+      size_t skippedSchemes = 0;
 
       while (continueExec)
       {
@@ -105,7 +108,7 @@ namespace partest
         localBestScheme = ps.getBestScheme ();
         score = ps.getBestScheme ()->getIcValue ();
 
-        printStepLog (currentStep, localBestScheme);
+        printStepLog (currentStep, localBestScheme, skippedSchemes);
 
         if (score < bestScore)
         {
@@ -124,9 +127,6 @@ namespace partest
 
         continueExec = ((non_stop || fabs (bestScore - score) < 1e-10)
             && (numberOfPartitions > 1));
-#ifdef HAVE_MPI
-        MPI_Bcast (&continueExec, 1, MPI_INT, 0, MPI_COMM_WORLD);
-#endif
         for (size_t i = 0; i < nextSchemes.size (); i++)
         {
           PartitioningScheme * scheme = nextSchemes.at (i);
@@ -137,37 +137,80 @@ namespace partest
 
         if (continueExec)
         {
-          vector<elementPair *> * eps = localBestScheme->getElementDistances ();
+          size_t numberOfElements = localBestScheme->getNumberOfElements ();
+          size_t numberOfPairs = numberOfElements * (numberOfElements - 1) / 2;
           int sample_size;
           if (max_samples)
           {
-            sample_size = min (max_samples, (int) eps->size ());
+            sample_size = min (max_samples, (int) numberOfPairs);
+          }
+          else
+          {
+            sample_size = max ((int) (numberOfPairs * samples_percent), 1);
+          }
+          vector<elementPair> eps;
+          if (hcl_neighbours)
+          {
+            /* sub-quadratic candidates for very large gene sets */
+            nearestPairs.getClosestPairs (localBestScheme,
+                                          (size_t) sample_size, eps);
           }
           else
           {
-            sample_size = max ((int) (eps->size () * samples_percent), 1);
+            /* only the rows of the merged elements change between steps */
+            distances.update (localBestScheme);
+            distances.getClosestPairs ((size_t) sample_size, eps);
           }
-          for (size_t i = 0; i < (size_t) sample_size; i++)
+          skippedSchemes = 0;
+          for (size_t i = 0; i < eps.size (); i++)
           {
+            /* a merge whose IC lower bound does not beat the best score is
+             * hopeless, unless the search goes on through local maxima */
+            if (!non_stop
+                && localBestScheme->getMergeIcLowerBound (eps[i].e1, eps[i].e2)
+                    >= bestScore)
+            {
+              skippedSchemes++;
+              continue;
+            }
+
             t_partitionElementId nextId;
             t_partitioningScheme nextScheme;
-            Utilities::mergeIds (nextId, eps->at (i)->e1->getId (),
-                                 eps->at (i)->e2->getId ());
+            Utilities::mergeIds (nextId, eps[i].e1->getId (),
+                                 eps[i].e2->getId ());
             nextScheme.push_back (nextId);
             for (size_t j = 0; j < localBestScheme->getNumberOfElements (); j++)
             {
 
               PartitionElement * element = localBestScheme->getElement (j);
-              if (element->getId () != eps->at (i)->e1->getId ()
-                  && element->getId () != eps->at (i)->e2->getId ())
+              if (element->getId () != eps[i].e1->getId ()
+                  && element->getId () != eps[i].e2->getId ())
               {
                 nextScheme.push_back (element->getId ());
               }
             }
             nextSchemes.push_back (new PartitioningScheme (&nextScheme));
           }
-          numberOfPartitions = nextSchemes.at (0)->getNumberOfElements ();
+
+          if (skippedSchemes)
+          {
+            cout << timestamp () << " [HCL] Skipped " << skippedSchemes << "/"
+                << sample_size << " merges by IC lower bound" << endl;
+          }
+
+          if (nextSchemes.empty ())
+          {
+            /* no merge can improve the best scheme */
+            continueExec = false;
+          }
+          else
+          {
+            numberOfPartitions = nextSchemes.at (0)->getNumberOfElements ();
+          }
         }
+#ifdef HAVE_MPI
+        MPI_Bcast (&continueExec, 1, MPI_INT, 0, MPI_COMM_WORLD);
+#endif
       }
     }
 #ifdef HAVE_MPI
@@ -30,6 +30,7 @@
 #include "indata/PartitioningScheme.h"
 #include "indata/PartitionMap.h"
 
+#include <algorithm>
 #include <iostream>
 #include <cmath>
 
@@ -38,7 +39,8 @@ using namespace std;
 namespace partest
 {
 
-  RandomSearchAlgorithm::RandomSearchAlgorithm ()
+  RandomSearchAlgorithm::RandomSearchAlgorithm () :
+      bestScheme (0)
   {
   }
 
@@ -46,179 +48,276 @@ namespace partest
   {
   }
 
+  double RandomSearchAlgorithm::randomUniform (unsigned int * seed)
+  {
+    *seed = *seed * 1103515245 + 12345;
+    return (double) ((*seed >> 8) & 0xFFFFFF) / 16777216.0;
+  }
+
+  size_t RandomSearchAlgorithm::randomIndex (unsigned int * seed, size_t n)
+  {
+    size_t index = (size_t) (randomUniform (seed) * (double) n);
+    return index < n ? index : n - 1;
+  }
+
+  PartitioningScheme * RandomSearchAlgorithm::proposeMove (
+      PartitioningScheme * scheme, unsigned int * seed)
+  {
+    size_t numberOfElements = scheme->getNumberOfElements ();
+
+    vector<size_t> splittable;
+    for (size_t i = 0; i < numberOfElements; i++)
+    {
+      if (scheme->getElement (i)->getId ().size () > 1)
+        splittable.push_back (i);
+    }
+
+    bool canMerge = (numberOfElements > 1);
+    bool canSplit = !splittable.empty ();
+    if (!(canMerge || canSplit))
+      return 0;
+
+    t_partitioningScheme nextSchemeId;
+    if (canMerge && (!canSplit || randomUniform (seed) < 0.5))
+    {
+      /* merge two random elements */
+      size_t e1 = randomIndex (seed, numberOfElements);
+      size_t e2 = randomIndex (seed, numberOfElements - 1);
+      if (e2 >= e1)
+        e2++;
+
+      nextSchemeId.reserve (numberOfElements - 1);
+      t_partitionElementId mergedId;
+      Utilities::mergeIds (mergedId, scheme->getElement (e1)->getId (),
+                           scheme->getElement (e2)->getId ());
+      nextSchemeId.push_back (mergedId);
+      for (size_t i = 0; i < numberOfElements; i++)
+      {
+        if (i != e1 && i != e2)
+          nextSchemeId.push_back (scheme->getElement (i)->getId ());
+      }
+    }
+    else
+    {
+      /* split a random element in two non-empty random halves */
+      size_t e = splittable[randomIndex (seed, splittable.size ())];
+      vector<size_t> genes = scheme->getElement (e)->getId ().getGenes ();
+      size_t g1 = randomIndex (seed, genes.size ());
+      size_t g2 = randomIndex (seed, genes.size () - 1);
+      if (g2 >= g1)
+        g2++;
+
+      t_partitionElementId firstId, secondId;
+      for (size_t i = 0; i < genes.size (); i++)
+      {
+        if (i == g1 || (i != g2 && randomUniform (seed) < 0.5))
+          firstId.insert (genes[i]);
+        else
+          secondId.insert (genes[i]);
+      }
+
+      nextSchemeId.reserve (numberOfElements + 1);
+      nextSchemeId.push_back (firstId);
+      nextSchemeId.push_back (secondId);
+      for (size_t i = 0; i < numberOfElements; i++)
+      {
+        if (i != e)
+          nextSchemeId.push_back (scheme->getElement (i)->getId ());
+      }
+    }
+
+    return new PartitioningScheme (&nextSchemeId);
+  }
+
+  void RandomSearchAlgorithm::release (PartitioningScheme * scheme)
+  {
+    if (!scheme || scheme == bestScheme)
+      return;
+    for (size_t c = 0; c < chains.size (); c++)
+    {
+      if (chains[c].scheme == scheme)
+        return;
+    }
+    delete scheme;
+  }
+
   PartitioningScheme * RandomSearchAlgorithm::start (
       PartitioningScheme * startingPoint)
   {
 
     SchemeManager schemeManager;
-    vector<PartitioningScheme *> nextSchemes;
-
-    PartitioningScheme *bestScheme = 0, *localBestScheme = 0;
-    double bestScore, score;
 
-    ModelOptimize * modelOptimize = new ModelOptimize ();
+    double bestScore = DOUBLE_INF;
+    int continueExec = 1;
 
-    bool continueExec = true;
-    size_t maxSteps;
     if (I_AM_ROOT)
     {
+      /* every chain starts from the same scheme */
+      t_partitioningScheme firstSchemeId;
       if (startingPoint)
       {
-        nextSchemes.push_back (startingPoint);
-        maxSteps = startingPoint->getId ().size ();
+        firstSchemeId = startingPoint->getId ();
       }
       else
       {
-        /* building first scheme */
-        t_partitioningScheme * firstSchemeId = new t_partitioningScheme (
-            number_of_genes);
         for (size_t gene = 0; gene < number_of_genes; gene++)
         {
-          t_partitionElementId geneId (1);
-          geneId.at (0) = gene;
-          firstSchemeId->at (gene) = geneId;
+          firstSchemeId.push_back (PartitionElementId::singleGene (gene));
         }
-        nextSchemes.push_back (new PartitioningScheme (firstSchemeId));
-
-        maxSteps = firstSchemeId->size ();
-        delete firstSchemeId;
       }
 
-      bestScore = DOUBLE_INF;
-      int currentStep = 0;
-
-      while (continueExec)
+      chains.resize (search_chains);
+      for (size_t c = 0; c < search_chains; c++)
       {
+        chainState & chain = chains[c];
+        chain.scheme = new PartitioningScheme (&firstSchemeId);
+        chain.proposal = 0;
+        chain.temperature = search_temperature
+            * pow (search_temperature_ratio, (double) c);
+        chain.seed = (unsigned int) (search_seed
+            ^ (0x9E3779B9u * (unsigned int) (c + 1)));
+        chain.accepted = 0;
+        schemeManager.addScheme (chain.scheme);
+      }
+      unsigned int swapSeed = (unsigned int) search_seed;
 
-        cout << timestamp () << " [RND] Step " << ++currentStep << "/"
-            << maxSteps << endl;
-
-        for (size_t i = 0; i < nextSchemes.size (); i++)
-        {
-          PartitioningScheme * scheme = nextSchemes.at (i);
-          if (!scheme->isOptimized ())
-            schemeManager.addScheme (scheme);
-        }
-        schemeManager.optimize (mo);
-
-        PartitionSelector ps (nextSchemes);
-        localBestScheme = ps.getBestScheme ();
-        score = ps.getBestScheme ()->getIcValue ();
+      cout << timestamp () << " [RND] Step 0/" << search_steps << endl;
+      schemeManager.optimize (mo);
+      for (size_t c = 0; c < search_chains; c++)
+      {
+        chains[c].score = chains[c].scheme->getIcValue ();
+      }
+      bestScheme = chains[0].scheme;
+      bestScore = chains[0].score;
+      printStepLog (0, bestScheme);
 
-        if (score < bestScore)
+      size_t swaps = 0;
+      for (size_t step = 1; step <= search_steps; step++)
+      {
+        /* proposals of all chains are optimized in a single batch */
+        bool anyProposal = false;
+        for (size_t c = 0; c < search_chains; c++)
         {
-          delete bestScheme;
-          bestScheme = localBestScheme;
-          PartitionMap::getInstance ()->keep (bestScheme->getId ());
-          for (size_t i = 0; i < localBestScheme->getNumberOfElements (); i++)
+          chainState & chain = chains[c];
+          chain.proposal = proposeMove (chain.scheme, &chain.seed);
+          if (chain.proposal)
           {
-            PartitionMap::getInstance ()->purgePartitionMap (
-                localBestScheme->getElement (i)->getId ());
+            anyProposal = true;
+            schemeManager.addScheme (chain.proposal);
           }
-          bestScore = score;
         }
-        printStep (SearchRandom, score);
 
-        continueExec = ((non_stop || fabs (bestScore - score) < 1e-10)
-            && (localBestScheme->getNumberOfElements () > 1));
+        continueExec = anyProposal;
 #ifdef HAVE_MPI
         MPI_Bcast (&continueExec, 1, MPI_INT, 0, MPI_COMM_WORLD);
 #endif
-        for (size_t i = 0; i < nextSchemes.size (); i++)
+        if (!continueExec)
+          break;
+
+        cout << timestamp () << " [RND] Step " << step << "/" << search_steps
+            << endl;
+        schemeManager.optimize (mo);
+
+        /* Metropolis acceptance */
+        for (size_t c = 0; c < search_chains; c++)
         {
-          PartitioningScheme * scheme = nextSchemes.at (i);
-          if (scheme != localBestScheme)
-            delete scheme;
+          chainState & chain = chains[c];
+          if (!chain.proposal)
+            continue;
+
+          double score = chain.proposal->getIcValue ();
+          double delta = score - chain.score;
+          PartitioningScheme * rejected = chain.proposal;
+          if (delta <= 0.0
+              || randomUniform (&chain.seed) < exp (-delta / chain.temperature))
+          {
+            rejected = chain.scheme;
+            chain.scheme = chain.proposal;
+            chain.score = score;
+            chain.accepted++;
+          }
+          chain.proposal = 0;
+
+          PartitioningScheme * previousBest = 0;
+          if (chain.score < bestScore)
+          {
+            previousBest = bestScheme;
+            bestScheme = chain.scheme;
+            bestScore = chain.score;
+          }
+          /* the replaced state of this chain might be the previous best */
+          release (rejected);
+          if (previousBest != rejected)
+            release (previousBest);
         }
-        nextSchemes.clear ();
 
-        if (continueExec)
+        /* exchange the states of two neighbour temperatures */
+        if (search_chains > 1)
         {
-          getRandomPartitioningScheme (nextSchemes, max_samples,
-                                       localBestScheme->getId ());
+          size_t c = randomIndex (&swapSeed, search_chains - 1);
+          chainState & cold = chains[c];
+          chainState & hot = chains[c + 1];
+          double logRatio = (cold.score - hot.score)
+              * (1.0 / cold.temperature - 1.0 / hot.temperature);
+          if (logRatio >= 0.0 || randomUniform (&swapSeed) < exp (logRatio))
+          {
+            std::swap (cold.scheme, hot.scheme);
+            std::swap (cold.score, hot.score);
+            swaps++;
+          }
         }
+
+        printStepLog ((int) step, bestScheme);
+        printStep (SearchRandom, bestScore);
       }
-    }
+
 #ifdef HAVE_MPI
-    else
-    {
-      while (continueExec)
+      if (continueExec)
       {
-        schemeManager.optimize (mo);
+        /* every step was done */
+        continueExec = false;
         MPI_Bcast (&continueExec, 1, MPI_INT, 0, MPI_COMM_WORLD);
       }
-    }
 #endif
 
-    if (bestScheme != localBestScheme)
-      delete localBestScheme;
-
-    delete modelOptimize;
-    return bestScheme;
-  }
-
-  int RandomSearchAlgorithm::getRandomPartitioningScheme (
-      vector<PartitioningScheme *> & nextSchemes, int numberOfSchemes,
-      t_partitioningScheme p0)
-  {
-
-    size_t maxClasses = p0.size ();
-
-    for (int schemeIndex = 0; schemeIndex < numberOfSchemes; schemeIndex++)
-    {
-      t_partitionElementId * classes = (t_partitionElementId *) malloc (
-          maxClasses * sizeof(t_partitionElementId));
-
-      int numberOfClasses = 1;
-      // first element to the first
-      for (size_t k = 0; k < p0.at (0).size (); k++)
+      for (size_t c = 0; c < search_chains; c++)
       {
-        size_t singleP = p0.at (0).at (k);
-        classes[0].push_back (singleP);
+        cout << timestamp () << " [RND] Chain " << c + 1 << " (T="
+            << chains[c].temperature << ") accepted " << chains[c].accepted
+            << "/" << search_steps << " moves" << endl;
       }
-      for (size_t i = 1; i < maxClasses; i++)
+      if (search_chains > 1)
       {
-        int currentClass = 0;
-
-        //randomly assign each bit to each class
-        int rndNumber = rand () % numberOfClasses;
-        currentClass = rndNumber;
-        if (currentClass < numberOfClasses)
-        {
-          for (size_t k = 0; k < p0.at (i).size (); k++)
-          {
-            size_t singleP = p0.at (i).at (k);
-            classes[(size_t) currentClass].push_back (singleP);
-          }
-        }
-        else
-        {
-          currentClass = numberOfClasses;
-          for (size_t k = 0; k < p0.at (i).size (); k++)
-          {
-            size_t singleP = p0.at (i).at (k);
-            classes[currentClass].push_back (singleP);
-          }
-          numberOfClasses++;
-        }
-
-        free (classes);
+        cout << timestamp () << " [RND] " << swaps << " chain swaps" << endl;
       }
 
-      t_partitioningScheme * newSchemeId = new t_partitioningScheme (
-          (size_t) numberOfClasses);
-      for (size_t i = 0; i < (size_t) numberOfClasses; i++)
+      /* drop the chains, keeping the best scheme */
+      vector<PartitioningScheme *> remaining;
+      for (size_t c = 0; c < chains.size (); c++)
       {
-        for (size_t j = 0; j < classes[i].size (); j++)
-        {
-          newSchemeId->at (i).push_back (classes[i].at (j));
-        }
+        remaining.push_back (chains[c].scheme);
+      }
+      chains.clear ();
+      for (size_t i = 0; i < remaining.size (); i++)
+      {
+        release (remaining[i]);
+      }
+    }
+#ifdef HAVE_MPI
+    else
+    {
+      /* first scheme */
+      schemeManager.optimize (mo);
+      MPI_Bcast (&continueExec, 1, MPI_INT, 0, MPI_COMM_WORLD);
+      while (continueExec)
+      {
+        schemeManager.optimize (mo);
+        MPI_Bcast (&continueExec, 1, MPI_INT, 0, MPI_COMM_WORLD);
       }
-      nextSchemes.push_back (new PartitioningScheme (newSchemeId));
-      delete newSchemeId;
     }
+#endif
 
-    return 0;
+    return bestScheme;
   }
 
 } /* namespace partest */
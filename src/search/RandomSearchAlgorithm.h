@@ -28,15 +28,25 @@
 #include "SearchAlgorithm.h"
 #include "indata/PartitioningScheme.h"
 
+#include <vector>
+
 namespace partest
 {
 
   /**
-   * @brief Multi-stage search algorithm choosing random states.
+   * @brief Parallel tempering search over the partitioning schemes.
+   *
+   * A set of search_chains Markov chains walk the scheme space at
+   * geometrically increasing temperatures, starting at search_temperature
+   * and multiplied by search_temperature_ratio from one chain to the next. On every step each chain proposes
+   * either merging two of its elements or splitting one of them at random,
+   * and accepts the proposal with the Metropolis criterion on the IC score.
+   * Afterwards, a random pair of neighbour chains may swap their states, so
+   * the cold chain can escape local optima found by the hot ones.
    *
-   * This algorithms randomly selects a set of states using the Chinese Restaurant
-   * Process. On each stage reduces the states space depending on the best-fit
-   * partition of the previous state.
+   * Every chain draws from its own generator seeded from search_seed, so the
+   * search is reproducible. The proposals of all chains are optimized in a
+   * single batch per step, sharing the elements of the partition map.
    *
    * TODO: This algorithm can be combined with other using the best-fit partitions
    * as fixed starting points.
@@ -48,9 +58,39 @@ namespace partest
     virtual ~RandomSearchAlgorithm ();
     virtual PartitioningScheme * start (PartitioningScheme * startingPoint = 0);
   private:
-    int getRandomPartitioningScheme (
-        std::vector<PartitioningScheme *> & nextSchemes, int numberOfSchemes,
-        t_partitioningScheme p0);
+    /** State of a Markov chain */
+    struct chainState
+    {
+      PartitioningScheme * scheme; /** Current scheme */
+      PartitioningScheme * proposal; /** Scheme proposed in this step */
+      double score; /** IC value of the current scheme */
+      double temperature;
+      unsigned int seed; /** Generator state of the chain */
+      size_t accepted; /** Number of accepted proposals */
+    };
+
+    /** Gets a uniform random number in [0,1) */
+    static double randomUniform (unsigned int * seed);
+
+    /** Gets a uniform random index in [0,n) */
+    static size_t randomIndex (unsigned int * seed, size_t n);
+
+    /**
+     * @brief Proposes a random split or merge of a scheme
+     *
+     * @param[in] scheme The current scheme
+     * @param seed Generator state of the chain
+     *
+     * @return The proposed scheme, or 0 if no move is possible
+     */
+    static PartitioningScheme * proposeMove (PartitioningScheme * scheme,
+                                             unsigned int * seed);
+
+    /** Deletes a scheme unless it is the best or held by any chain */
+    void release (PartitioningScheme * scheme);
+
+    std::vector<chainState> chains;
+    PartitioningScheme * bestScheme;
   };
 
 } /* namespace partest */
@@ -24,11 +24,17 @@
 #include "SearchAlgorithm.h"
 
 #include "indata/PartitionMap.h"
+#include "exe/ElementScheduler.h"
+#include "exe/CostModel.h"
+#include "exe/WorkDirectory.h"
+#include "exe/ProcessPool.h"
 #include <iostream>
 #include <iomanip>
 #include <pthread.h>
 #include <memory>
 #include <cmath>
+#include <cstring>
+#include <string>
 #include <unistd.h>
 
 using namespace std;
@@ -60,7 +66,30 @@ namespace partest
     return (int) nextSchemes->size ();
   }
 
-  void SearchAlgorithm::printStepLog (int id, PartitioningScheme *bestScheme)
+  int SearchAlgorithm::SchemeManager::addElement (
+      PartitionElement * elementToAdd)
+  {
+    nextElements.push_back (elementToAdd);
+    return (int) nextElements.size ();
+  }
+
+  void SearchAlgorithm::SchemeManager::getPendingElements (
+      vector<PartitionElement *> & pending)
+  {
+    pending.clear ();
+    for (size_t i = 0; i < nextSchemes->size (); i++)
+    {
+      PartitioningScheme * scheme = nextSchemes->at (i);
+      for (size_t j = 0; j < scheme->getNumberOfElements (); j++)
+      {
+        pending.push_back (scheme->getElement (j));
+      }
+    }
+    pending.insert (pending.end (), nextElements.begin (), nextElements.end ());
+  }
+
+  void SearchAlgorithm::printStepLog (int id, PartitioningScheme *bestScheme,
+                                      size_t skippedSchemes)
   {
     (*ofs) << id << "\t" << fixed << setprecision (4) << bestScheme->getLnL ()
         << "\t" << bestScheme->getNumberOfFreeParameters () << "\t" << fixed
@@ -69,7 +98,8 @@ namespace partest
         << setprecision (4) << bestScheme->getAiccValue () << "\t" << fixed
         << setprecision (4) << bestScheme->getLinkedBicValue () << "\t" << fixed
         << setprecision (4) << bestScheme->getLinkedAicValue () << "\t" << fixed
-        << setprecision (4) << bestScheme->getLinkedAiccValue () << endl;
+        << setprecision (4) << bestScheme->getLinkedAiccValue () << "\t"
+        << skippedSchemes << endl;
   }
 
   void SearchAlgorithm::printStep (SearchAlgo algo, double nextScore)
@@ -125,47 +155,179 @@ namespace partest
   }
 
 #ifdef HAVE_MPI
-  void * distribute (void * arg)
+  /*
+   * MPI distribution protocol. Workers send the results of their last batch
+   * to the root, which replies with the next batch. The first results
+   * message is empty, and an empty batch tells the worker to stop. Every
+   * rank, including the root, optimizes its batches on its own threads, so
+   * a single rank per node shares the alignment among all its cores.
+   *
+   * Batch: number of elements, number of pending elements, and for each
+   *        element its pending index, number of id words and id words.
+   * Results: for each element its pending index, the length of the packed
+   *          result and the packed result (see PartitionElement::packResult).
+   */
+#define TAG_BATCH   1
+#define TAG_RESULTS 2
+
+  /* claims the largest pending elements up to a fraction of the remaining
+   * cost, so that the batches shrink as the step runs out of work. A batch
+   * holds at least one element per thread of the rank. */
+  static void claimBatch (vector<PartitionElement *> & pending,
+                          vector<size_t> & claimed)
   {
-    vector<PartitioningScheme *> * nextSchemes =
-        (vector<PartitioningScheme *> *) arg;
+    /* the distribute thread unpacks the results of claimed elements
+     * meanwhile, so only their locked state and their layout are read */
+    double remainingCost = 0.0;
+    for (size_t i = 0; i < pending.size (); i++)
+    {
+      if (!(pending[i]->isTagged () || pending[i]->isOptimized ()))
+        remainingCost += CostModel::getElementCost (pending[i]);
+    }
+    double targetCost = remainingCost / (2.0 * numProcs);
+    size_t minElements =
+        (size_t) (number_of_threads > 1 ? number_of_threads : 1);
 
-    if (numProcs > 1)
+    claimed.clear ();
+    double batchCost = 0.0;
+    for (size_t i = 0;
+        i < pending.size ()
+            && (claimed.size () < minElements || batchCost < targetCost); i++)
     {
-      int buf[3];
-      MPI_Status targetStatus;
-      for (size_t i = 0; i < nextSchemes->size (); i++)
+      if (pending[i]->tryTag ())
       {
-        PartitioningScheme * scheme = nextSchemes->at (i);
-        buf[2] = scheme->getNumberOfElements ();
-        for (size_t j = 0; j < scheme->getNumberOfElements (); j++)
-        {
-          PartitionElement * element = scheme->getElement (j);
-          if (!(element->isOptimized () || element->isTagged ()))
-          {
-            // wait for request
-            element->setTagged (true);
-            MPI_Recv (buf, 1, MPI_INT, MPI_ANY_SOURCE, 0, MPI_COMM_WORLD,
-                      &targetStatus);
-            buf[0] = element->getId ().size (); //getNumberOfSections();
-            buf[1] = j;
-            // send element
-            MPI_Ssend (buf, 3, MPI_INT, targetStatus.MPI_SOURCE, 1,
-                       MPI_COMM_WORLD);
-            MPI_Ssend (&(element->getId ().front ()), buf[0],
-            MPI_ELEMENT_ID_TYPE,
-                       targetStatus.MPI_SOURCE, 2, MPI_COMM_WORLD);
-          }
-        }
+        claimed.push_back (i);
+        batchCost += CostModel::getElementCost (pending[i]);
+      }
+    }
+  }
+
+  static void buildBatch (vector<PartitionElement *> & pending,
+                          vector<t_idWord> & batch)
+  {
+    vector<size_t> claimed;
+    claimBatch (pending, claimed);
+
+    batch.clear ();
+    batch.push_back ((t_idWord) claimed.size ());
+    batch.push_back ((t_idWord) pending.size ());
+    for (size_t i = 0; i < claimed.size (); i++)
+    {
+      const t_partitionElementId & id = pending[claimed[i]]->getId ();
+      batch.push_back ((t_idWord) claimed[i]);
+      batch.push_back ((t_idWord) id.getNumberOfWords ());
+      batch.insert (batch.end (), id.getWords (),
+                    id.getWords () + id.getNumberOfWords ());
+    }
+  }
+
+  /* optimizes a set of elements with the local threads */
+  static void optimizeLocal (ModelOptimize & mo,
+                             const vector<PartitionElement *> & elements,
+                             const vector<size_t> & indices,
+                             int numberOfPending)
+  {
+    if (number_of_threads > 1)
+    {
+      ElementScheduler scheduler (mo, number_of_threads);
+      for (size_t i = 0; i < elements.size (); i++)
+      {
+        scheduler.addElement (elements[i]);
       }
-      for (int i = 1; i < numProcs; i++)
+      scheduler.run ();
+    }
+    else
+    {
+      for (size_t i = 0; i < elements.size (); i++)
       {
-        MPI_Recv (buf, 1, MPI_INT, MPI_ANY_SOURCE, 0, MPI_COMM_WORLD,
-                  &targetStatus);
-        buf[0] = 0;
-        MPI_Ssend (buf, 3, MPI_INT, targetStatus.MPI_SOURCE, 1, MPI_COMM_WORLD);
+        mo.optimizePartitionElement (elements[i], (int) indices[i],
+                                     numberOfPending);
       }
     }
+  }
+
+  static void unpackResults (vector<PartitionElement *> & pending,
+                             const char * buffer, size_t length)
+  {
+    size_t offset = 0;
+    while (offset < length)
+    {
+      t_idWord header[2];
+      memcpy (header, buffer + offset, sizeof(header));
+      offset += sizeof(header);
+      pending[(size_t) header[0]]->unpackResult (buffer + offset,
+                                                 (size_t) header[1]);
+      offset += (size_t) header[1];
+    }
+  }
+
+  /* optimizes the elements of a batch and packs their results */
+  static size_t optimizeBatch (ModelOptimize & mo,
+                               const vector<t_idWord> & batch,
+                               string & results)
+  {
+    size_t numberOfElements = (size_t) batch[0];
+    int numberOfPending = (int) batch[1];
+    vector<PartitionElement *> elements (numberOfElements);
+    vector<size_t> indices (numberOfElements);
+    size_t offset = 2;
+    for (size_t i = 0; i < numberOfElements; i++)
+    {
+      indices[i] = (size_t) batch[offset++];
+      size_t numberOfWords = (size_t) batch[offset++];
+      t_partitionElementId id;
+      id.setWords (&batch[offset], numberOfWords);
+      offset += numberOfWords;
+      elements[i] = PartitionMap::getInstance ()->getPartitionElement (id);
+    }
+
+    optimizeLocal (mo, elements, indices, numberOfPending);
+
+    string buffer;
+    results.clear ();
+    for (size_t i = 0; i < numberOfElements; i++)
+    {
+      elements[i]->packResult (buffer);
+
+      t_idWord header[2];
+      header[0] = (t_idWord) indices[i];
+      header[1] = (t_idWord) buffer.size ();
+      results.append ((const char *) header, sizeof(header));
+      results.append (buffer);
+    }
+    return numberOfElements;
+  }
+
+  void * distribute (void * arg)
+  {
+    vector<PartitionElement *> * pending = (vector<PartitionElement *> *) arg;
+
+    int activeWorkers = numProcs - 1;
+    vector<vector<t_idWord> > batches ((size_t) numProcs);
+    vector<MPI_Request> requests ((size_t) numProcs, MPI_REQUEST_NULL);
+    vector<char> results;
+    MPI_Status status;
+    while (activeWorkers)
+    {
+      MPI_Probe (MPI_ANY_SOURCE, TAG_RESULTS, MPI_COMM_WORLD, &status);
+      int source = status.MPI_SOURCE;
+      int length;
+      MPI_Get_count (&status, MPI_BYTE, &length);
+      results.resize ((size_t) length + 1);
+      MPI_Recv (&(results.front ()), length, MPI_BYTE, source, TAG_RESULTS,
+                MPI_COMM_WORLD, &status);
+      unpackResults (*pending, &(results.front ()), (size_t) length);
+
+      /* the worker got its previous batch before sending the results */
+      MPI_Wait (&requests[(size_t) source], MPI_STATUS_IGNORE);
+      vector<t_idWord> & batch = batches[(size_t) source];
+      buildBatch (*pending, batch);
+      if (!batch[0])
+        activeWorkers--;
+      MPI_Isend (&(batch.front ()), (int) batch.size (), MPI_ELEMENT_ID_TYPE,
+                 source, TAG_BATCH, MPI_COMM_WORLD, &requests[(size_t) source]);
+    }
+    MPI_Waitall (numProcs, &(requests.front ()), MPI_STATUSES_IGNORE);
 
     return 0;
   }
@@ -173,86 +335,130 @@ namespace partest
 
   int SearchAlgorithm::SchemeManager::optimize (ModelOptimize &_mo)
   {
-    t_partitionElementId id (3);
+    /* signaled during the search bookkeeping of the previous step */
+    if (ModelOptimize::isInterrupted ())
+      ModelOptimize::exitInterrupted ();
+
+    vector<PartitionElement *> pending;
+    getPendingElements (pending);
+
 #ifdef HAVE_MPI
+    /* hand out the most expensive elements first */
+    ElementScheduler::sortByCost (pending);
+
     MPI_Barrier (MPI_COMM_WORLD);
-    MPI_Status status;
     if (I_AM_ROOT)
     {
       pthread_t t1;
-      pthread_create (&t1, NULL, &distribute, (void *) nextSchemes);
-      int nextItem = 1;
-      while (nextItem)
+      pthread_create (&t1, NULL, &distribute, (void *) &pending);
+      vector<size_t> claimed;
+      vector<PartitionElement *> elements;
+      claimBatch (pending, claimed);
+      while (claimed.size ())
       {
-        nextItem = 0;
-        for (size_t i = 0; i < nextSchemes->size (); i++)
+        elements.resize (claimed.size ());
+        for (size_t i = 0; i < claimed.size (); i++)
         {
-          PartitioningScheme * scheme = nextSchemes->at (i);
-          size_t numElements = scheme->getNumberOfElements ();
-          for (size_t j = 0; j < numElements; j++)
-          {
-            PartitionElement * element = scheme->getElement (j);
-            if (!(element->isOptimized () || element->isTagged ()))
-            {
-              element->setTagged (true);
-              nextItem = 1;
-              _mo.optimizePartitionElement (element, j, numElements);
-            }
-          }
+          elements[i] = pending[claimed[i]];
         }
+        optimizeLocal (_mo, elements, claimed, (int) pending.size ());
+        claimBatch (pending, claimed);
       }
+      /* every result is back once the workers are released */
       pthread_join (t1, NULL);
     }
     else
     {
-      int nextItem[3];
-      nextItem[0] = 1;
-      while (nextItem[0] > 0)
+      MPI_Status status;
+      MPI_Request resultsRequest;
+      string results;
+      vector<t_idWord> batch;
+      size_t batchSize = 1;
+      while (batchSize)
       {
-        MPI_Ssend (nextItem, 1, MPI_INT, 0, 0, MPI_COMM_WORLD);
-        MPI_Recv (nextItem, 3, MPI_INT, 0, 1, MPI_COMM_WORLD, &status);
-        if (nextItem[0])
+        MPI_Isend ((void *) results.data (), (int) results.size (), MPI_BYTE, 0,
+                   TAG_RESULTS, MPI_COMM_WORLD, &resultsRequest);
+        MPI_Probe (0, TAG_BATCH, MPI_COMM_WORLD, &status);
+        int count;
+        MPI_Get_count (&status, MPI_ELEMENT_ID_TYPE, &count);
+        batch.resize ((size_t) count);
+        MPI_Recv (&(batch.front ()), count, MPI_ELEMENT_ID_TYPE, 0, TAG_BATCH,
+                  MPI_COMM_WORLD, &status);
+        MPI_Wait (&resultsRequest, MPI_STATUS_IGNORE);
+        batchSize = optimizeBatch (_mo, batch, results);
+      }
+    }
+#else
+    if (coop_size > 1)
+    {
+      /* share the step with the processes using the same output directory */
+      ElementScheduler::sortByCost (pending);
+      WorkDirectory::optimize (_mo, pending);
+    }
+    else if (fork_workers > 1)
+    {
+      vector<PartitionElement *> elements;
+      for (size_t i = 0; i < pending.size (); i++)
+      {
+        if (pending[i]->tryTag ())
         {
-          t_partitionElementId id (nextItem[0]);
-          MPI_Recv (&(id.front ()), nextItem[0], MPI_ELEMENT_ID_TYPE, 0, 2,
-                    MPI_COMM_WORLD, &status);
-          PartitionElement * element =
-              PartitionMap::getInstance ()->getPartitionElement (id);
-          _mo.optimizePartitionElement (element, nextItem[1], nextItem[2]);
+          elements.push_back (pending[i]);
         }
       }
+      ElementScheduler::sortByCost (elements);
+      ProcessPool::optimize (_mo, elements);
     }
-
-    MPI_Barrier (MPI_COMM_WORLD);
-
-    if (I_AM_ROOT)
+    else if (number_of_threads > 1)
     {
-      for (size_t i = 0; i < nextSchemes->size (); i++)
+      /* gather every pending element from all schemes */
+      ElementScheduler scheduler (_mo, number_of_threads);
+      for (size_t i = 0; i < pending.size (); i++)
       {
-        PartitioningScheme * scheme = nextSchemes->at (i);
-        for (size_t j = 0; j < scheme->getNumberOfElements (); j++)
+        if (pending[i]->tryTag ())
         {
-          PartitionElement * element = scheme->getElement (j);
-          if (element->isTagged () && !element->isOptimized ())
-          {
-            if (int erno = element->loadData ())
-            {
-              cerr << "[ERROR " << erno << "] Cannot load data for element"
-                  << endl;
-              exit_partest (EX_IOERR);
-            }
-          }
+          scheduler.addElement (pending[i]);
         }
       }
+      if (scheduler.getNumberOfElements ())
+      {
+        cout << timestamp () << " - optimizing "
+            << scheduler.getNumberOfElements () << " elements from "
+            << nextSchemes->size () + nextElements.size ()
+            << " candidates on " << number_of_threads << " threads" << endl;
+      }
+      scheduler.run ();
     }
-#else
-    for (size_t i = 0; i < nextSchemes->size(); i++)
+    else
     {
-      PartitioningScheme * scheme = nextSchemes->at(i);
-      _mo.optimizePartitioningScheme(scheme, (int) i, (int) nextSchemes->size());
+      for (size_t i = 0;
+          i < nextSchemes->size () && !ModelOptimize::isInterrupted (); i++)
+      {
+        PartitioningScheme * scheme = nextSchemes->at (i);
+        _mo.optimizePartitioningScheme (scheme, (int) i,
+                                        (int) nextSchemes->size ());
+      }
+      for (size_t i = 0;
+          i < nextElements.size () && !ModelOptimize::isInterrupted (); i++)
+      {
+        if (!nextElements[i]->isOptimized ())
+        {
+          _mo.optimizePartitionElement (nextElements[i], (int) i,
+                                        (int) nextElements.size ());
+        }
+      }
     }
 #endif
+
+    /* the workers stopped starting models and returned, so the step is
+     * left unfinished and the queued checkpoints are written on exit */
+    if (ModelOptimize::isInterrupted ())
+      ModelOptimize::exitInterrupted ();
     nextSchemes->clear ();
+    nextElements.clear ();
+
+    /* workers are done, so least recently used elements can be evicted */
+    PartitionMap::getInstance ()->enforceMemoryBudget ();
+
     return 0;
   }
 
@@ -41,7 +41,8 @@ namespace partest
         PartitioningScheme * startingPoint = 0) = 0;
   protected:
     ModelOptimize mo;
-    void printStepLog (int id, PartitioningScheme * bestScheme);
+    void printStepLog (int id, PartitioningScheme * bestScheme,
+                       size_t skippedSchemes = 0);
     void printStep (SearchAlgo algo, double nextScore);
 
     class SchemeManager
@@ -52,9 +53,19 @@ namespace partest
 
       int addSchemes (std::vector<PartitioningScheme *> schemesToAdd);
       int addScheme (PartitioningScheme * schemeToAdd);
+
+      /**
+       * @brief Adds a single element, e.g., a candidate merge that is
+       * scored without building its scheme
+       */
+      int addElement (PartitionElement * elementToAdd);
       int optimize (ModelOptimize &mo);
     private:
+      /** Gathers the elements of the schemes and the single elements */
+      void getPendingElements (std::vector<PartitionElement *> & pending);
+
       std::vector<PartitioningScheme *> * nextSchemes;
+      std::vector<PartitionElement *> nextElements;
     };
   private:
     std::ofstream * ofs;
@@ -0,0 +1,378 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file AsyncWriter.cpp
+ * @author Diego Darriba
+ */
+
+#include "AsyncWriter.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+namespace partest
+{
+
+  bool AsyncWriter::synchronous = false;
+  AsyncWriter * AsyncWriter::instance = 0;
+
+  static pthread_mutex_t instanceLock = PTHREAD_MUTEX_INITIALIZER;
+
+  AsyncWriter::AsyncWriter () :
+      queuedBytes (0), writing (false), stopping (false), running (false),
+          recordsWritten (false)
+  {
+    pthread_mutex_init (&queueLock, NULL);
+    pthread_cond_init (&notEmpty, NULL);
+    pthread_cond_init (&notFull, NULL);
+    pthread_cond_init (&drained, NULL);
+
+    if (!synchronous)
+    {
+      if (pthread_create (&thread, NULL, writerThread, this))
+      {
+        cerr << "[ERROR] Cannot start the output writer thread" << endl;
+        exit_partest (EX_OSERR);
+      }
+      running = true;
+    }
+  }
+
+  AsyncWriter::~AsyncWriter ()
+  {
+    if (running)
+    {
+      pthread_mutex_lock (&queueLock);
+      stopping = true;
+      pthread_cond_signal (&notEmpty);
+      pthread_mutex_unlock (&queueLock);
+      pthread_join (thread, NULL);
+    }
+
+    for (map<string, int>::iterator it = logFiles.begin ();
+        it != logFiles.end (); it++)
+    {
+      close (it->second);
+    }
+
+    pthread_cond_destroy (&drained);
+    pthread_cond_destroy (&notFull);
+    pthread_cond_destroy (&notEmpty);
+    pthread_mutex_destroy (&queueLock);
+  }
+
+  AsyncWriter * AsyncWriter::getInstance ()
+  {
+    pthread_mutex_lock (&instanceLock);
+    if (!instance)
+    {
+      instance = new AsyncWriter ();
+    }
+    pthread_mutex_unlock (&instanceLock);
+    return instance;
+  }
+
+  void AsyncWriter::deleteInstance ()
+  {
+    /* the inherited locks of a forked worker might be held */
+    if (synchronous)
+      return;
+
+    pthread_mutex_lock (&instanceLock);
+    AsyncWriter * writer = instance;
+    if (writer && writer->running
+        && pthread_equal (pthread_self (), writer->thread))
+    {
+      /* exiting on an error of the writer itself */
+      pthread_mutex_unlock (&instanceLock);
+      return;
+    }
+    instance = 0;
+    pthread_mutex_unlock (&instanceLock);
+
+    delete writer;
+  }
+
+  void AsyncWriter::setSynchronous (void)
+  {
+    synchronous = true;
+  }
+
+  void AsyncWriter::append (const string & filename, const string & text)
+  {
+    if (synchronous)
+    {
+      appendFile (filename, text);
+      return;
+    }
+
+    queuedEntry entry;
+    entry.isRecord = false;
+    entry.slot = 0;
+    entry.filename = filename;
+    entry.data = text;
+    enqueue (entry);
+  }
+
+  void AsyncWriter::store (const t_partitionElementId & id,
+                           const string & payload, size_t slot)
+  {
+    if (synchronous)
+    {
+      CheckpointStore::getInstance ()->store (id, payload, slot);
+      return;
+    }
+
+    queuedEntry entry;
+    entry.isRecord = true;
+    entry.id = id;
+    entry.slot = slot;
+    entry.data = payload;
+    enqueue (entry);
+  }
+
+  bool AsyncWriter::find (const t_partitionElementId & id, string & payload,
+                          size_t slot)
+  {
+    if (synchronous)
+      return false;
+
+    pthread_mutex_lock (&queueLock);
+    map<t_recordKey, const string *>::iterator it = pendingRecords.find (
+        t_recordKey (id, slot));
+    bool found = (it != pendingRecords.end ());
+    if (found)
+      payload = *(it->second);
+    pthread_mutex_unlock (&queueLock);
+    return found;
+  }
+
+  void AsyncWriter::flush (void)
+  {
+    if (synchronous)
+      return;
+
+    pthread_mutex_lock (&queueLock);
+    while (!queue.empty () || writing)
+      pthread_cond_wait (&drained, &queueLock);
+    pthread_mutex_unlock (&queueLock);
+  }
+
+  void AsyncWriter::enqueue (queuedEntry & entry)
+  {
+    size_t bytes = entry.data.length ();
+
+    pthread_mutex_lock (&queueLock);
+    /* an entry larger than the whole queue is still accepted alone */
+    while (queuedBytes && queuedBytes + bytes > ASYNC_QUEUE_SIZE)
+      pthread_cond_wait (&notFull, &queueLock);
+
+    queue.push_back (queuedEntry ());
+    queuedEntry & queued = queue.back ();
+    queued.isRecord = entry.isRecord;
+    queued.id = entry.id;
+    queued.slot = entry.slot;
+    queued.filename.swap (entry.filename);
+    queued.data.swap (entry.data);
+    if (queued.isRecord)
+      pendingRecords[t_recordKey (queued.id, queued.slot)] = &queued.data;
+    queuedBytes += bytes;
+
+    pthread_cond_signal (&notEmpty);
+    pthread_mutex_unlock (&queueLock);
+  }
+
+  void AsyncWriter::writeBatch (list<queuedEntry> & batch)
+  {
+    vector<const t_partitionElementId *> ids;
+    vector<const string *> payloads;
+    vector<size_t> slots;
+    map<string, string> texts;
+    for (list<queuedEntry>::iterator it = batch.begin (); it != batch.end ();
+        it++)
+    {
+      if (it->isRecord)
+      {
+        ids.push_back (&it->id);
+        payloads.push_back (&it->data);
+        slots.push_back (it->slot);
+      }
+      else
+      {
+        texts[it->filename].append (it->data);
+      }
+    }
+
+    if (!ids.empty ())
+    {
+      CheckpointStore::getInstance ()->store (ids, payloads, slots);
+      recordsWritten = true;
+    }
+
+    for (map<string, string>::iterator it = texts.begin (); it != texts.end ();
+        it++)
+    {
+      map<string, int>::iterator file = logFiles.find (it->first);
+      if (file == logFiles.end ())
+      {
+        int fd = open (it->first.c_str (), O_WRONLY | O_APPEND | O_CREAT,
+                       0666);
+        if (fd < 0)
+        {
+          cerr << "[WARNING] Cannot open output file " << it->first << endl;
+          continue;
+        }
+        file = logFiles.insert (make_pair (it->first, fd)).first;
+      }
+      if (!writeFully (file->second, it->second))
+      {
+        cerr << "[WARNING] Cannot write output file " << it->first << ": "
+            << strerror (errno) << endl;
+      }
+    }
+  }
+
+  void AsyncWriter::sync (void)
+  {
+    if (recordsWritten)
+      CheckpointStore::getInstance ()->sync ();
+    for (map<string, int>::iterator it = logFiles.begin ();
+        it != logFiles.end (); it++)
+    {
+      fsync (it->second);
+    }
+  }
+
+  void AsyncWriter::appendFile (const string & filename, const string & text)
+  {
+    int fd = open (filename.c_str (), O_WRONLY | O_APPEND | O_CREAT, 0666);
+    if (fd < 0)
+    {
+      cerr << "[WARNING] Cannot open output file " << filename << endl;
+      return;
+    }
+    if (!writeFully (fd, text))
+    {
+      cerr << "[WARNING] Cannot write output file " << filename << ": "
+          << strerror (errno) << endl;
+    }
+    close (fd);
+  }
+
+  bool AsyncWriter::writeFully (int fd, const string & data)
+  {
+    const char * bytes = data.data ();
+    size_t length = data.length ();
+    while (length)
+    {
+      ssize_t written = write (fd, bytes, length);
+      if (written < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      bytes += written;
+      length -= (size_t) written;
+    }
+    return true;
+  }
+
+  void * AsyncWriter::writerThread (void * arg)
+  {
+    AsyncWriter * writer = (AsyncWriter *) arg;
+    list<queuedEntry> batch;
+    bool dirty = false;
+    time_t lastSync = time (NULL);
+
+    pthread_mutex_lock (&writer->queueLock);
+    while (true)
+    {
+      while (writer->queue.empty () && !writer->stopping)
+      {
+        if (!dirty)
+        {
+          pthread_cond_wait (&writer->notEmpty, &writer->queueLock);
+        }
+        else
+        {
+          /* wake up for synchronizing the written output */
+          struct timespec deadline;
+          deadline.tv_sec = lastSync + sync_interval;
+          deadline.tv_nsec = 0;
+          if (pthread_cond_timedwait (&writer->notEmpty, &writer->queueLock,
+                                      &deadline) == ETIMEDOUT)
+            break;
+        }
+      }
+      bool finishing = writer->stopping && writer->queue.empty ();
+
+      batch.swap (writer->queue);
+      writer->queuedBytes = 0;
+      writer->writing = true;
+      pthread_cond_broadcast (&writer->notFull);
+      pthread_mutex_unlock (&writer->queueLock);
+
+      if (!batch.empty ())
+      {
+        writer->writeBatch (batch);
+        dirty = true;
+      }
+      if (dirty && (finishing || time (NULL) >= lastSync + sync_interval))
+      {
+        writer->sync ();
+        dirty = false;
+        lastSync = time (NULL);
+      }
+
+      pthread_mutex_lock (&writer->queueLock);
+      /* the written records are found in the checkpoint store from now on */
+      for (list<queuedEntry>::iterator it = batch.begin ();
+          it != batch.end (); it++)
+      {
+        if (!it->isRecord)
+          continue;
+        map<t_recordKey, const string *>::iterator pending =
+            writer->pendingRecords.find (t_recordKey (it->id, it->slot));
+        if (pending != writer->pendingRecords.end ()
+            && pending->second == &it->data)
+          writer->pendingRecords.erase (pending);
+      }
+      batch.clear ();
+      writer->writing = false;
+      pthread_cond_broadcast (&writer->drained);
+
+      if (finishing)
+        break;
+    }
+    pthread_mutex_unlock (&writer->queueLock);
+
+    return 0;
+  }
+
+} /* namespace partest */
@@ -0,0 +1,168 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file AsyncWriter.h
+ *
+ * @brief Background writer of the checkpoint records and the log files
+ */
+
+#ifndef ASYNCWRITER_H_
+#define ASYNCWRITER_H_
+
+#include "util/GlobalDefs.h"
+#include "util/CheckpointStore.h"
+
+#include <list>
+#include <map>
+#include <string>
+#include <pthread.h>
+
+/** Maximum bytes queued before the producers wait for the writer */
+#define ASYNC_QUEUE_SIZE (32 * 1024 * 1024)
+
+namespace partest
+{
+
+  /**
+   * @brief Background writer of the checkpoint records and the log files.
+   *
+   * Optimization threads queue their output and go on. A single writer
+   * thread takes everything queued at once, appends the checkpoint records
+   * to the store in a single locked write and each log file in a single
+   * write, and synchronizes the written files to disk every sync_interval
+   * seconds. The queue is bounded, so fast producers wait for the writer
+   * instead of exhausting the memory.
+   *
+   * Queued checkpoint records are looked up before they are written, so
+   * evicted elements can be reloaded at any time. Everything queued is
+   * written and synchronized on normal exit and on exit_partest.
+   *
+   * Forked worker processes do not have the writer thread, so they write
+   * synchronously after calling setSynchronous.
+   */
+  class AsyncWriter
+  {
+  public:
+
+    /**
+     * @brief Queues text to be appended to a log file
+     *
+     * @param[in] filename The log file
+     * @param[in] text The text to append
+     */
+    void append (const std::string & filename, const std::string & text);
+
+    /**
+     * @brief Queues a checkpoint record
+     *
+     * @param[in] id The element id
+     * @param[in] payload The payload of the element
+     * @param[in] slot The slot of the record
+     */
+    void store (const t_partitionElementId & id, const std::string & payload,
+                size_t slot = CKP_ELEMENT_SLOT);
+
+    /**
+     * @brief Looks up a queued checkpoint record, not written yet
+     *
+     * @param[in] id The element id
+     * @param[out] payload The payload of the element
+     * @param[in] slot The slot of the record
+     *
+     * @return true, if the record is queued
+     */
+    bool find (const t_partitionElementId & id, std::string & payload,
+               size_t slot = CKP_ELEMENT_SLOT);
+
+    /**
+     * @brief Waits until everything queued so far is written, e.g., before
+     * other processes read it
+     */
+    void flush (void);
+
+    /**
+     * @brief Writes from this process without the writer thread, e.g., in
+     * forked worker processes
+     */
+    static void setSynchronous (void);
+
+    static AsyncWriter * getInstance (void);
+
+    /**
+     * @brief Writes and synchronizes everything queued, and stops the writer
+     * thread. It does nothing if called from the writer thread itself.
+     */
+    static void deleteInstance (void);
+
+  private:
+    /** Queued output, either a checkpoint record or a log text */
+    struct queuedEntry
+    {
+      bool isRecord;
+      t_partitionElementId id;
+      size_t slot;
+      std::string filename;
+      std::string data;
+    };
+
+    AsyncWriter ();
+    virtual ~AsyncWriter ();
+
+    /** Queues an entry, waiting while the queue is full */
+    void enqueue (queuedEntry & entry);
+
+    /** Writes a batch of entries, in the order they were queued */
+    void writeBatch (std::list<queuedEntry> & batch);
+
+    /** Synchronizes the written files to disk */
+    void sync (void);
+
+    /** Appends text to a file with a single write */
+    static void appendFile (const std::string & filename,
+                            const std::string & text);
+    static bool writeFully (int fd, const std::string & data);
+
+    static void * writerThread (void * arg);
+
+    std::list<queuedEntry> queue; /** Entries waiting for the writer */
+    size_t queuedBytes; /** Bytes of the queued data */
+    bool writing; /** Whether the writer is writing a batch */
+    bool stopping; /** Whether the writer must finish */
+    bool running; /** Whether the writer thread was started */
+    bool recordsWritten; /** Whether the checkpoint store must be synced */
+
+    typedef std::pair<t_partitionElementId, size_t> t_recordKey;
+
+    /** Queued or in-flight records, by element id and slot */
+    std::map<t_recordKey, const std::string *> pendingRecords;
+    std::map<std::string, int> logFiles; /** Open log files */
+
+    pthread_t thread;
+    pthread_mutex_t queueLock;
+    pthread_cond_t notEmpty; /** Signaled when entries are queued */
+    pthread_cond_t notFull; /** Signaled when the writer takes a batch */
+    pthread_cond_t drained; /** Signaled when the writer ends a batch */
+
+    static bool synchronous;
+    static AsyncWriter * instance;
+  };
+
+} /* namespace partest */
+
+#endif /* ASYNCWRITER_H_ */
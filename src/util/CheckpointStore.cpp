@@ -0,0 +1,518 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file CheckpointStore.cpp
+ * @author Diego Darriba
+ */
+
+#include "CheckpointStore.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+/** Magic string of the store header */
+#define CKP_STORE_MAGIC  "PARTEST"
+/** Magic number of every record */
+#define CKP_RECORD_MAGIC 0x43525450U
+
+using namespace std;
+
+namespace partest
+{
+
+  CheckpointStore * CheckpointStore::instance = 0;
+
+  static pthread_mutex_t instanceLock = PTHREAD_MUTEX_INITIALIZER;
+
+  static uint32_t crcTable[256];
+  static pthread_once_t crcTableOnce = PTHREAD_ONCE_INIT;
+
+  static void buildCrcTable (void)
+  {
+    for (uint32_t i = 0; i < 256; i++)
+    {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++)
+        c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+      crcTable[i] = c;
+    }
+  }
+
+  CheckpointStore::CheckpointStore () :
+      fd (-1), indexFd (-1), mapping (0), mappedSize (0), storeSize (0),
+          scannedSize (0)
+  {
+    pthread_mutex_init (&storeLock, NULL);
+    pthread_once (&crcTableOnce, buildCrcTable);
+
+    filename = ckpPath + os_separator + CKP_STORE_FILE;
+    indexFilename = ckpPath + os_separator + CKP_INDEX_FILE;
+    fd = open (filename.c_str (), O_RDWR | O_CREAT, 0666);
+    indexFd = open (indexFilename.c_str (), O_RDWR | O_CREAT, 0666);
+    if (fd < 0 || indexFd < 0)
+    {
+      cerr << "[ERROR] Cannot open the checkpoint store " << filename << endl;
+      exit_partest (EX_IOERR);
+    }
+
+    lock (true);
+    checkHeader ();
+    loadIndex (true);
+    unlock ();
+  }
+
+  CheckpointStore::~CheckpointStore ()
+  {
+    if (mapping)
+      munmap (mapping, mappedSize);
+    if (fd >= 0)
+      close (fd);
+    if (indexFd >= 0)
+      close (indexFd);
+    pthread_mutex_destroy (&storeLock);
+  }
+
+  CheckpointStore * CheckpointStore::getInstance ()
+  {
+    pthread_mutex_lock (&instanceLock);
+    if (!instance)
+    {
+      instance = new CheckpointStore ();
+    }
+    pthread_mutex_unlock (&instanceLock);
+    return instance;
+  }
+
+  void CheckpointStore::deleteInstance ()
+  {
+    pthread_mutex_lock (&instanceLock);
+    if (instance)
+    {
+      delete instance;
+      instance = 0;
+    }
+    pthread_mutex_unlock (&instanceLock);
+  }
+
+  bool CheckpointStore::load (const t_partitionElementId & id,
+                              string & payload, size_t slot)
+  {
+    pthread_mutex_lock (&storeLock);
+    bool found = find (id, slot, payload);
+    if (!found)
+    {
+      /* other processes might have stored it since the last scan */
+      lock (false);
+      scanRecords (false);
+      unlock ();
+      found = find (id, slot, payload);
+    }
+    pthread_mutex_unlock (&storeLock);
+    return found;
+  }
+
+  bool CheckpointStore::store (const t_partitionElementId & id,
+                               const string & payload, size_t slot)
+  {
+    vector<const t_partitionElementId *> ids (1, &id);
+    vector<const string *> payloads (1, &payload);
+    vector<size_t> slots (1, slot);
+    return store (ids, payloads, slots);
+  }
+
+  bool CheckpointStore::store (const vector<const t_partitionElementId *> & ids,
+                               const vector<const string *> & payloads,
+                               const vector<size_t> & slots)
+  {
+    string records;
+    vector<indexEntry> entries (ids.size ());
+    for (size_t i = 0; i < ids.size (); i++)
+    {
+      const t_partitionElementId & id = *ids[i];
+      recordHeader header;
+      header.magic = CKP_RECORD_MAGIC;
+      header.checksum = 0;
+      header.slot = slots[i];
+      header.numberOfWords = id.getNumberOfWords ();
+      header.payloadLength = payloads[i]->length ();
+
+      size_t start = records.length ();
+      records.append ((const char *) &header, sizeof(recordHeader));
+      records.append ((const char *) id.getWords (),
+                      id.getNumberOfWords () * sizeof(t_idWord));
+      records.append (*payloads[i]);
+      header.checksum = crc32 (
+          crc32 (0, &header.slot, sizeof(header.slot)),
+          records.data () + start + sizeof(recordHeader),
+          records.length () - start - sizeof(recordHeader));
+      records.replace (start, sizeof(recordHeader), (const char *) &header,
+                       sizeof(recordHeader));
+
+      entries[i].hash = recordHash (id, slots[i]);
+      entries[i].offset = start;
+    }
+    if (records.empty ())
+      return true;
+
+    pthread_mutex_lock (&storeLock);
+    lock (true);
+
+    struct stat st;
+    fstat (fd, &st);
+    uint64_t offset = (uint64_t) st.st_size;
+    bool written = writeFully (fd, records.data (), records.length (), offset);
+    if (written)
+    {
+      for (size_t i = 0; i < entries.size (); i++)
+        entries[i].offset += offset;
+      fstat (indexFd, &st);
+      writeFully (indexFd, &entries[0], entries.size () * sizeof(indexEntry),
+                  (uint64_t) st.st_size
+                      - (uint64_t) st.st_size % sizeof(indexEntry));
+
+      /* indexes the records, and those appended by other processes */
+      scanRecords (false);
+    }
+    else
+    {
+      cerr << "[WARNING] Cannot write element checkpoints to " << filename
+          << ": " << strerror (errno) << endl;
+      if (ftruncate (fd, (off_t) offset))
+      {
+        cerr << "[ERROR] Cannot restore the checkpoint store " << filename
+            << endl;
+        exit_partest (EX_IOERR);
+      }
+    }
+
+    unlock ();
+    pthread_mutex_unlock (&storeLock);
+    return written;
+  }
+
+  void CheckpointStore::sync (void)
+  {
+    pthread_mutex_lock (&storeLock);
+    fsync (fd);
+    fsync (indexFd);
+    pthread_mutex_unlock (&storeLock);
+  }
+
+  size_t CheckpointStore::getNumberOfRecords (void)
+  {
+    pthread_mutex_lock (&storeLock);
+    size_t numberOfRecords = index.size ();
+    pthread_mutex_unlock (&storeLock);
+    return numberOfRecords;
+  }
+
+  void CheckpointStore::checkHeader (void)
+  {
+    storeHeader expected;
+    memset (&expected, 0, sizeof(storeHeader));
+    strncpy (expected.magic, CKP_STORE_MAGIC, sizeof(expected.magic));
+    expected.version = CKP_STORE_VERSION;
+    expected.dataType = (uint32_t) data_type;
+    expected.numberOfTaxa = (uint64_t) num_taxa;
+    expected.numberOfModels = (uint64_t) number_of_models;
+
+    struct stat st;
+    fstat (fd, &st);
+    if ((size_t) st.st_size >= sizeof(storeHeader))
+    {
+      storeHeader stored;
+      if (pread (fd, &stored, sizeof(storeHeader), 0)
+          == (ssize_t) sizeof(storeHeader)
+          && !memcmp (&stored, &expected, sizeof(storeHeader)))
+        return;
+
+      if (!force_overriding)
+      {
+        cerr << "[ERROR]   ";
+      }
+      else
+      {
+        cerr << "[WARNING] ";
+      }
+      cerr << "Checkpoint store " << filename
+          << " was written by another version" << endl;
+      cerr << "          or configuration (data type, taxa or models)."
+          << endl;
+      if (!force_overriding)
+      {
+        cerr << endl
+            << "If you really want to proceed, remove checkpointing files or re-run with --force-override, --disable-output or --disable-ckp arguments."
+            << endl << endl;
+        exit_partest (EX_IOERR);
+      }
+      cerr << "          Existing checkpoints are discarded." << endl;
+    }
+
+    /* new store, or a header torn while it was created */
+    if (ftruncate (fd, 0) || ftruncate (indexFd, 0)
+        || !writeFully (fd, &expected, sizeof(storeHeader), 0))
+    {
+      cerr << "[ERROR] Cannot initialize the checkpoint store " << filename
+          << endl;
+      exit_partest (EX_IOERR);
+    }
+  }
+
+  bool CheckpointStore::find (const t_partitionElementId & id, size_t slot,
+                              string & payload)
+  {
+    size_t idLength = id.getNumberOfWords () * sizeof(t_idWord);
+    pair<multimap<uint64_t, uint64_t>::iterator,
+        multimap<uint64_t, uint64_t>::iterator> range = index.equal_range (
+        recordHash (id, slot));
+    for (multimap<uint64_t, uint64_t>::iterator it = range.first;
+        it != range.second; it++)
+    {
+      uint64_t offset = it->second;
+      uint64_t length = getRecordLength (offset);
+      if (!length)
+        continue;
+
+      recordHeader header;
+      memcpy (&header, mapping + offset, sizeof(recordHeader));
+      const char * data = mapping + offset + sizeof(recordHeader);
+      if (header.slot != slot || header.numberOfWords != id.getNumberOfWords ()
+          || memcmp (data, id.getWords (), idLength))
+        continue;
+
+      if (crc32 (crc32 (0, &header.slot, sizeof(header.slot)), data,
+                 (size_t) (length - sizeof(recordHeader))) != header.checksum)
+      {
+        cerr << "[WARNING] Discarding corrupted checkpoint record at offset "
+            << offset << " of " << filename << endl;
+        continue;
+      }
+
+      payload.assign (data + idLength, (size_t) header.payloadLength);
+      return true;
+    }
+    return false;
+  }
+
+  void CheckpointStore::loadIndex (bool repair)
+  {
+    remap ();
+
+    struct stat st;
+    fstat (indexFd, &st);
+    size_t numberOfEntries = (size_t) st.st_size / sizeof(indexEntry);
+    vector<indexEntry> entries (numberOfEntries);
+    if (numberOfEntries
+        && pread (indexFd, &entries[0], numberOfEntries * sizeof(indexEntry),
+                  0) != (ssize_t) (numberOfEntries * sizeof(indexEntry)))
+      numberOfEntries = 0;
+
+    /* the last entries might point to records lost in a crash */
+    while (numberOfEntries
+        && !getRecordLength (entries[numberOfEntries - 1].offset))
+      numberOfEntries--;
+    if (repair
+        && (off_t) (numberOfEntries * sizeof(indexEntry)) != st.st_size)
+    {
+      if (ftruncate (indexFd,
+                     (off_t) (numberOfEntries * sizeof(indexEntry))))
+      {
+        cerr << "[ERROR] Cannot repair the checkpoint index " << indexFilename
+            << endl;
+        exit_partest (EX_IOERR);
+      }
+    }
+
+    index.clear ();
+    for (size_t i = 0; i < numberOfEntries; i++)
+    {
+      index.insert (make_pair (entries[i].hash, entries[i].offset));
+    }
+    if (numberOfEntries)
+    {
+      uint64_t lastOffset = entries[numberOfEntries - 1].offset;
+      scannedSize = lastOffset + getRecordLength (lastOffset);
+    }
+    else
+    {
+      scannedSize = sizeof(storeHeader);
+    }
+
+    scanRecords (repair);
+  }
+
+  void CheckpointStore::scanRecords (bool repair)
+  {
+    remap ();
+
+    uint64_t length;
+    vector<t_idWord> words;
+    t_partitionElementId id;
+    while (scannedSize < storeSize
+        && (length = getRecordLength (scannedSize)))
+    {
+      recordHeader header;
+      memcpy (&header, mapping + scannedSize, sizeof(recordHeader));
+      words.resize ((size_t) header.numberOfWords);
+      if (header.numberOfWords)
+        memcpy (&words[0], mapping + scannedSize + sizeof(recordHeader),
+                (size_t) header.numberOfWords * sizeof(t_idWord));
+      id.setWords (header.numberOfWords ? &words[0] : 0,
+                   (size_t) header.numberOfWords);
+
+      indexEntry entry;
+      entry.hash = recordHash (id, (size_t) header.slot);
+      entry.offset = scannedSize;
+      index.insert (make_pair (entry.hash, entry.offset));
+      if (repair)
+      {
+        /* records written before a crash, but missing from the index */
+        struct stat st;
+        fstat (indexFd, &st);
+        writeFully (indexFd, &entry, sizeof(indexEntry),
+                    (uint64_t) st.st_size);
+      }
+      scannedSize += length;
+    }
+
+    if (repair && scannedSize < storeSize)
+    {
+      cerr << "[WARNING] Discarding truncated checkpoint record at the end of "
+          << filename << endl;
+      if (ftruncate (fd, (off_t) scannedSize))
+      {
+        cerr << "[ERROR] Cannot repair the checkpoint store " << filename
+            << endl;
+        exit_partest (EX_IOERR);
+      }
+      storeSize = scannedSize;
+    }
+  }
+
+  void CheckpointStore::remap (void)
+  {
+    struct stat st;
+    fstat (fd, &st);
+    storeSize = (uint64_t) st.st_size;
+    if (storeSize <= mappedSize)
+      return;
+
+    /* leave room to grow, so appending records rarely remaps the store */
+    if (mapping)
+      munmap (mapping, mappedSize);
+    uint64_t newSize = 2 * storeSize;
+    void * newMapping = mmap (0, (size_t) newSize, PROT_READ, MAP_SHARED, fd,
+                              0);
+    if (newMapping == MAP_FAILED)
+    {
+      cerr << "[ERROR] Cannot map the checkpoint store " << filename << ": "
+          << strerror (errno) << endl;
+      exit_partest (EX_IOERR);
+    }
+    mapping = (char *) newMapping;
+    mappedSize = newSize;
+  }
+
+  uint64_t CheckpointStore::getRecordLength (uint64_t offset) const
+  {
+    if (offset < sizeof(storeHeader)
+        || offset + sizeof(recordHeader) > storeSize)
+      return 0;
+
+    recordHeader header;
+    memcpy (&header, mapping + offset, sizeof(recordHeader));
+    if (header.magic != CKP_RECORD_MAGIC || header.numberOfWords > storeSize
+        || header.payloadLength > storeSize)
+      return 0;
+
+    uint64_t length = sizeof(recordHeader)
+        + header.numberOfWords * sizeof(t_idWord) + header.payloadLength;
+    return (offset + length <= storeSize) ? length : 0;
+  }
+
+  void CheckpointStore::lock (bool exclusive)
+  {
+    struct flock fl;
+    memset (&fl, 0, sizeof(fl));
+    fl.l_type = exclusive ? F_WRLCK : F_RDLCK;
+    fl.l_whence = SEEK_SET;
+    while (fcntl (fd, F_SETLKW, &fl))
+    {
+      if (errno != EINTR)
+      {
+        cerr << "[ERROR] Cannot lock the checkpoint store " << filename
+            << endl;
+        exit_partest (EX_IOERR);
+      }
+    }
+  }
+
+  void CheckpointStore::unlock (void)
+  {
+    struct flock fl;
+    memset (&fl, 0, sizeof(fl));
+    fl.l_type = F_UNLCK;
+    fl.l_whence = SEEK_SET;
+    fcntl (fd, F_SETLK, &fl);
+  }
+
+  uint64_t CheckpointStore::recordHash (const t_partitionElementId & id,
+                                        size_t slot)
+  {
+    return (uint64_t) id.hash () ^ ((uint64_t) slot * 0x9E3779B97F4A7C15ULL);
+  }
+
+  uint32_t CheckpointStore::crc32 (uint32_t crc, const void * data,
+                                   size_t length)
+  {
+    const unsigned char * bytes = (const unsigned char *) data;
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+      crc = crcTable[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+  }
+
+  bool CheckpointStore::writeFully (int fd, const void * data, size_t length,
+                                    uint64_t offset)
+  {
+    const char * bytes = (const char *) data;
+    while (length)
+    {
+      ssize_t written = pwrite (fd, bytes, length, (off_t) offset);
+      if (written < 0)
+      {
+        if (errno == EINTR)
+          continue;
+        return false;
+      }
+      bytes += written;
+      length -= (size_t) written;
+      offset += (uint64_t) written;
+    }
+    return true;
+  }
+
+} /* namespace partest */
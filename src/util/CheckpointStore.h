@@ -0,0 +1,199 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file CheckpointStore.h
+ *
+ * @brief Single-file store of the optimized partition elements
+ */
+
+#ifndef CHECKPOINTSTORE_H_
+#define CHECKPOINTSTORE_H_
+
+#include "util/GlobalDefs.h"
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+/** Version of the store layout, older or newer stores are not read */
+#define CKP_STORE_VERSION 3
+/** File name of the element records, inside the checkpoint directory */
+#define CKP_STORE_FILE    "elements.ckp"
+/** File name of the record index, inside the checkpoint directory */
+#define CKP_INDEX_FILE    "elements.idx"
+/** Slot of the element results, slot i + 1 holds its i-th model */
+#define CKP_ELEMENT_SLOT  0
+
+namespace partest
+{
+
+  /**
+   * @brief Append-only store of the optimized partition elements.
+   *
+   * Every record holds an element id, a slot, an explicitly serialized
+   * payload and a CRC-32 checksum of them. The slot tells apart the results
+   * of the whole element and those of each of its models. The store starts with a header with the
+   * layout version and the configuration the records depend on (data type,
+   * number of taxa and number of candidate models).
+   *
+   * Lookups go through an in-memory hash index from element id hashes to
+   * record offsets, and read the records from a read-only mapping of the
+   * store. Every appended record also appends an index entry to a second
+   * file, so opening a large store does not scan every record; records
+   * missing from the index file, e.g., after a crash, are scanned.
+   *
+   * Appends hold a POSIX lock on the store, so several processes may share
+   * it. A lookup that misses refreshes the index with the records appended
+   * by other processes.
+   */
+  class CheckpointStore
+  {
+  public:
+
+    /**
+     * @brief Looks up the payload of an element
+     *
+     * @param[in] id The element id
+     * @param[out] payload The payload of the element
+     * @param[in] slot The slot of the record
+     *
+     * @return true, if a valid record was found
+     */
+    bool load (const t_partitionElementId & id, std::string & payload,
+               size_t slot = CKP_ELEMENT_SLOT);
+
+    /**
+     * @brief Appends the payload of an element
+     *
+     * @param[in] id The element id
+     * @param[in] payload The payload of the element
+     * @param[in] slot The slot of the record
+     *
+     * @return true, if the record was written
+     */
+    bool store (const t_partitionElementId & id, const std::string & payload,
+                size_t slot = CKP_ELEMENT_SLOT);
+
+    /**
+     * @brief Appends the payloads of several elements with a single write
+     *
+     * @param[in] ids The element ids
+     * @param[in] payloads The payloads of the elements
+     * @param[in] slots The slots of the records
+     *
+     * @return true, if the records were written
+     */
+    bool store (const std::vector<const t_partitionElementId *> & ids,
+                const std::vector<const std::string *> & payloads,
+                const std::vector<size_t> & slots);
+
+    /**
+     * @brief Synchronizes the store and its index to disk
+     */
+    void sync (void);
+
+    /**
+     * @brief Gets the number of indexed records
+     */
+    size_t getNumberOfRecords (void);
+
+    static CheckpointStore * getInstance (void);
+    static void deleteInstance (void);
+
+  private:
+    /** Header at the beginning of the store */
+    struct storeHeader
+    {
+      char magic[8];
+      uint32_t version;
+      uint32_t dataType;
+      uint64_t numberOfTaxa;
+      uint64_t numberOfModels;
+    };
+
+    /** Header of every record, followed by the id words and the payload */
+    struct recordHeader
+    {
+      uint32_t magic;
+      uint32_t checksum; /** CRC-32 of the slot, id words and payload */
+      uint64_t slot;
+      uint64_t numberOfWords;
+      uint64_t payloadLength;
+    };
+
+    /** Entry of the index file */
+    struct indexEntry
+    {
+      uint64_t hash; /** Hash of the element id and the slot */
+      uint64_t offset; /** Offset of the record in the store */
+    };
+
+    CheckpointStore ();
+    virtual ~CheckpointStore ();
+
+    /** Checks the header of a new or existing store */
+    void checkHeader (void);
+
+    /** Looks up a record in the current index */
+    bool find (const t_partitionElementId & id, size_t slot,
+               std::string & payload);
+
+    /** Gets the index key of a record */
+    static uint64_t recordHash (const t_partitionElementId & id,
+                                size_t slot);
+
+    /** Reads the index file and scans the records it misses */
+    void loadIndex (bool repair);
+
+    /** Scans the records between the scanned size and the end of the store */
+    void scanRecords (bool repair);
+
+    /** Maps the whole store, if it grew beyond the current mapping */
+    void remap (void);
+
+    /** Gets the length of the record at an offset, or 0 if it is invalid */
+    uint64_t getRecordLength (uint64_t offset) const;
+
+    void lock (bool exclusive);
+    void unlock (void);
+
+    static uint32_t crc32 (uint32_t crc, const void * data, size_t length);
+    static bool writeFully (int fd, const void * data, size_t length,
+                            uint64_t offset);
+
+    int fd; /** Descriptor of the store */
+    int indexFd; /** Descriptor of the index file */
+    std::string filename, indexFilename;
+
+    char * mapping; /** Read-only mapping of the store */
+    uint64_t mappedSize; /** Bytes of the mapping, might exceed the store */
+    uint64_t storeSize; /** Bytes of the store at the last mapping */
+    uint64_t scannedSize; /** End of the last indexed record */
+
+    std::multimap<uint64_t, uint64_t> index; /** Record offsets by id hash */
+
+    pthread_mutex_t storeLock;
+    static CheckpointStore * instance;
+  };
+
+} /* namespace partest */
+
+#endif /* CHECKPOINTSTORE_H_ */
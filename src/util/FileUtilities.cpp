@@ -12,6 +12,7 @@
 #include <sys/stat.h>
 #include <dirent.h>
 #include <unistd.h>
+#include <fcntl.h>
 #include <cerrno>
 #include <cstdlib>
 
@@ -94,3 +95,90 @@ int FileUtilities::deleteDirectoryRecursive (const char* directory_name)
 
   return r;
 }
+
+bool FileUtilities::createExclusive (const std::string& filename,
+                                     const std::string& content)
+{
+  int fd = open (filename.c_str (), O_WRONLY | O_CREAT | O_EXCL, 0666);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  size_t written = 0;
+  while (written < content.size ())
+  {
+    ssize_t r = write (fd, content.data () + written,
+                       content.size () - written);
+    if (r < 0 && errno != EINTR)
+    {
+      break;
+    }
+    if (r > 0)
+      written += (size_t) r;
+  }
+  close (fd);
+
+  return true;
+}
+
+bool FileUtilities::readContent (const std::string& filename,
+                                 std::string& content)
+{
+  FILE * file = fopen (filename.c_str (), "r");
+  if (!file)
+  {
+    return false;
+  }
+
+  content.clear ();
+  char buf[256];
+  size_t r;
+  while ((r = fread (buf, 1, sizeof(buf), file)) > 0)
+  {
+    content.append (buf, r);
+  }
+  fclose (file);
+
+  return true;
+}
+
+int FileUtilities::lockFile (const std::string& filename, bool exclusive)
+{
+  int fd = open (filename.c_str (), (exclusive ? O_RDWR : O_RDONLY) | O_CREAT,
+                 0666);
+  if (fd < 0)
+  {
+    return -1;
+  }
+
+  struct flock fl;
+  memset (&fl, 0, sizeof(fl));
+  fl.l_type = exclusive ? F_WRLCK : F_RDLCK;
+  fl.l_whence = SEEK_SET;
+  while (fcntl (fd, F_SETLKW, &fl))
+  {
+    if (errno != EINTR)
+    {
+      close (fd);
+      return -1;
+    }
+  }
+
+  return fd;
+}
+
+void FileUtilities::unlockFile (int fd)
+{
+  if (fd < 0)
+  {
+    return;
+  }
+
+  struct flock fl;
+  memset (&fl, 0, sizeof(fl));
+  fl.l_type = F_UNLCK;
+  fl.l_whence = SEEK_SET;
+  fcntl (fd, F_SETLK, &fl);
+  close (fd);
+}
@@ -11,6 +11,7 @@
 #include <cstdio>
 #include <cstring>
 #include <iostream>
+#include <string>
 
 class FileUtilities
 {
@@ -53,6 +54,47 @@ public:
    * @return 0, if OK
    */
   static int deleteDirectoryRecursive (const char* directory_name);
+
+  /**
+   * @brief Atomically creates a file that must not exist
+   *
+   * @param filename The file to create
+   * @param content The content of the new file
+   *
+   * @return true, if the file was created by this call
+   */
+  static bool createExclusive (const std::string& filename,
+                               const std::string& content);
+
+  /**
+   * @brief Reads the whole content of a small file
+   *
+   * @param filename The file to read
+   * @param[out] content The content of the file
+   *
+   * @return true, if the file could be read
+   */
+  static bool readContent (const std::string& filename, std::string& content);
+
+  /**
+   * @brief Waits for an advisory lock on a file, which is created if needed
+   *
+   * The lock is shared among processes through the filesystem, so it also
+   * works on network filesystems with POSIX locks.
+   *
+   * @param filename The lock file
+   * @param exclusive Whether the lock is exclusive or shared
+   *
+   * @return The file descriptor holding the lock, or -1 on failure
+   */
+  static int lockFile (const std::string& filename, bool exclusive);
+
+  /**
+   * @brief Releases a lock taken with lockFile
+   *
+   * @param fd The file descriptor holding the lock
+   */
+  static void unlockFile (int fd);
 };
 
 #endif /* FILEUTILITIES_H_ */
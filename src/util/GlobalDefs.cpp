@@ -24,6 +24,7 @@
 #include "GlobalDefs.h"
 #include "Utilities.h"
 #include "PrintMeta.h"
+#include "AsyncWriter.h"
 
 #include <stdlib.h>
 #include <time.h>
@@ -44,6 +45,7 @@ namespace partest {
 	string ckpPath;
 	string ckpStartingTree = "starting_tree";
 	string ckpFinalTree = "final_tree";
+	string ckpExhaustiveSearch = "exhaustive_search";
 
 	string ** singleGeneNames;
 	char * starting_tree = 0;
@@ -51,15 +53,33 @@ namespace partest {
 
 	/* configuration */
 	int number_of_threads = 1;
+	int number_of_workers = 1;
+	int model_threads = 1;
 	DataType data_type;
 	StartTopo starting_topology;
 	SearchAlgo search_algo;
 	double epsilon = AUTO_EPSILON;
 	int max_samples = 1;
 	double samples_percent = 0.0;
+	size_t hcl_neighbours = 0;
+	size_t exhaustive_k = 0;
+	size_t beam_width = DEFAULT_BEAM_WIDTH;
+	size_t search_chains = DEFAULT_SEARCH_CHAINS;
+	size_t search_steps = DEFAULT_SEARCH_STEPS;
+	unsigned long search_seed = DEFAULT_SEARCH_SEED;
+	double search_temperature = DEFAULT_SEARCH_TEMPERATURE;
+	double search_temperature_ratio = DEFAULT_SEARCH_TEMPERATURE_RATIO;
 	InformationCriterion ic_type;
 	OptimizeMode optimize_mode;
 	bool non_stop = false;
+	double time_budget = 0.0;
+	bool dry_run = false;
+	int coop_size = 1;
+	int coop_id = 0;
+	int fork_workers = 0;
+	int sync_interval = DEFAULT_SYNC_INTERVAL;
+	bool warm_start = true;
+	size_t map_memory_budget = 0;
 	bool compute_final_tree = false;
 	bitMask do_rate = 0;
 	bitMask protModels = Utilities::binaryPow(max(NUC_MATRIX_SIZE,PROT_MATRIX_SIZE)) - 1;
@@ -102,6 +122,9 @@ namespace partest {
   int verbosity = VERBOSITY_LOW;
 
 	void exit_partest(int status) {
+		/* write the queued checkpoints and logs */
+		AsyncWriter::deleteInstance();
+
 		/* free global variables */
 		if (singleGeneNames) {
 			for (size_t i=0; i<number_of_genes; i++) {
@@ -36,6 +36,8 @@
 
 #include <pll/pll.h>
 
+#include "util/PartitionElementId.h"
+
 #include <vector>
 #include <climits>
 #include <string>
@@ -46,8 +48,8 @@
 #else
 #define I_AM_ROOT 1
 #endif
-
-#define MAX_FILE_LENGTH 40
+/* in cooperative runs only the leader writes the shared output files */
+#define I_AM_LEADER ((I_AM_ROOT) && !coop_id)
 
 /* ML optimization parameters */
 #define AUTO_EPSILON           0.0f
@@ -64,7 +66,7 @@ namespace partest
 
   typedef unsigned long int bitMask;
 #define MAX_PARTITIONS LONG_MAX
-  typedef std::vector<size_t> t_partitionElementId;
+  typedef PartitionElementId t_partitionElementId;
   typedef std::vector<t_partitionElementId> t_partitioningScheme;
   typedef std::vector<t_partitioningScheme> t_schemesVector;
 
@@ -78,6 +80,8 @@ namespace partest
 #define DOUBLE_INF 1e140
 
 #define CKP_DIR "ckpfiles"
+/* claims and barriers of cooperative runs, inside the checkpoint directory */
+#define COOP_DIR "coop"
 
 #ifdef _WIN32
 #define char_separator '\\'
@@ -95,7 +99,8 @@ namespace partest
 #define NUM_PROT_FREQS 20
 
 #ifdef HAVE_MPI
-#define MPI_ELEMENT_ID_TYPE MPI_UNSIGNED_LONG
+/* element identifiers are sent as their storage words */
+#define MPI_ELEMENT_ID_TYPE MPI_UNSIGNED_LONG_LONG
 #endif
 
 #define PROT_MATRIX_SIZE 18 // excluding auto & GTR
@@ -232,6 +237,13 @@ namespace partest
 #define DEFAULT_DO_F               false
 #define DEFAULT_DO_I               false
 #define DEFAULT_DO_G               false
+#define DEFAULT_BEAM_WIDTH         4
+#define DEFAULT_SEARCH_CHAINS      4
+#define DEFAULT_SEARCH_STEPS       100
+#define DEFAULT_SEARCH_SEED        12345
+#define DEFAULT_SEARCH_TEMPERATURE 1.0
+#define DEFAULT_SEARCH_TEMPERATURE_RATIO 4.0
+#define DEFAULT_SYNC_INTERVAL      30
 
 #define VERBOSITY_LOW  0
 #define VERBOSITY_MID  1
@@ -248,10 +260,15 @@ namespace partest
   extern std::string ckpPath;
   extern std::string ckpStartingTree;
   extern std::string ckpFinalTree;
+  extern std::string ckpExhaustiveSearch;
 
   /* configuration */
   /** Number of threads used for optimization */
   extern int number_of_threads;
+  /** Number of partition elements being optimized concurrently */
+  extern int number_of_workers;
+  /** Number of tree replicas evaluating the candidate models of an element */
+  extern int model_threads;
   /** Data type (nucleic or amino acid) */
   extern DataType data_type;
   /** Starting topology for optimizations */
@@ -264,8 +281,40 @@ namespace partest
   extern int max_samples;
   /** Percent of samples to analyze */
   extern double samples_percent;
+  /** Nearest neighbours per element for the approximate hcluster candidates, 0 for all pairs */
+  extern size_t hcl_neighbours;
+  /** Number of subsets of the exhaustive search schemes, 0 for any */
+  extern size_t exhaustive_k;
+  /** Number of schemes kept per step on extended greedy search */
+  extern size_t beam_width;
+  /** Number of parallel tempering chains on random search */
+  extern size_t search_chains;
+  /** Number of steps of every random search chain */
+  extern size_t search_steps;
+  /** Seed of the random search chains */
+  extern unsigned long search_seed;
+  /** IC temperature of the coldest random search chain */
+  extern double search_temperature;
+  /** Ratio between the temperatures of consecutive random search chains */
+  extern double search_temperature_ratio;
+  /** Whether to start models from nested or constituent optimized parameters */
+  extern bool warm_start;
+  /** Memory budget of the partition map in bytes, 0 for unbounded */
+  extern size_t map_memory_budget;
   /** Whether to stop or not in local maxima */
   extern bool non_stop;
+  /** Wall time budget in seconds for the auto search, 0 for none */
+  extern double time_budget;
+  /** Print the estimated cost of the search without optimizing anything */
+  extern bool dry_run;
+  /** Number of processes cooperating through the output directory */
+  extern int coop_size;
+  /** Index of this process among the cooperating ones, 0 is the leader */
+  extern int coop_id;
+  /** Number of forked worker processes for optimizing elements, 0 for none */
+  extern int fork_workers;
+  /** Seconds between synchronizations of the written output to disk */
+  extern int sync_interval;
   /** Whether to thoroughly optimize the final scheme*/
   extern bool compute_final_tree;
   /** Algorithm for candidate model selection */
@@ -0,0 +1,264 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file PartitionElementId.cpp
+ * @author Diego Darriba
+ */
+
+#include "PartitionElementId.h"
+
+#include <cstring>
+#include <cassert>
+
+#define WORD_BITS 64
+#define WORD_INDEX(gene) ((gene) / WORD_BITS)
+#define WORD_BIT(gene) (((t_idWord) 1) << ((gene) % WORD_BITS))
+
+using namespace std;
+
+namespace partest
+{
+
+  static inline size_t popCount (t_idWord word)
+  {
+    return (size_t) __builtin_popcountll (word);
+  }
+
+  static inline size_t lowestBit (t_idWord word)
+  {
+    return (size_t) __builtin_ctzll (word);
+  }
+
+  static inline size_t highestBit (t_idWord word)
+  {
+    return (size_t) (WORD_BITS - 1 - __builtin_clzll (word));
+  }
+
+  PartitionElementId::PartitionElementId (void) :
+      words (inlineWords), numberOfWords (0), capacity (ID_INLINE_WORDS),
+      numberOfGenes (0)
+  {
+  }
+
+  PartitionElementId::PartitionElementId (const PartitionElementId & other) :
+      words (inlineWords), numberOfWords (0), capacity (ID_INLINE_WORDS),
+      numberOfGenes (0)
+  {
+    setWords (other.words, other.numberOfWords);
+  }
+
+  PartitionElementId & PartitionElementId::operator= (
+      const PartitionElementId & other)
+  {
+    if (this != &other)
+    {
+      setWords (other.words, other.numberOfWords);
+    }
+    return *this;
+  }
+
+  PartitionElementId::~PartitionElementId ()
+  {
+    if (words != inlineWords)
+      delete[] words;
+  }
+
+  PartitionElementId PartitionElementId::singleGene (size_t gene)
+  {
+    PartitionElementId id;
+    id.insert (gene);
+    return id;
+  }
+
+  void PartitionElementId::reserve (size_t _numberOfWords)
+  {
+    if (_numberOfWords > capacity)
+    {
+      size_t newCapacity = 2 * capacity;
+      if (newCapacity < _numberOfWords)
+        newCapacity = _numberOfWords;
+      t_idWord * newWords = new t_idWord[newCapacity];
+      memcpy (newWords, words, numberOfWords * sizeof(t_idWord));
+      if (words != inlineWords)
+        delete[] words;
+      words = newWords;
+      capacity = newCapacity;
+    }
+    if (_numberOfWords > numberOfWords)
+    {
+      memset (words + numberOfWords, 0,
+              (_numberOfWords - numberOfWords) * sizeof(t_idWord));
+      numberOfWords = _numberOfWords;
+    }
+  }
+
+  void PartitionElementId::trim (void)
+  {
+    while (numberOfWords && !words[numberOfWords - 1])
+      numberOfWords--;
+  }
+
+  void PartitionElementId::setWords (const t_idWord * _words,
+                                     size_t _numberOfWords)
+  {
+    numberOfWords = 0;
+    reserve (_numberOfWords);
+    memcpy (words, _words, _numberOfWords * sizeof(t_idWord));
+    trim ();
+    numberOfGenes = 0;
+    for (size_t i = 0; i < numberOfWords; i++)
+      numberOfGenes += popCount (words[i]);
+  }
+
+  void PartitionElementId::insert (size_t gene)
+  {
+    reserve (WORD_INDEX(gene) + 1);
+    if (!(words[WORD_INDEX(gene)] & WORD_BIT(gene)))
+    {
+      words[WORD_INDEX(gene)] |= WORD_BIT(gene);
+      numberOfGenes++;
+    }
+  }
+
+  bool PartitionElementId::contains (size_t gene) const
+  {
+    return WORD_INDEX(gene) < numberOfWords
+        && (words[WORD_INDEX(gene)] & WORD_BIT(gene));
+  }
+
+  size_t PartitionElementId::front (void) const
+  {
+    assert(numberOfGenes);
+    size_t i = 0;
+    while (!words[i])
+      i++;
+    return i * WORD_BITS + lowestBit (words[i]);
+  }
+
+  size_t PartitionElementId::back (void) const
+  {
+    assert(numberOfGenes);
+    return (numberOfWords - 1) * WORD_BITS
+        + highestBit (words[numberOfWords - 1]);
+  }
+
+  vector<size_t> PartitionElementId::getGenes (void) const
+  {
+    vector<size_t> genes;
+    genes.reserve (numberOfGenes);
+    for (size_t i = 0; i < numberOfWords; i++)
+    {
+      t_idWord word = words[i];
+      while (word)
+      {
+        genes.push_back (i * WORD_BITS + lowestBit (word));
+        word &= word - 1;
+      }
+    }
+    return genes;
+  }
+
+  bool PartitionElementId::intersects (const PartitionElementId & other) const
+  {
+    size_t n = numberOfWords < other.numberOfWords ?
+        numberOfWords : other.numberOfWords;
+    for (size_t i = 0; i < n; i++)
+    {
+      if (words[i] & other.words[i])
+        return true;
+    }
+    return false;
+  }
+
+  PartitionElementId & PartitionElementId::operator|= (
+      const PartitionElementId & other)
+  {
+    reserve (other.numberOfWords);
+    numberOfGenes = 0;
+    for (size_t i = 0; i < numberOfWords; i++)
+    {
+      if (i < other.numberOfWords)
+        words[i] |= other.words[i];
+      numberOfGenes += popCount (words[i]);
+    }
+    return *this;
+  }
+
+  bool PartitionElementId::operator== (const PartitionElementId & other) const
+  {
+    return numberOfGenes == other.numberOfGenes
+        && numberOfWords == other.numberOfWords
+        && !memcmp (words, other.words, numberOfWords * sizeof(t_idWord));
+  }
+
+  bool PartitionElementId::hasGeneAbove (size_t gene) const
+  {
+    size_t i = WORD_INDEX(gene);
+    if (i >= numberOfWords)
+      return false;
+    /* bits strictly above gene within its word */
+    t_idWord mask = ~(WORD_BIT(gene) | (WORD_BIT(gene) - 1));
+    if (words[i] & mask)
+      return true;
+    return i + 1 < numberOfWords;
+  }
+
+  bool PartitionElementId::operator< (const PartitionElementId & other) const
+  {
+    /* both gene lists agree up to the lowest differing gene */
+    size_t n = numberOfWords > other.numberOfWords ?
+        numberOfWords : other.numberOfWords;
+    for (size_t i = 0; i < n; i++)
+    {
+      t_idWord w1 = i < numberOfWords ? words[i] : 0;
+      t_idWord w2 = i < other.numberOfWords ? other.words[i] : 0;
+      if (w1 != w2)
+      {
+        size_t gene = i * WORD_BITS + lowestBit (w1 ^ w2);
+        if (w1 & WORD_BIT(gene))
+        {
+          /* the other list goes on with a higher gene, or is a prefix */
+          return other.hasGeneAbove (gene);
+        }
+        return !hasGeneAbove (gene);
+      }
+    }
+    return false;
+  }
+
+  size_t PartitionElementId::hash (void) const
+  {
+    /* FNV-1a over the storage words, then mixed */
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < numberOfWords; i++)
+    {
+      h ^= words[i];
+      h *= 1099511628211ULL;
+    }
+    /* MurmurHash3 finalizer, so that every bit of the words reaches the
+     * low bits used as table slots */
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB93FE1A85EC3ULL;
+    h ^= h >> 33;
+    return (size_t) h;
+  }
+
+} /* namespace partest */
@@ -0,0 +1,159 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file PartitionElementId.h
+ *
+ * @brief Compact set of genes identifying a partition element
+ */
+
+#ifndef PARTITIONELEMENTID_H_
+#define PARTITIONELEMENTID_H_
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+/** Number of words stored inline, without heap allocation */
+#define ID_INLINE_WORDS 2
+
+namespace partest
+{
+
+  /** Storage word of the element identifiers */
+  typedef uint64_t t_idWord;
+
+  /**
+   * @brief Bitset identifier of a partition element.
+   *
+   * Bit i is set if gene i belongs to the element. Identifiers up to
+   * 64 * ID_INLINE_WORDS genes are stored inline, larger ones on the heap.
+   * Trailing zero words are never kept, so equal sets have equal storage.
+   *
+   * The ordering is the lexicographic order of the sorted gene lists.
+   */
+  class PartitionElementId
+  {
+  public:
+    PartitionElementId (void);
+    PartitionElementId (const PartitionElementId & other);
+    PartitionElementId & operator= (const PartitionElementId & other);
+    ~PartitionElementId ();
+
+    /**
+     * @brief Builds the identifier of a single gene element
+     *
+     * @param[in] gene The gene index
+     */
+    static PartitionElementId singleGene (size_t gene);
+
+    /**
+     * @brief Adds a gene to the set
+     */
+    void insert (size_t gene);
+
+    /**
+     * @brief Checks whether the set contains a gene
+     */
+    bool contains (size_t gene) const;
+
+    /**
+     * @brief Gets the number of genes in the set
+     */
+    size_t size (void) const
+    {
+      return numberOfGenes;
+    }
+
+    bool empty (void) const
+    {
+      return !numberOfGenes;
+    }
+
+    /**
+     * @brief Gets the lowest gene of a non empty set
+     */
+    size_t front (void) const;
+
+    /**
+     * @brief Gets the highest gene of a non empty set
+     */
+    size_t back (void) const;
+
+    /**
+     * @brief Gets the sorted list of genes
+     */
+    std::vector<size_t> getGenes (void) const;
+
+    /**
+     * @brief Checks whether both sets share any gene
+     */
+    bool intersects (const PartitionElementId & other) const;
+
+    /**
+     * @brief Adds every gene of another set
+     */
+    PartitionElementId & operator|= (const PartitionElementId & other);
+
+    bool operator== (const PartitionElementId & other) const;
+    bool operator!= (const PartitionElementId & other) const
+    {
+      return !(*this == other);
+    }
+    bool operator< (const PartitionElementId & other) const;
+
+    /**
+     * @brief Gets a hash value of the set
+     */
+    size_t hash (void) const;
+
+    /**
+     * @brief Gets the number of storage words
+     */
+    size_t getNumberOfWords (void) const
+    {
+      return numberOfWords;
+    }
+
+    /**
+     * @brief Gets the storage words, e.g., for sending them through MPI
+     */
+    const t_idWord * getWords (void) const
+    {
+      return words;
+    }
+
+    /**
+     * @brief Replaces the set by a copy of the storage words
+     */
+    void setWords (const t_idWord * words, size_t numberOfWords);
+  private:
+    void reserve (size_t numberOfWords);
+    void trim (void);
+    bool hasGeneAbove (size_t gene) const;
+
+    t_idWord inlineWords[ID_INLINE_WORDS];
+    t_idWord * words; /** Either inlineWords or heap storage */
+    size_t numberOfWords; /** Number of used words */
+    size_t capacity; /** Number of available words */
+    size_t numberOfGenes; /** Number of set bits */
+  };
+
+} /* namespace partest */
+
+#endif /* PARTITIONELEMENTID_H_ */
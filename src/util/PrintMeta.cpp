@@ -24,6 +24,9 @@
 #include "PrintMeta.h"
 #include "parser/ArgumentParser.h"
 #include "util/Utilities.h"
+#include "util/Stirling.h"
+#include "exe/CostModel.h"
+#include "exe/SearchPlanner.h"
 #include "util/GlobalDefs.h"
 #include <pll/parsePartition.h>
 
@@ -199,6 +202,37 @@ namespace partest
     output << setw (OPT_DESCR_LENGTH) << left << "  Number of candidate models:"
         << number_of_models << endl;
 
+    output << setw (OPT_DESCR_LENGTH) << left << "  Warm start candidate models:"
+        << (warm_start ? "True" : "False") << endl;
+
+    output << setw (OPT_DESCR_LENGTH) << left << "  Partition map memory:";
+    if (map_memory_budget)
+    {
+      output << map_memory_budget / (1024 * 1024) << " MB" << endl;
+    }
+    else
+    {
+      output << "Unbounded" << endl;
+    }
+
+    if (ckpAvailable)
+    {
+      output << setw (OPT_DESCR_LENGTH) << left << "  Output sync interval:"
+          << sync_interval << " s" << endl;
+    }
+
+    if (fork_workers > 1)
+    {
+      output << setw (OPT_DESCR_LENGTH) << left << "  Worker processes:"
+          << fork_workers << endl;
+    }
+
+    if (coop_size > 1)
+    {
+      output << setw (OPT_DESCR_LENGTH) << left << "  Cooperating processes:"
+          << coop_size << " (this is " << coop_id << ")" << endl;
+    }
+
     output << setw (OPT_DESCR_LENGTH) << left << "  Optimization epsilon:";
     if (epsilon == AUTO_EPSILON)
     {
@@ -238,6 +272,8 @@ namespace partest
           break;
         case SearchGreedyExtended:
           output << left << "Greedy extended" << endl;
+          output << setw (OPT_DESCR_LENGTH) << left << "  Beam width:"
+              << beam_width << endl;
           break;
         case SearchHCluster:
           output << left << "Hierarchical Cluster (";
@@ -246,15 +282,37 @@ namespace partest
           else
             output << samples_percent * 100 << "%";
           output << ")" << endl;
+          output << setw (OPT_DESCR_LENGTH) << left << "  HCL candidates:";
+          if (hcl_neighbours)
+            output << hcl_neighbours << " nearest neighbours" << endl;
+          else
+            output << "All pairs" << endl;
           break;
         case SearchRandom:
-          output << left << "Random" << endl;
+          output << left << "Random (parallel tempering)" << endl;
+          output << setw (OPT_DESCR_LENGTH) << left << "  Chains:"
+              << search_chains << " x " << search_steps << " steps" << endl;
+          output << setw (OPT_DESCR_LENGTH) << left << "  Temperatures:"
+              << search_temperature << " x " << search_temperature_ratio
+              << "^chain" << endl;
+          output << setw (OPT_DESCR_LENGTH) << left << "  Seed:"
+              << search_seed << endl;
           break;
         case SearchExhaustive:
           output << left << "Exahustive" << endl;
+          output << setw (OPT_DESCR_LENGTH) << left << "  Scheme subsets:";
+          if (exhaustive_k)
+            output << exhaustive_k << endl;
+          else
+            output << "Any" << endl;
           break;
         case SearchAuto:
           output << left << "Auto" << endl;
+          if (time_budget > 0.0)
+          {
+            output << setw (OPT_DESCR_LENGTH) << left << "  Time budget:"
+                << time_budget << " s" << endl;
+          }
           break;
         default:
           assert(0);
@@ -273,7 +331,9 @@ namespace partest
         output << left << Utilities::numSchemesGreedy (number_of_genes) << endl;
         break;
       case SearchGreedyExtended:
-        output << left << Utilities::numSchemesGreedy (number_of_genes) << endl;
+        output << left
+            << beam_width * Utilities::numSchemesGreedy (number_of_genes)
+            << endl;
         break;
       case SearchHCluster:
         output << left
@@ -281,10 +341,16 @@ namespace partest
             << endl;
         break;
       case SearchRandom:
-        output << left << max_samples << endl;
+        output << left << search_chains * (search_steps + 1) << endl;
         break;
       case SearchExhaustive:
-        output << left << "a lot" << endl;
+        if (exhaustive_k)
+          output << left
+              << Stirling::count ((unsigned) number_of_genes,
+                                  (unsigned) exhaustive_k) << endl;
+        else
+          output << left << Stirling::bell ((unsigned) number_of_genes)
+              << endl;
         break;
       case SearchAuto:
         output << left << Utilities::numSchemesAutoSearch (number_of_genes)
@@ -322,6 +388,72 @@ namespace partest
         << endl << endl;
   }
 
+  void PrintMeta::print_dry_run (ostream& output)
+  {
+    searchPlan plan = SearchPlanner::estimate (search_algo);
+
+    output << "Estimated search cost (dry run):" << endl;
+    output << setw (OPT_DESCR_LENGTH) << left << "  Search algorithm:";
+    switch (plan.algorithm)
+      {
+      case SearchK1:
+        output << left << "Single partition only" << endl;
+        break;
+      case SearchKN:
+        output << left << "K=N scheme only" << endl;
+        break;
+      case SearchGreedy:
+        output << left << "Greedy" << endl;
+        break;
+      case SearchGreedyExtended:
+        output << left << "Greedy extended (" << beam_width << ")" << endl;
+        break;
+      case SearchHCluster:
+        output << left << "Hierarchical Cluster (";
+        if (plan.maxSamples)
+          output << plan.maxSamples;
+        else
+          output << plan.samplesPercent * 100 << "%";
+        output << ")" << endl;
+        break;
+      case SearchRandom:
+        output << left << "Random (parallel tempering)" << endl;
+        break;
+      case SearchExhaustive:
+        output << left << "Exahustive" << endl;
+        break;
+      case SearchAuto:
+        output << left << "Hierarchical Cluster (";
+        if (plan.maxSamples)
+          output << plan.maxSamples;
+        else
+          output << plan.samplesPercent * 100 << "%";
+        output << "), refined by Hierarchical Cluster and Greedy" << endl;
+        break;
+      default:
+        assert(0);
+      }
+    output << setw (OPT_DESCR_LENGTH) << left << "  Workers:"
+        << CostModel::getNumberOfWorkers () << endl;
+    output << setw (OPT_DESCR_LENGTH) << left << "  Evaluated schemes:"
+        << fixed << setprecision (0) << plan.numberOfSchemes << endl;
+    output << setw (OPT_DESCR_LENGTH) << left << "  Optimized elements:"
+        << plan.numberOfElements << endl;
+    output << setw (OPT_DESCR_LENGTH) << left << "  Peak memory:"
+        << setprecision (1) << (double) plan.peakMemory / (1024.0 * 1024.0)
+        << " MB" << endl;
+    output << setw (OPT_DESCR_LENGTH) << left << "  Runtime:"
+        << setprecision (0) << plan.seconds << " s" << endl;
+    if (time_budget > 0.0 && plan.seconds > time_budget)
+    {
+      output << setw (OPT_DESCR_LENGTH) << left << " "
+          << "[WARNING] exceeds the time budget" << endl;
+    }
+    output.unsetf (ios_base::floatfield);
+    output << setw (H_RULE_LENGTH) << setfill ('-') << "" << setfill (' ')
+        << endl << endl;
+  }
+
   void PrintMeta::print_usage (std::ostream& out)
   {
     out << "Usage: " << PACKAGE << " -i sequenceFilename" << endl;
@@ -390,6 +522,22 @@ namespace partest
     out << setw (MAX_OPT_LENGTH) << " "<< "default: auto" << endl;
     out << endl;
 
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--disable-warm-start"
+        << "optimize every candidate model from default parameters" << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "instead of the closest already optimized nested model" << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "or the site-weighted parameters of the merged genes" << endl;
+    out << endl;
+
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--dry-run"
+        << "print the estimated number of elements, peak memory" << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "and runtime of the search without optimizing anything" << endl;
+    out << endl;
+
     out << setw (MAX_OPT_LENGTH) << left << "  -F, --empirical-frequencies"
         << "includes models with empirical frequencies (+F)" << endl;
     out << endl;
@@ -436,6 +584,21 @@ namespace partest
 
     out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
         << "--disable-ckp" << "disables the checkpointing" << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "on SIGTERM or SIGUSR1, stops once the running models are saved"
+        << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "MPI runs only checkpoint whole elements, and stop immediately"
+        << endl;
+    out << endl;
+
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--sync-interval SECONDS"
+        << "synchronizes checkpoints and logs to disk every SECONDS" << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "they are written in the background, 0 syncs every write" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "default: "
+        << DEFAULT_SYNC_INTERVAL << endl;
     out << endl;
 
     out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
@@ -479,10 +642,12 @@ namespace partest
         << "--search greedy" << "greedy search algorithm" << endl;
     out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
         << "--search greedyext" << "extended greedy search algorithm" << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "(beam search keeping the best schemes of every step)" << endl;
     out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
         << "--search hcluster" << "hierarchical clustering algorithm" << endl;
     out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
-        << "--search random" << "multiple step random sampling" << endl;
+        << "--search random" << "parallel tempering random search" << endl;
     out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
         << "--search auto" << "auto-select algorithm" << endl;
     out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
@@ -490,6 +655,61 @@ namespace partest
     out << setw (MAX_OPT_LENGTH) << " "<< "default: auto" << endl;
     out << endl;
 
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--beam-width B"
+        << "sets the number of schemes kept per step on extended" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "greedy search" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "default: " << DEFAULT_BEAM_WIDTH
+        << endl;
+    out << endl;
+
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--chains N"
+        << "sets the number of parallel tempering chains on random" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "search" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "default: " << DEFAULT_SEARCH_CHAINS
+        << endl;
+    out << endl;
+
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--chain-steps N"
+        << "sets the number of steps of every random search chain" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "default: " << DEFAULT_SEARCH_STEPS
+        << endl;
+    out << endl;
+
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--seed N"
+        << "sets the seed of the random search chains" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "default: " << DEFAULT_SEARCH_SEED
+        << endl;
+    out << endl;
+
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--temperature T"
+        << "sets the IC temperature of the coldest random search" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "chain" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "default: "
+        << DEFAULT_SEARCH_TEMPERATURE << endl;
+    out << endl;
+
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--temperature-ratio R"
+        << "sets the ratio between the temperatures of consecutive" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "random search chains (at least 1)"
+        << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "default: "
+        << DEFAULT_SEARCH_TEMPERATURE_RATIO << endl;
+    out << endl;
+
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--exhaustive-k K"
+        << "evaluate only the schemes with exactly K subsets on" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "exhaustive search" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "default: any number of subsets"
+        << endl;
+    out << endl;
+
     out << setw (MAX_OPT_LENGTH) << left << "  -k, --keep-branches"
         << "keep branch lengths from the initial topology." << endl;
     out << setw (MAX_OPT_LENGTH) << " "
@@ -502,17 +722,80 @@ namespace partest
         << "algorithms do not stop if no improvement found at one step" << endl;
     out << endl;
 
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--time-budget SECONDS"
+        << "selects the auto search strategy fitting the budget" << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "according to the estimated element costs" << endl;
+    out << endl;
+
     out << setw (MAX_OPT_LENGTH) << left
         << "  -p, --num-procs NUMBER_OF_THREADS"
         << "number of threads for model evaluation" << endl;
+#ifdef HAVE_MPI
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "per MPI process. Use one process per node" << endl;
+#endif
     out << endl;
     out << setw (MAX_OPT_LENGTH) << " " << "default: 1" << endl;
 
+#ifndef HAVE_MPI
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--fork-workers N"
+        << "optimize the elements on N forked processes sharing the" << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "loaded alignment, instead of threads" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "default: none" << endl;
+    out << endl;
+
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--coop-size N"
+        << "cooperate with N-1 other processes sharing the output" << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "directory, e.g., the tasks of a job array" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "default: 1" << endl;
+    out << endl;
+
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--coop-id I"
+        << "index of this process among the cooperating ones, from" << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "0 to N-1. Process 0 leads and writes the results" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "default: 0" << endl;
+    out << endl;
+#endif
+
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--map-memory N"
+        << "keep at most N MB of optimized elements in memory" << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "the least recently used ones are reloaded from checkpoints" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "default: unbounded" << endl;
+    out << endl;
+
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--model-threads N"
+        << "evaluate the candidate models of each element on N replicas" << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "model selection runs once all of them finish" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "default: 1" << endl;
+    out << endl;
+
     out << setw (MAX_OPT_LENGTH) << left << "  -r, --replicates N"
         << "sets the number of replicates on hierarchical clustering" << endl;
     out << endl;
     out << setw (MAX_OPT_LENGTH) << " "<< "default: 1" << endl;
 
+    out << setw (SHORT_OPT_LENGTH) << " " << setw (COMPL_OPT_LENGTH)
+        << "--hcl-neighbours N"
+        << "sample hierarchical clustering merges among the N nearest" << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "neighbours of each element, instead of among all pairs" << endl;
+    out << setw (MAX_OPT_LENGTH) << " "
+        << "recommended for thousands of genes" << endl;
+    out << setw (MAX_OPT_LENGTH) << " " << "default: all pairs" << endl;
+    out << endl;
+
     out << setw (SHORT_OPT_LENGTH) << "  -T" << setw (COMPL_OPT_LENGTH)
         << "--get-final-tree" << "conduct final ML tree optimization" << endl;
     out << endl;
@@ -41,6 +41,12 @@ namespace partest
   public:
     static void print_header (std::ostream& output);
     static void print_options (std::ostream& output);
+
+    /**
+     * @brief Prints the estimated elements, peak memory and runtime of the
+     * configured search
+     */
+    static void print_dry_run (std::ostream& output);
     static void print_usage (std::ostream& output);
     static void print_results (std::ostream & ofs,
                                PartitioningScheme * bestScheme);
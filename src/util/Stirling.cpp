@@ -23,6 +23,8 @@
 #include "Stirling.h"
 #include <stdexcept>
 
+#define STIRLING_MAX ((unsigned long long) -1)
+
 namespace partest
 {
 
@@ -93,6 +95,21 @@ namespace partest
     throw std::underflow_error ("no preceding partitions");
   }
 
+  void Stirling::iterator::setKappa (const std::vector<unsigned> & _kappa)
+  {
+    if (_kappa.size () != kappa.size () || _kappa[0])
+      throw std::invalid_argument ("Stirling::iterator: invalid kappa");
+
+    kappa = _kappa;
+    M[0] = 0;
+    for (unsigned i = 1; i < kappa.size (); ++i)
+    {
+      if (kappa[i] > M[i - 1] + 1)
+        throw std::invalid_argument ("Stirling::iterator: invalid kappa");
+      M[i] = std::max (M[i - 1], kappa[i]);
+    }
+  }
+
   void Stirling::iterator::integrityCheck ()
   {
     const unsigned n = size ();
@@ -143,13 +160,7 @@ namespace partest
       std::fill (M.begin () + psize, M.end (), psize - 1);
     }
 
-    it_size = 0;
-    for (size_t i = 0; i <= psize; i++)
-    {
-      it_size += pow (-1, psize - i) * Utilities::combinatorial (psize, i)
-          * pow (i, n);
-    }
-    it_size /= Utilities::factorial (psize);
+    it_size = (long) count (n, psize);
   }
 
   Stirling::iterator_k&
@@ -246,26 +257,61 @@ namespace partest
       //build t_partition_elements
       for (size_t i = 0; i < schemeVector->size (); i++)
       {
-        size_t p_index = 0;
+        t_partitionElementId p_index;
         for (size_t j = 0; j < (schemeVector->at (i)).size (); j++)
         {
-          p_index += (schemeVector->at (i))[j];
+          p_index |= (schemeVector->at (i))[j];
         }
         elements->push_back (p_index);
       }
-      it = new Stirling::iterator_k (schemeVector->size (), k);
+      it = new Stirling::iterator_k ((unsigned) schemeVector->size (),
+                                     (unsigned) k);
     }
     else
     {
-      size_t p_index = 1;
-      for (size_t i = 0; i < k; i++)
+      for (int i = 0; i < k; i++)
       {
-        elements->push_back (p_index);
-        p_index *= 2;
+        elements->push_back (PartitionElementId::singleGene ((size_t) i));
       }
-      it = new Stirling::iterator_k (k, k);
+      it = new Stirling::iterator_k ((unsigned) k, (unsigned) k);
     }
     return it;
   }
 
+  unsigned long long Stirling::count (unsigned n, unsigned k)
+  {
+    if (k > n)
+      return 0;
+
+    /* S(i,j) = j S(i-1,j) + S(i-1,j-1), one row at a time */
+    std::vector<unsigned long long> row (k + 1, 0);
+    row[0] = 1;
+    for (unsigned i = 1; i <= n; ++i)
+    {
+      for (unsigned j = std::min (i, k); j > 0; --j)
+      {
+        unsigned long long a = row[j], b = row[j - 1];
+        if (a && (a > STIRLING_MAX / j || a * j > STIRLING_MAX - b))
+          row[j] = STIRLING_MAX;
+        else
+          row[j] = a * j + b;
+      }
+      row[0] = 0;
+    }
+    return row[k];
+  }
+
+  unsigned long long Stirling::bell (unsigned n)
+  {
+    unsigned long long total = 0;
+    for (unsigned k = 1; k <= n; ++k)
+    {
+      unsigned long long s = count (n, k);
+      if (s > STIRLING_MAX - total)
+        return STIRLING_MAX;
+      total += s;
+    }
+    return total;
+  }
+
 } /* namespace partest */
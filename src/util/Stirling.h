@@ -65,6 +65,12 @@ namespace partest
       iterator& operator++ ();
       iterator& operator-- ();
 
+      /**
+       * @brief Moves the iterator to a given restricted growth string,
+       * e.g., for resuming an enumeration
+       */
+      void setKappa (const std::vector<unsigned> & kappa);
+
       template<typename Elem>
         std::vector<std::vector<Elem> > *
         operator[] (const std::vector<Elem> &v) const;
@@ -105,6 +111,20 @@ namespace partest
 
     static iterator_k * get_partitions (int k, t_schemesVector* &schemeVector,
                                         t_partitioningScheme* &ptr_elements);
+
+    /**
+     * @brief Gets the Stirling number of the second kind S(n,k), i.e., the
+     * number of partitions of n elements into exactly k subsets.
+     *
+     * Saturates to the largest representable value.
+     */
+    static unsigned long long count (unsigned n, unsigned k);
+
+    /**
+     * @brief Gets the Bell number B(n), i.e., the number of partitions of
+     * n elements. Saturates to the largest representable value.
+     */
+    static unsigned long long bell (unsigned n);
   };
 
   extern std::ostream& operator<< (std::ostream& out, Stirling::iterator &it);
@@ -24,6 +24,7 @@
 #include "Utilities.h"
 #include "indata/PartitionMap.h"
 #include "indata/TreeManager.h"
+#include "indata/TopologyCache.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -31,6 +32,16 @@
 #include <iostream>
 #include <cassert>
 
+#if defined(HAVE_AVX) && defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_WIDTH 4
+#elif defined(HAVE_SSE) && defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_WIDTH 2
+#else
+#define SIMD_WIDTH 1
+#endif
+
 namespace partest
 {
 
@@ -168,6 +179,143 @@ namespace partest
     return sqrt (sum);
   }
 
+  /* The kernels below vectorize across the vectors of the set, so every
+   * lane accumulates its columns in the same order as the scalar code and
+   * the results do not depend on the instruction set. */
+
+  void Utilities::squaredDistances (const double * query,
+                                    const double * columns,
+                                    size_t numberOfColumns, size_t stride,
+                                    size_t n, double * out)
+  {
+    size_t j = 0;
+#if (SIMD_WIDTH == 4)
+    for (; j + 4 <= n; j += 4)
+    {
+      __m256d acc = _mm256_loadu_pd (out + j);
+      for (size_t c = 0; c < numberOfColumns; c++)
+      {
+        __m256d d = _mm256_sub_pd (_mm256_set1_pd (query[c]),
+                                   _mm256_loadu_pd (columns + c * stride + j));
+        acc = _mm256_add_pd (acc, _mm256_mul_pd (d, d));
+      }
+      _mm256_storeu_pd (out + j, acc);
+    }
+#elif (SIMD_WIDTH == 2)
+    for (; j + 2 <= n; j += 2)
+    {
+      __m128d acc = _mm_loadu_pd (out + j);
+      for (size_t c = 0; c < numberOfColumns; c++)
+      {
+        __m128d d = _mm_sub_pd (_mm_set1_pd (query[c]),
+                                _mm_loadu_pd (columns + c * stride + j));
+        acc = _mm_add_pd (acc, _mm_mul_pd (d, d));
+      }
+      _mm_storeu_pd (out + j, acc);
+    }
+#endif
+    for (; j < n; j++)
+    {
+      double acc = out[j];
+      for (size_t c = 0; c < numberOfColumns; c++)
+      {
+        double d = query[c] - columns[c * stride + j];
+        acc += d * d;
+      }
+      out[j] = acc;
+    }
+  }
+
+  void Utilities::scaledSquaredDistances (const double * query,
+                                          const double * columns,
+                                          size_t numberOfColumns,
+                                          size_t stride, size_t n,
+                                          const double * scale, double * out)
+  {
+    size_t j = 0;
+#if (SIMD_WIDTH == 4)
+    for (; j + 4 <= n; j += 4)
+    {
+      __m256d acc = _mm256_loadu_pd (out + j);
+      __m256d k = _mm256_loadu_pd (scale + j);
+      for (size_t c = 0; c < numberOfColumns; c++)
+      {
+        __m256d d = _mm256_sub_pd (
+            _mm256_mul_pd (_mm256_set1_pd (query[c]), k),
+            _mm256_loadu_pd (columns + c * stride + j));
+        acc = _mm256_add_pd (acc, _mm256_mul_pd (d, d));
+      }
+      _mm256_storeu_pd (out + j, acc);
+    }
+#elif (SIMD_WIDTH == 2)
+    for (; j + 2 <= n; j += 2)
+    {
+      __m128d acc = _mm_loadu_pd (out + j);
+      __m128d k = _mm_loadu_pd (scale + j);
+      for (size_t c = 0; c < numberOfColumns; c++)
+      {
+        __m128d d = _mm_sub_pd (_mm_mul_pd (_mm_set1_pd (query[c]), k),
+                                _mm_loadu_pd (columns + c * stride + j));
+        acc = _mm_add_pd (acc, _mm_mul_pd (d, d));
+      }
+      _mm_storeu_pd (out + j, acc);
+    }
+#endif
+    for (; j < n; j++)
+    {
+      double acc = out[j];
+      for (size_t c = 0; c < numberOfColumns; c++)
+      {
+        double d = query[c] * scale[j] - columns[c * stride + j];
+        acc += d * d;
+      }
+      out[j] = acc;
+    }
+  }
+
+  void Utilities::dotProducts (const double * query, const double * columns,
+                               size_t numberOfColumns, size_t stride,
+                               size_t n, double * out)
+  {
+    size_t j = 0;
+#if (SIMD_WIDTH == 4)
+    for (; j + 4 <= n; j += 4)
+    {
+      __m256d acc = _mm256_loadu_pd (out + j);
+      for (size_t c = 0; c < numberOfColumns; c++)
+      {
+        acc = _mm256_add_pd (
+            acc,
+            _mm256_mul_pd (_mm256_set1_pd (query[c]),
+                           _mm256_loadu_pd (columns + c * stride + j)));
+      }
+      _mm256_storeu_pd (out + j, acc);
+    }
+#elif (SIMD_WIDTH == 2)
+    for (; j + 2 <= n; j += 2)
+    {
+      __m128d acc = _mm_loadu_pd (out + j);
+      for (size_t c = 0; c < numberOfColumns; c++)
+      {
+        acc = _mm_add_pd (
+            acc,
+            _mm_mul_pd (_mm_set1_pd (query[c]),
+                        _mm_loadu_pd (columns + c * stride + j)));
+      }
+      _mm_storeu_pd (out + j, acc);
+    }
+#endif
+    for (; j < n; j++)
+    {
+      double acc = out[j];
+      for (size_t c = 0; c < numberOfColumns; c++)
+      {
+        acc += query[c] * columns[c * stride + j];
+      }
+      out[j] = acc;
+    }
+  }
+
   int Utilities::numSchemesHierarchicalClustering (int n)
   {
     int nSchemes = n + 1;
@@ -206,45 +354,30 @@ namespace partest
   }
 
   void Utilities::mergeIds (t_partitionElementId & dest,
-                            t_partitionElementId id1, t_partitionElementId id2)
+                            const t_partitionElementId & id1,
+                            const t_partitionElementId & id2)
   {
-    dest.reserve (id1.size () + id2.size ());
-    dest.insert (dest.end (), id1.begin (), id1.end ());
-    dest.insert (dest.end (), id2.begin (), id2.end ());
-    sort (dest.begin (), dest.end ());
+    dest = id1;
+    dest |= id2;
   }
 
-  bool Utilities::intersec (t_partitionElementId & e1,
-                            t_partitionElementId & e2)
+  bool Utilities::intersec (const t_partitionElementId & e1,
+                            const t_partitionElementId & e2)
   {
-    for (size_t i = 0; i < e1.size (); i++)
-    {
-      for (size_t j = 0; j < e2.size (); j++)
-      {
-        if (e1.at (i) == e2.at (j))
-          return true;
-      }
-    }
-    return false;
+    return e1.intersects (e2);
   }
 
-  bool Utilities::contains (t_partitionElementId vec, int num)
+  bool Utilities::contains (const t_partitionElementId & vec, int num)
   {
-    for (size_t i = 0; i < vec.size (); i++)
-    {
-      int n = (int) vec.at (i);
-      if (n == num)
-        return true;
-    }
-    return false;
+    return num >= 0 && vec.contains ((size_t) num);
   }
 
-  bool Utilities::contains (t_partitioningScheme vec, t_partitionElementId id)
+  bool Utilities::contains (const t_partitioningScheme & vec,
+                            const t_partitionElementId & id)
   {
     for (size_t i = 0; i < vec.size (); i++)
     {
-      t_partitionElementId eId = vec.at (i);
-      if (eId == id)
+      if (vec.at (i) == id)
         return true;
     }
     return false;
@@ -366,7 +499,7 @@ namespace partest
   {
     for (size_t i = 0; i < scheme.size (); i++)
     {
-      t_partitionElementId element = scheme.at (i);
+      std::vector<size_t> element = scheme.at (i).getGenes ();
       std::cout << "(";
       for (size_t j = 0; j < element.size (); j++)
       {
@@ -379,7 +512,7 @@ namespace partest
     std::cout << std::endl;
   }
 
-  int Utilities::averageModelParameters (t_partitionElementId id,
+  int Utilities::averageModelParameters (const t_partitionElementId & id,
                                          partitionList * partitions)
   {
     if (partitions->numberOfPartitions != 1)
@@ -397,10 +530,11 @@ namespace partest
         partitions->partitionData[0]->substRates[i] = 0.0;
       }
     }
-    for (size_t i = 0; i < id.size (); i++)
+    std::vector<size_t> genes = id.getGenes ();
+    for (size_t i = 0; i < genes.size (); i++)
     {
-      t_partitionElementId nextElement (1);
-      nextElement.at (0) = id.at (i);
+      t_partitionElementId nextElement = PartitionElementId::singleGene (
+          genes[i]);
       TreeManager * elementTree =
           PartitionMap::getInstance ()->getPartitionElement (nextElement)->getTreeManager ();
       partitions->partitionData[0]->alpha += elementTree->getAlpha ();
@@ -432,7 +566,8 @@ namespace partest
     return 0;
   }
 
-  pllNewickTree * Utilities::averageBranchLengths (t_partitionElementId id)
+  pllNewickTree * Utilities::averageBranchLengths (
+      const t_partitionElementId & id)
   {
 
     assert(pergene_branch_lengths && pergene_starting_tree);
@@ -449,11 +584,13 @@ namespace partest
     }
 
     pllNewickNodeInfo * ninfo, *updateInfo;
+    TopologyCache::lockParser ();
     for (size_t i = 0; i < id.size (); i++)
     {
-      nts[i] = pllNewickParseString (pergene_starting_tree[id.at (0)]);
+      nts[i] = pllNewickParseString (pergene_starting_tree[id.front ()]);
       infoStack[i] = nts[i]->tree;
     }
+    TopologyCache::unlockParser ();
     pllNewickTree * nt = nts[0];
 
     while (infoStack[0])
@@ -471,11 +608,13 @@ namespace partest
     }
 
     ninfo = (pllNewickNodeInfo *) nt->tree->item;
+    TopologyCache::lockParser ();
     for (size_t i = 1; i < id.size (); i++)
     {
       /* remove newick structures but the one to return */
       pllNewickParseDestroy (&nts[i]);
     }
+    TopologyCache::unlockParser ();
 
     free (nts);
     free (infoStack);
@@ -129,6 +129,46 @@ namespace partest
      */
     static double normalizedEuclideanDistance (double X[], double Y[], int n);
 
+    /**
+     * @brief Accumulate the squared euclidean distances from a vector to a
+     * set of vectors stored by columns
+     *
+     * out[j] += sum_c (query[c] - columns[c * stride + j])^2, j in [0,n)
+     *
+     * @param[in] query The query vector, with numberOfColumns values
+     * @param[in] columns The column-major set of vectors
+     * @param[in] numberOfColumns The length of the vectors
+     * @param[in] stride The distance between two consecutive columns
+     * @param[in] n The number of vectors in the set
+     * @param[in,out] out The accumulated distances
+     */
+    static void squaredDistances (const double * query,
+                                  const double * columns,
+                                  size_t numberOfColumns, size_t stride,
+                                  size_t n, double * out);
+
+    /**
+     * @brief Accumulate the squared euclidean distances from a vector scaled
+     * by a per-vector factor to a set of vectors stored by columns
+     *
+     * out[j] += sum_c (query[c] * scale[j] - columns[c * stride + j])^2
+     */
+    static void scaledSquaredDistances (const double * query,
+                                        const double * columns,
+                                        size_t numberOfColumns, size_t stride,
+                                        size_t n, const double * scale,
+                                        double * out);
+
+    /**
+     * @brief Accumulate the dot products of a vector with a set of vectors
+     * stored by columns
+     *
+     * out[j] += sum_c query[c] * columns[c * stride + j]
+     */
+    static void dotProducts (const double * query, const double * columns,
+                             size_t numberOfColumns, size_t stride, size_t n,
+                             double * out);
+
     static int numSchemesHierarchicalClustering (int numDataBlocks);
 
     static int numSchemesGreedy (int numDataBlocks);
@@ -140,22 +180,25 @@ namespace partest
     /**
      * @brief Merge 2 partition element ids into a new one
      */
-    static void mergeIds (t_partitionElementId & dest, t_partitionElementId id1,
-                          t_partitionElementId id2);
+    static void mergeIds (t_partitionElementId & dest,
+                          const t_partitionElementId & id1,
+                          const t_partitionElementId & id2);
     /**
      * @brief Get the intersection between 2 partition element ids
      */
-    static bool intersec (t_partitionElementId & e1, t_partitionElementId & e2);
+    static bool intersec (const t_partitionElementId & e1,
+                          const t_partitionElementId & e2);
 
     /**
      * @brief Check if a partition element id contains a certain partition
      */
-    static bool contains (t_partitionElementId vec, int num);
+    static bool contains (const t_partitionElementId & vec, int num);
 
     /**
      * @brief Check if a partitioning scheme contains a certain partition element
      */
-    static bool contains (t_partitioningScheme vec, t_partitionElementId id);
+    static bool contains (const t_partitioningScheme & vec,
+                          const t_partitionElementId & id);
 
     /**
      * @brief Clone PLL alignment data
@@ -194,13 +237,14 @@ namespace partest
     /**
      * @brief Compute the average of the model parameters
      */
-    static int averageModelParameters (t_partitionElementId id,
+    static int averageModelParameters (const t_partitionElementId & id,
                                        partitionList * partitions);
 
     /**
      * @brief Get a newick tree with the average branch lengths
      */
-    static pllNewickTree * averageBranchLengths (t_partitionElementId id);
+    static pllNewickTree * averageBranchLengths (
+        const t_partitionElementId & id);
 
     /**
      * @brief Smooth the base frequencies such that there is no frequency below FREQ_MIN
@@ -0,0 +1,163 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file VantagePointTree.cpp
+ * @author Diego Darriba
+ */
+
+#include "VantagePointTree.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+namespace partest
+{
+
+  VantagePointTree::VantagePointTree (const double * _points,
+                                      size_t numberOfPoints,
+                                      size_t _dimension) :
+      points (_points), dimension (_dimension), seed (0x54321)
+  {
+    items.resize (numberOfPoints);
+    for (size_t i = 0; i < numberOfPoints; i++)
+      items[i] = i;
+    nodes.reserve (numberOfPoints);
+    build (0, numberOfPoints);
+  }
+
+  VantagePointTree::~VantagePointTree ()
+  {
+  }
+
+  double VantagePointTree::distance (size_t p1, size_t p2) const
+  {
+    const double * x = points + p1 * dimension;
+    const double * y = points + p2 * dimension;
+    double sum = 0.0;
+    for (size_t i = 0; i < dimension; i++)
+    {
+      sum += (x[i] - y[i]) * (x[i] - y[i]);
+    }
+    return sqrt (sum);
+  }
+
+  int VantagePointTree::build (size_t begin, size_t end)
+  {
+    if (begin >= end)
+      return -1;
+
+    /* reproducible pseudo-random vantage point */
+    seed = seed * 1103515245 + 12345;
+    swap (items[begin], items[begin + (seed >> 8) % (end - begin)]);
+
+    int nodeIndex = (int) nodes.size ();
+    vpNode node;
+    node.point = items[begin];
+    node.threshold = 0.0;
+    node.inside = node.outside = -1;
+    nodes.push_back (node);
+
+    if (end - begin > 1)
+    {
+      vector<t_neighbour> byDistance (end - begin - 1);
+      for (size_t i = begin + 1; i < end; i++)
+      {
+        byDistance[i - begin - 1] = t_neighbour (
+            distance (node.point, items[i]), items[i]);
+      }
+      size_t median = byDistance.size () / 2;
+      nth_element (byDistance.begin (), byDistance.begin () + median,
+                   byDistance.end ());
+      for (size_t i = 0; i < byDistance.size (); i++)
+      {
+        items[begin + 1 + i] = byDistance[i].second;
+      }
+
+      /* [begin+1, begin+1+median) are inside, the rest outside */
+      double threshold = byDistance[median].first;
+      int inside = build (begin + 1, begin + 1 + median);
+      int outside = build (begin + 1 + median, end);
+      nodes[nodeIndex].threshold = threshold;
+      nodes[nodeIndex].inside = inside;
+      nodes[nodeIndex].outside = outside;
+    }
+
+    return nodeIndex;
+  }
+
+  void VantagePointTree::search (int nodeIndex, size_t self, size_t k,
+                                 vector<t_neighbour> & heap,
+                                 double & tau) const
+  {
+    if (nodeIndex < 0)
+      return;
+
+    const vpNode & node = nodes[nodeIndex];
+    double d = distance (self, node.point);
+    if (node.point != self && d < tau)
+    {
+      heap.push_back (t_neighbour (d, node.point));
+      push_heap (heap.begin (), heap.end ());
+      if (heap.size () > k)
+      {
+        pop_heap (heap.begin (), heap.end ());
+        heap.pop_back ();
+      }
+      if (heap.size () == k)
+        tau = heap.front ().first;
+    }
+
+    if (d < node.threshold)
+    {
+      if (d - tau <= node.threshold)
+        search (node.inside, self, k, heap, tau);
+      if (d + tau >= node.threshold)
+        search (node.outside, self, k, heap, tau);
+    }
+    else
+    {
+      if (d + tau >= node.threshold)
+        search (node.outside, self, k, heap, tau);
+      if (d - tau <= node.threshold)
+        search (node.inside, self, k, heap, tau);
+    }
+  }
+
+  void VantagePointTree::nearest (size_t point, size_t k,
+                                  vector<size_t> & neighbours) const
+  {
+    neighbours.clear ();
+    if (!k || nodes.empty ())
+      return;
+
+    vector<t_neighbour> heap;
+    heap.reserve (k + 1);
+    double tau = HUGE_VAL;
+    search (0, point, k, heap, tau);
+
+    sort_heap (heap.begin (), heap.end ());
+    for (size_t i = 0; i < heap.size (); i++)
+    {
+      neighbours.push_back (heap[i].second);
+    }
+  }
+
+} /* namespace partest */
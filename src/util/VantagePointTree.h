@@ -0,0 +1,93 @@
+/*  PartitionTest, fast selection of the best fit partitioning scheme for
+ *  multi-gene data sets.
+ *  Copyright May 2013 by Diego Darriba
+ *
+ *  This program is free software; you may redistribute it and/or modify its
+ *  under the terms of the GNU General Public License as published by the Free
+ *  Software Foundation; either version 3 of the License, or (at your option)
+ *  any later version.
+ *
+ *  This program is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  For any other inquiries send an Email to Diego Darriba
+ *  ddarriba@udc.es
+ */
+
+/**
+ * @file VantagePointTree.h
+ *
+ * @brief Metric index for nearest neighbour queries
+ */
+
+#ifndef VANTAGEPOINTTREE_H_
+#define VANTAGEPOINTTREE_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace partest
+{
+
+  /**
+   * @brief Vantage-point tree over a set of points under the euclidean
+   * distance.
+   *
+   * Each node splits the remaining points by the median distance to its
+   * vantage point, so the k nearest neighbours of a point are found in
+   * O(log n) expected time for low dimensional data.
+   */
+  class VantagePointTree
+  {
+  public:
+    /**
+     * @brief Builds the tree
+     *
+     * The points are not copied and must outlive the tree.
+     *
+     * @param[in] points The row-major points
+     * @param[in] numberOfPoints The number of points
+     * @param[in] dimension The length of each point
+     */
+    VantagePointTree (const double * points, size_t numberOfPoints,
+                      size_t dimension);
+    virtual ~VantagePointTree ();
+
+    /**
+     * @brief Gets the nearest neighbours of an indexed point
+     *
+     * @param[in] point The index of the query point
+     * @param[in] k The maximum number of neighbours
+     * @param[out] neighbours The neighbours, nearest first
+     */
+    void nearest (size_t point, size_t k,
+                  std::vector<size_t> & neighbours) const;
+  private:
+    struct vpNode
+    {
+      size_t point; /** Vantage point */
+      double threshold; /** Median distance to the vantage point */
+      int inside; /** Points closer than the threshold, -1 if none */
+      int outside; /** Points farther than the threshold, -1 if none */
+    };
+
+    /** Candidate neighbour, ordered by distance */
+    typedef std::pair<double, size_t> t_neighbour;
+
+    int build (size_t begin, size_t end);
+    void search (int node, size_t self, size_t k,
+                 std::vector<t_neighbour> & heap, double & tau) const;
+    double distance (size_t p1, size_t p2) const;
+
+    const double * points;
+    size_t dimension;
+    std::vector<size_t> items; /** Point indices, permuted while building */
+    std::vector<vpNode> nodes;
+    unsigned int seed; /** State of the vantage point selection */
+  };
+
+} /* namespace partest */
+
+#endif /* VANTAGEPOINTTREE_H_ */